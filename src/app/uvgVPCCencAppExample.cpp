@@ -61,7 +61,6 @@
 #include "uvgutils/log.hpp"
 #include "uvgutils/utils.hpp"
 #include "uvgvpcc/uvgvpcc.hpp"
-#include "../libuvgvpccenc/utils/statsCollector.hpp"
 #include "../libuvgvpccenc/utils/parameters.hpp"
 
 #ifdef ENABLE_V3CRTP
@@ -647,7 +646,7 @@ int main(const int argc, const char* const argv[]) {
         v3c_sender_thread = std::thread(v3c_sender, &output, appParameters.dstAddress, appParameters.dstPort, appParameters.sdpOutdir);
 
     if(uvgvpcc_enc::p_->exportStatistics){
-        stats.init(appParameters.nbFrames);
+        uvgvpcc_enc::API::defaultEncoder().initializeStatistics(appParameters.nbFrames);
     }
 
     // Main loop of the application, feeding one frame to the encoder at each iteration
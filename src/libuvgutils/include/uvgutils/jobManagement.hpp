@@ -39,10 +39,10 @@
 #include "threadqueue.hpp"
 #include "uvgutils/log.hpp"
 
-#define JOBF(gofId, frameId, priority, func, ...) \
-    uvgutils::JobManager::make_job(gofId, frameId, priority, std::string(#func), func, ##__VA_ARGS__)
+#define JOBF(jobManager, gofId, frameId, priority, func, ...) \
+    (jobManager).make_job(gofId, frameId, priority, std::string(#func), func, ##__VA_ARGS__)
 
-#define JOBG(gofId, priority, func, ...) uvgutils::JobManager::make_job(gofId, priority, std::string(#func), func, ##__VA_ARGS__)
+#define JOBG(jobManager, gofId, priority, func, ...) (jobManager).make_job(gofId, priority, std::string(#func), func, ##__VA_ARGS__)
 
 #define TO_STRING(x) #x
 
@@ -77,28 +77,47 @@ struct hash<uvgutils::jobKey> {
 
 namespace uvgutils {
 
+// Each JobManager instance holds its own job maps, so that several independent pipelines can create and look up their jobs separately.
+// The thread queue executing the jobs is shared by all instances. It is reference counted: each pipeline acquires it before submitting
+// jobs and releases it once all its jobs are done.
 struct JobManager {
+    using JobMap = std::unordered_map<jobKey, std::shared_ptr<Job>>;
+    using JobWrapper = std::function<void(const Job::JobFunction&)>;
+
     static std::unique_ptr<ThreadQueue> threadQueue;
-    static std::unique_ptr<std::unordered_map<jobKey, std::shared_ptr<Job>>> previousGOFJobMap;
-    static std::unique_ptr<std::unordered_map<jobKey, std::shared_ptr<Job>>> previousFrameJobMap;
-    static std::unique_ptr<std::unordered_map<jobKey, std::shared_ptr<Job>>> currentGOFJobMap;
-    static std::unique_ptr<std::unordered_map<jobKey, std::shared_ptr<Job>>> currentFrameJobMap;
+    std::unique_ptr<JobMap> previousGOFJobMap;
+    std::unique_ptr<JobMap> previousFrameJobMap;
+    std::unique_ptr<JobMap> currentGOFJobMap;
+    std::unique_ptr<JobMap> currentFrameJobMap;
+
+    // Optional function wrapping the execution of every job created by this manager (e.g. to set up a per-pipeline context).
+    JobWrapper jobWrapper;
+
+    JobManager();
 
     template <typename Func, typename... Args>
-    static std::shared_ptr<Job> make_job(const size_t& gofId, const size_t& frameId, std::size_t priority, std::string funcName, Func&& func,
-                                         Args&&... args);
+    std::shared_ptr<Job> make_job(const size_t& gofId, const size_t& frameId, std::size_t priority, std::string funcName, Func&& func,
+                                  Args&&... args);
 
     template <typename Func, typename... Args>
-    static std::shared_ptr<Job> make_job(const size_t& gofId, std::size_t priority, std::string funcName, Func&& func, Args&&... args);
+    std::shared_ptr<Job> make_job(const size_t& gofId, std::size_t priority, std::string funcName, Func&& func, Args&&... args);
+
+    std::shared_ptr<Job> getJob(size_t gofId, size_t frameId, const std::string& funcName) const;
+    std::shared_ptr<Job> getJob(size_t gofId, const std::string& funcName) const;
 
-    static std::shared_ptr<Job> getJob(size_t gofId, size_t frameId, const std::string& funcName);
-    static std::shared_ptr<Job> getJob(size_t gofId, const std::string& funcName);
+    // The first acquisition spawns 'numThreads' threads. Later acquisitions reuse the running thread queue, whatever 'numThreads'. Return
+    // the number of threads of the thread queue.
+    static size_t acquireThreadQueue(uint16_t numThreads);
+    // The last release stops the thread queue, so that a later acquisition spawns a new one.
+    static void releaseThreadQueue();
 
-    static void initThreadQueue(uint16_t numThreads);
+    // Data-parallel loop on the shared thread queue (see ThreadQueue::parallelFor). Each chunk is run through 'jobWrapper', like any job of
+    // this manager.
+    void parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body) const;
 
-    static void submitCurrentFrameJobs();
+    void submitCurrentFrameJobs();
 
-    static void submitCurrentGOFJobs();
+    void submitCurrentGOFJobs();
 };
 }  // namespace uvgutils
 
@@ -34,19 +34,24 @@
 
 namespace {
 template <typename Func, typename... Args>
-std::shared_ptr<uvgutils::Job> make_job_impl(const uvgutils::jobKey key, std::size_t priority, Func&& func, Args&&... args) {
+std::shared_ptr<uvgutils::Job> make_job_impl(uvgutils::JobManager& manager, const uvgutils::jobKey key, std::size_t priority, Func&& func,
+                                             Args&&... args) {
     uvgutils::Logger::log<uvgutils::LogLevel::DEBUG>("JOB FACTORY",
                                                      key.toString() + " Creating job with priority " + std::to_string(priority) + "\n");
-    auto job = std::make_shared<uvgutils::Job>(key.toString(), priority, std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+    uvgutils::Job::JobFunction task = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
+    if (manager.jobWrapper) {
+        task = [wrapper = manager.jobWrapper, task = std::move(task)]() { wrapper(task); };
+    }
+    auto job = std::make_shared<uvgutils::Job>(key.toString(), priority, std::move(task));
 
     // Add job to appropriate map based on whether it has frameId
     if (key.getFrameId().has_value()) {
-        if (uvgutils::JobManager::currentFrameJobMap) {
-            uvgutils::JobManager::currentFrameJobMap->emplace(key, job);
+        if (manager.currentFrameJobMap) {
+            manager.currentFrameJobMap->emplace(key, job);
         }
     } else {
-        if (uvgutils::JobManager::currentGOFJobMap) {
-            uvgutils::JobManager::currentGOFJobMap->emplace(key, job);
+        if (manager.currentGOFJobMap) {
+            manager.currentGOFJobMap->emplace(key, job);
         }
     }
 
@@ -59,12 +64,13 @@ namespace uvgutils {
 template <typename Func, typename... Args>
 std::shared_ptr<Job> JobManager::make_job(const size_t& gofId, const size_t& frameId, std::size_t priority, std::string funcName, Func&& func,
                                           Args&&... args) {
-    return make_job_impl(jobKey(gofId, frameId, std::move(funcName)), priority, std::forward<Func>(func), std::forward<Args>(args)...);
+    return make_job_impl(*this, jobKey(gofId, frameId, std::move(funcName)), priority, std::forward<Func>(func),
+                         std::forward<Args>(args)...);
 }
 
 template <typename Func, typename... Args>
 std::shared_ptr<Job> JobManager::make_job(const size_t& gofId, std::size_t priority, std::string funcName, Func&& func, Args&&... args) {
-    return make_job_impl(jobKey(gofId, std::move(funcName)), priority, std::forward<Func>(func), std::forward<Args>(args)...);
+    return make_job_impl(*this, jobKey(gofId, std::move(funcName)), priority, std::forward<Func>(func), std::forward<Args>(args)...);
 }
 
 }  // namespace uvgutils
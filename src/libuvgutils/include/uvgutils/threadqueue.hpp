@@ -34,6 +34,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <cassert>
 #include <condition_variable>
@@ -82,7 +83,7 @@ class Job : public std::enable_shared_from_this<Job> {
         : name_(name),
           func_(func),
           state_(threadqueue_job_state::THREADQUEUE_JOB_STATE_PAUSED),
-          dependencies_(0),
+          dependencies_(1),
           priority(priority),
           completed_(false) {}
     // Variadic template constructor
@@ -91,11 +92,15 @@ class Job : public std::enable_shared_from_this<Job> {
         : name_(name),
           func_(std::bind(std::forward<Func>(func), std::forward<Args>(args)...)),
           state_(threadqueue_job_state::THREADQUEUE_JOB_STATE_PAUSED),
-          dependencies_(0),
+          dependencies_(1),
           priority(priority),
           completed_(false) {}
+    ~Job();
     void execute() const;
     void addDependency(const std::shared_ptr<Job>& dependency);
+    bool releaseDependency();
+    template <typename OnReady>
+    void releaseReverseDependencies(OnReady&& onReady);
     bool isReady() const;
     void wait();
     void complete();
@@ -104,21 +109,54 @@ class Job : public std::enable_shared_from_this<Job> {
     void setState(threadqueue_job_state state) { state_ = state; }
 
     mutable std::mutex mtx_;
-    std::vector<std::shared_ptr<Job>> reverseDependencies_;
     std::string name_;
     JobFunction func_;
-    threadqueue_job_state state_;
+    std::atomic<threadqueue_job_state> state_;
+    // Countdown of the unmet dependencies. It starts at one: this extra count is released by the submission of the job, so a job can not
+    // become ready before being submitted, even if all its dependencies are already completed.
     std::atomic<int> dependencies_;
     std::atomic<std::size_t> priority;
 
    private:
+    // Append-only lock-free list of the jobs depending on this one. Once the job is completed, the list is closed by replacing its head
+    // with the 'closedList' sentinel, after which no dependent can be appended anymore.
+    struct ReverseDependency {
+        std::shared_ptr<Job> job;
+        ReverseDependency* next;
+    };
+    static ReverseDependency closedList;
+
+    bool appendReverseDependency(const std::shared_ptr<Job>& job);
+
+    std::atomic<ReverseDependency*> reverseDependencies_{nullptr};
     std::condition_variable cv_;
     std::atomic<bool> completed_;
 };
 
+// Close the reverse dependency list and release this job from each of its dependents. 'onReady' is called for each dependent whose
+// last dependency was this job.
+template <typename OnReady>
+void Job::releaseReverseDependencies(OnReady&& onReady) {
+    ReverseDependency* node = reverseDependencies_.exchange(&closedList, std::memory_order_acq_rel);
+    assert(node != &closedList);
+    while (node != nullptr) {
+        ReverseDependency* next = node->next;
+        if (node->job->releaseDependency()) {
+            onReady(node->job);
+        }
+        delete node;
+        node = next;
+    }
+}
+
+// Work-stealing thread pool. Each worker owns one deque per priority level. A worker first serves its own deque and then steals from
+// the other workers, always from the highest non-empty priority level. Jobs that become ready when one of their dependencies completes
+// are pushed to the deque of the worker that completed it, jobs submitted from outside the pool are distributed in a round-robin way.
 class ThreadQueue {
    public:
-    ThreadQueue() : stop_(false) {};
+    static constexpr size_t priorityLevelCount = 6;
+
+    ThreadQueue() : nextWorkerQueue_(0), sleepingWorkers_(0), stop_(false) {};
     void initThreadQueue(int numThreads);
     ~ThreadQueue();
 
@@ -126,14 +164,33 @@ class ThreadQueue {
     void pushJob(const std::shared_ptr<Job>& job);
     void stop();
     static void waitForJob(const std::shared_ptr<Job>& job);
+    size_t threadCount() const { return threads_.size(); }
+
+    // Run 'body' on the range [0, count), split in chunks of 'chunkSize' items. The calling thread processes chunks itself while helper jobs
+    // let the idle workers take the other ones. The caller only ever waits for chunks already running, so this function can be called from
+    // within a job without risking a deadlock, even when all the workers are busy.
+    // 'body' is called once per chunk, with the range [chunk * chunkSize, min(count, (chunk + 1) * chunkSize)).
+    void parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body);
 
    private:
-    void workerThread();
-    std::mutex mtx_;
+    struct WorkerQueue {
+        std::mutex mtx_;
+        std::array<std::deque<std::shared_ptr<Job>>, priorityLevelCount> jobs_;
+    };
+
+    void workerThread(size_t workerId);
+    std::shared_ptr<Job> popJob(size_t workerId);
+    std::shared_ptr<Job> popJobFromQueue(WorkerQueue& queue, size_t priority);
+    bool hasPendingJobs() const;
+    void notifyWorker();
+
+    std::vector<std::unique_ptr<WorkerQueue>> workerQueues_;
+    std::array<std::atomic<size_t>, priorityLevelCount> pendingJobs_{};  // Number of queued jobs per priority level, all workers included
+    std::atomic<size_t> nextWorkerQueue_;
+    std::mutex sleepMtx_;
     std::condition_variable jobAvailable_;
-    std::condition_variable jobDone_;
+    std::atomic<size_t> sleepingWorkers_;
     std::vector<std::thread> threads_;
-    std::array<std::deque<std::shared_ptr<Job>>, 6> jobs_;
     std::atomic<bool> stop_;
 };
 
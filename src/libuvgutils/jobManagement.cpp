@@ -32,10 +32,13 @@
 
 #include "uvgutils/jobManagement.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -45,36 +48,39 @@
 #include "uvgutils/threadqueue.hpp"
 
 namespace {
-std::shared_ptr<uvgutils::Job> getJob_impl(const uvgutils::jobKey& key) {
+std::mutex threadQueueMutex;
+size_t threadQueueUsers = 0;  // Number of pipelines holding the shared thread queue
+
+std::shared_ptr<uvgutils::Job> getJob_impl(const uvgutils::JobManager& manager, const uvgutils::jobKey& key) {
     std::shared_ptr<uvgutils::Job> job = nullptr;
     // Check if it's a frame job or GOF job
     if (key.getFrameId().has_value()) {
         // Check current frame jobs first
-        if (uvgutils::JobManager::currentFrameJobMap) {
-            auto it = uvgutils::JobManager::currentFrameJobMap->find(key);
-            if (it != uvgutils::JobManager::currentFrameJobMap->end()) {
+        if (manager.currentFrameJobMap) {
+            auto it = manager.currentFrameJobMap->find(key);
+            if (it != manager.currentFrameJobMap->end()) {
                 job = it->second;
             }
         }
         // Check previous frame jobs if not found
-        if (!job && uvgutils::JobManager::previousFrameJobMap) {
-            auto it = uvgutils::JobManager::previousFrameJobMap->find(key);
-            if (it != uvgutils::JobManager::previousFrameJobMap->end()) {
+        if (!job && manager.previousFrameJobMap) {
+            auto it = manager.previousFrameJobMap->find(key);
+            if (it != manager.previousFrameJobMap->end()) {
                 job = it->second;
             }
         }
     } else {
         // Check current GOF jobs first
-        if (uvgutils::JobManager::currentGOFJobMap) {
-            auto it = uvgutils::JobManager::currentGOFJobMap->find(key);
-            if (it != uvgutils::JobManager::currentGOFJobMap->end()) {
+        if (manager.currentGOFJobMap) {
+            auto it = manager.currentGOFJobMap->find(key);
+            if (it != manager.currentGOFJobMap->end()) {
                 job = it->second;
             }
         }
         // Check previous GOF jobs if not found
-        if (!job && uvgutils::JobManager::previousGOFJobMap) {
-            auto it = uvgutils::JobManager::previousGOFJobMap->find(key);
-            if (it != uvgutils::JobManager::previousGOFJobMap->end()) {
+        if (!job && manager.previousGOFJobMap) {
+            auto it = manager.previousGOFJobMap->find(key);
+            if (it != manager.previousGOFJobMap->end()) {
                 job = it->second;
             }
         }
@@ -93,10 +99,6 @@ namespace uvgutils {
 
 // Static member definitions
 std::unique_ptr<ThreadQueue> JobManager::threadQueue = nullptr;
-std::unique_ptr<std::unordered_map<jobKey, std::shared_ptr<Job>>> JobManager::previousGOFJobMap = nullptr;
-std::unique_ptr<std::unordered_map<jobKey, std::shared_ptr<Job>>> JobManager::previousFrameJobMap = nullptr;
-std::unique_ptr<std::unordered_map<jobKey, std::shared_ptr<Job>>> JobManager::currentGOFJobMap = nullptr;
-std::unique_ptr<std::unordered_map<jobKey, std::shared_ptr<Job>>> JobManager::currentFrameJobMap = nullptr;
 
 // jobKey constructors
 jobKey::jobKey(const size_t& gofId, const size_t& frameId, const std::string& funcName)
@@ -123,22 +125,50 @@ bool jobKey::operator==(const jobKey& other) const {
 }
 
 // JobManager methods
-std::shared_ptr<Job> JobManager::getJob(size_t gofId, size_t frameId, const std::string& funcName) {
+JobManager::JobManager() : currentGOFJobMap(std::make_unique<JobMap>()), currentFrameJobMap(std::make_unique<JobMap>()) {}
+
+std::shared_ptr<Job> JobManager::getJob(size_t gofId, size_t frameId, const std::string& funcName) const {
     const jobKey key(gofId, frameId, funcName);
-    return getJob_impl(key);
+    return getJob_impl(*this, key);
 }
 
-std::shared_ptr<Job> JobManager::getJob(size_t gofId, const std::string& funcName) {
+std::shared_ptr<Job> JobManager::getJob(size_t gofId, const std::string& funcName) const {
     const jobKey key(gofId, funcName);
-    return getJob_impl(key);
+    return getJob_impl(*this, key);
 }
 
 // JobManager method implementations
-void JobManager::initThreadQueue(uint16_t numThreads) {
-    threadQueue = std::make_unique<ThreadQueue>();
-    threadQueue->initThreadQueue(numThreads);
-    currentGOFJobMap = std::make_unique<std::unordered_map<jobKey, std::shared_ptr<Job>>>();
-    currentFrameJobMap = std::make_unique<std::unordered_map<jobKey, std::shared_ptr<Job>>>();
+size_t JobManager::acquireThreadQueue(uint16_t numThreads) {
+    const std::lock_guard lock(threadQueueMutex);
+    if (threadQueueUsers++ == 0) {
+        threadQueue = std::make_unique<ThreadQueue>();
+        threadQueue->initThreadQueue(numThreads);
+    }
+    return threadQueue->threadCount();
+}
+
+void JobManager::releaseThreadQueue() {
+    const std::lock_guard lock(threadQueueMutex);
+    assert(threadQueueUsers > 0);
+    if (--threadQueueUsers == 0) {
+        threadQueue->stop();
+        threadQueue.reset();
+    }
+}
+
+void JobManager::parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body) const {
+    if (!threadQueue) {
+        for (size_t begin = 0; begin < count; begin += chunkSize) {
+            body(begin, std::min(count, begin + chunkSize));
+        }
+        return;
+    }
+    if (!jobWrapper) {
+        threadQueue->parallelFor(count, chunkSize, body);
+        return;
+    }
+    threadQueue->parallelFor(count, chunkSize,
+                             [this, &body](size_t begin, size_t end) { jobWrapper([&body, begin, end]() { body(begin, end); }); });
 }
 
 void JobManager::submitCurrentFrameJobs() {
@@ -148,7 +178,7 @@ void JobManager::submitCurrentFrameJobs() {
         }
     }
     previousFrameJobMap = std::move(currentFrameJobMap);
-    currentFrameJobMap = std::make_unique<std::unordered_map<jobKey, std::shared_ptr<Job>>>();
+    currentFrameJobMap = std::make_unique<JobMap>();
 }
 
 void JobManager::submitCurrentGOFJobs() {
@@ -158,7 +188,7 @@ void JobManager::submitCurrentGOFJobs() {
         }
     }
     previousGOFJobMap = std::move(currentGOFJobMap);
-    currentGOFJobMap = std::make_unique<std::unordered_map<jobKey, std::shared_ptr<Job>>>();
+    currentGOFJobMap = std::make_unique<JobMap>();
 }
 
 }  // namespace uvgutils
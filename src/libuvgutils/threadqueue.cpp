@@ -38,10 +38,12 @@
 #include <cassert>
 #include <cstddef>
 #include <deque>
+#include <exception>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 
 #include "uvgutils/log.hpp"
 
@@ -59,29 +61,54 @@ std::string jobStateToStr(threadqueue_job_state s) {
     return it == stateStr.end() ? "Out of range" : it->second;
 }
 
+Job::ReverseDependency Job::closedList{nullptr, nullptr};
+
+Job::~Job() {
+    // A job which has never been completed still owns its reverse dependency list.
+    ReverseDependency* node = reverseDependencies_.load();
+    while (node != nullptr && node != &closedList) {
+        ReverseDependency* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+bool Job::appendReverseDependency(const std::shared_ptr<Job>& job) {
+    auto* node = new ReverseDependency{job, nullptr};
+    ReverseDependency* head = reverseDependencies_.load(std::memory_order_acquire);
+    do {
+        if (head == &closedList) {
+            delete node;
+            return false;
+        }
+        node->next = head;
+    } while (!reverseDependencies_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_acquire));
+    return true;
+}
+
 void Job::addDependency(const std::shared_ptr<Job>& dependency) {
     if (dependency == nullptr) {
         Logger::log<LogLevel::WARNING>("JOB", getName() + "Dependency is null\n");
         return;
     }
     Logger::log<LogLevel::DEBUG>("JOB", getName() + "Adding " + dependency->getName() + " as dependency\n");
-    dependency->mtx_.lock();
-    Logger::log<LogLevel::DEBUG>("JOB", getName() + "Dependency locked\n");
-    if (dependency->completed_) {
+    assert(getState() == threadqueue_job_state::THREADQUEUE_JOB_STATE_PAUSED);
+
+    // The countdown is increased before the job is visible in the reverse dependency list of 'dependency'. Otherwise, the completion of
+    // 'dependency' could release a count which has not been added yet.
+    dependencies_.fetch_add(1, std::memory_order_relaxed);
+    if (!dependency->appendReverseDependency(this->shared_from_this())) {
+        // 'dependency' is already completed. The submission count is still held, so this can not bring the countdown to zero.
+        dependencies_.fetch_sub(1, std::memory_order_relaxed);
+        Logger::log<LogLevel::DEBUG>("JOB", getName() + dependency->getName() + " is already completed\n");
         return;
     }
-    Logger::log<LogLevel::DEBUG>("JOB", getName() + dependency->getName() + " state: " + jobStateToStr(dependency->getState()) + "\n");
-    dependencies_++;
     Logger::log<LogLevel::DEBUG>("JOB", getName() + "Dependencies: " + std::to_string(dependencies_) + "\n");
-
-    Logger::log<LogLevel::DEBUG>("JOB", getName() + dependency->getName() +
-                                            " Reverse dependencies: " + std::to_string(dependency->reverseDependencies_.size()) + "\n");
-    dependency->reverseDependencies_.emplace_back(this->shared_from_this());
-    Logger::log<LogLevel::DEBUG>("JOB", getName() + dependency->getName() +
-                                            " Reverse dependencies: " + std::to_string(dependency->reverseDependencies_.size()) + "\n");
-    dependency->mtx_.unlock();
 }
 
+// Release one count of the dependency countdown. Return true if it was the last one, meaning that the job is ready to run.
+bool Job::releaseDependency() { return dependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
 bool Job::isReady() const { return dependencies_.load() == 0; }
 
 void Job::execute() const {
@@ -102,15 +129,26 @@ void Job::wait() {
 }
 
 void Job::complete() {
-    // std::unique_lock lock(mtx_);
-    // state_ = threadqueue_job_state::THREADQUEUE_JOB_STATE_DONE;
-    completed_ = true;
+    {
+        // The lock is only here to not lose the notification of a thread being between its check and its wait in 'Job::wait'.
+        const std::lock_guard lock(mtx_);
+        completed_ = true;
+    }
     cv_.notify_all();
 }
 
+namespace {
+// Identify the worker executing the current thread, so that jobs pushed from within a job land in the deque of this worker.
+thread_local const ThreadQueue* currentThreadQueue = nullptr;
+thread_local size_t currentWorkerId = 0;
+}  // anonymous namespace
+
 void ThreadQueue::initThreadQueue(int numThreads) {
     for (int i = 0; i < numThreads; ++i) {
-        threads_.emplace_back(&ThreadQueue::workerThread, this);
+        workerQueues_.emplace_back(std::make_unique<WorkerQueue>());
+    }
+    for (int i = 0; i < numThreads; ++i) {
+        threads_.emplace_back(&ThreadQueue::workerThread, this, static_cast<size_t>(i));
     }
 }
 
@@ -119,29 +157,38 @@ ThreadQueue::~ThreadQueue() { stop(); }
 void ThreadQueue::pushJob(const std::shared_ptr<Job>& job) {
     assert(job->getState() == threadqueue_job_state::THREADQUEUE_JOB_STATE_PAUSED ||
            job->getState() == threadqueue_job_state::THREADQUEUE_JOB_STATE_WAITING);
+    assert(job->priority < priorityLevelCount);
     Logger::log<LogLevel::TRACE>("ThreadQueue", "Job " + job->getName() + " pushed to the queue\n");
     job->setState(threadqueue_job_state::THREADQUEUE_JOB_STATE_READY);
-    jobs_[job->priority].push_back(job);
+
+    const size_t workerId =
+        currentThreadQueue == this ? currentWorkerId : nextWorkerQueue_.fetch_add(1, std::memory_order_relaxed) % workerQueues_.size();
+    WorkerQueue& queue = *workerQueues_[workerId];
+    {
+        const std::lock_guard lockW(queue.mtx_);
+        queue.jobs_[job->priority].push_back(job);
+        pendingJobs_[job->priority]++;
+    }
+    notifyWorker();
 }
 
 void ThreadQueue::submitJob(const std::shared_ptr<Job>& job) {
-    const std::lock_guard lockQ(mtx_);
-    const std::lock_guard lockJ(job->mtx_);
     if (threads_.empty()) {
         job->setState(threadqueue_job_state::THREADQUEUE_JOB_STATE_READY);
         job->execute();
         job->complete();
-    } else if (job->isReady()) {
+        return;
+    }
+    // The state is set before releasing the submission count, as a completing dependency may push the job right after.
+    job->setState(threadqueue_job_state::THREADQUEUE_JOB_STATE_WAITING);
+    if (job->releaseDependency()) {
         pushJob(job);
-        jobAvailable_.notify_one();
-    } else {
-        job->setState(threadqueue_job_state::THREADQUEUE_JOB_STATE_WAITING);
     }
 }
 
 void ThreadQueue::stop() {
     {
-        const std::unique_lock lock(mtx_);
+        const std::lock_guard lock(sleepMtx_);
         stop_ = true;
         jobAvailable_.notify_all();
     }
@@ -154,68 +201,134 @@ void ThreadQueue::stop() {
 
 void ThreadQueue::waitForJob(const std::shared_ptr<Job>& job) { job->wait(); }
 
-void ThreadQueue::workerThread() {
-    std::unique_lock lockQ(mtx_);
-    for (;;) {
-        std::shared_ptr<Job> job;
-        {
-            jobAvailable_.wait(lockQ, [this]() {
-                return stop_ ||
-                       std::any_of(jobs_.begin(), jobs_.end(), [](const std::deque<std::shared_ptr<Job>>& jobs) { return !jobs.empty(); });
-            });
-            if (stop_) {
-                return;
+void ThreadQueue::parallelFor(const size_t count, const size_t chunkSize, const std::function<void(size_t, size_t)>& body) {
+    assert(chunkSize > 0);
+    const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    const size_t availableWorkers = currentThreadQueue == this ? threads_.size() - 1 : threads_.size();
+    const size_t helperCount = chunkCount == 0 ? 0 : std::min(chunkCount - 1, availableWorkers);
+    if (helperCount == 0) {
+        for (size_t begin = 0; begin < count; begin += chunkSize) {
+            body(begin, std::min(count, begin + chunkSize));
+        }
+        return;
+    }
+
+    // The state is shared with the helper jobs, which may be popped after the end of the call. Such a late helper finds no chunk left and
+    // never touches 'body'.
+    struct ParallelForState {
+        std::atomic<size_t> nextChunk{0};
+        std::atomic<size_t> doneChunks{0};
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::exception_ptr exception;
+    };
+    auto state = std::make_shared<ParallelForState>();
+    auto runChunks = [state, &body, count, chunkSize, chunkCount]() {
+        for (size_t chunk = state->nextChunk.fetch_add(1); chunk < chunkCount; chunk = state->nextChunk.fetch_add(1)) {
+            const size_t begin = chunk * chunkSize;
+            try {
+                body(begin, std::min(count, begin + chunkSize));
+            } catch (...) {
+                const std::lock_guard lock(state->mtx);
+                if (!state->exception) {
+                    state->exception = std::current_exception();
+                }
+            }
+            if (state->doneChunks.fetch_add(1, std::memory_order_acq_rel) + 1 == chunkCount) {
+                const std::lock_guard lock(state->mtx);
+                state->cv.notify_all();
             }
-            for (size_t i = jobs_.size() - 1; i >= 0; --i) {
-                if (!jobs_[i].empty()) {
-                    job = jobs_[i].front();
-                    jobs_[i].pop_front();
-                    break;
+        }
+    };
+
+    for (size_t i = 0; i < helperCount; ++i) {
+        submitJob(std::make_shared<Job>("parallelFor", priorityLevelCount - 1, runChunks));
+    }
+    runChunks();
+
+    std::unique_lock lock(state->mtx);
+    state->cv.wait(lock, [&state, chunkCount]() { return state->doneChunks.load(std::memory_order_acquire) == chunkCount; });
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+bool ThreadQueue::hasPendingJobs() const {
+    return std::any_of(pendingJobs_.begin(), pendingJobs_.end(), [](const std::atomic<size_t>& count) { return count.load() > 0; });
+}
+
+void ThreadQueue::notifyWorker() {
+    // A sleeping worker registers itself under sleepMtx_ before checking for pending jobs. Taking the same lock here before notifying
+    // guarantees that the wake-up can not be lost between the check and the wait.
+    if (sleepingWorkers_.load() > 0) {
+        const std::lock_guard lock(sleepMtx_);
+        jobAvailable_.notify_one();
+    }
+}
+
+std::shared_ptr<Job> ThreadQueue::popJobFromQueue(WorkerQueue& queue, size_t priority) {
+    const std::lock_guard lockW(queue.mtx_);
+    std::deque<std::shared_ptr<Job>>& jobs = queue.jobs_[priority];
+    if (jobs.empty()) {
+        return nullptr;
+    }
+    std::shared_ptr<Job> job = std::move(jobs.front());
+    jobs.pop_front();
+    pendingJobs_[priority]--;
+    return job;
+}
+
+std::shared_ptr<Job> ThreadQueue::popJob(size_t workerId) {
+    const size_t workerCount = workerQueues_.size();
+    for (size_t priority = priorityLevelCount; priority-- > 0;) {
+        if (pendingJobs_[priority].load() == 0) {
+            continue;
+        }
+        // Own deque first, then try to steal from the other workers.
+        for (size_t i = 0; i < workerCount; ++i) {
+            std::shared_ptr<Job> job = popJobFromQueue(*workerQueues_[(workerId + i) % workerCount], priority);
+            if (job) {
+                if (i != 0) {
+                    Logger::log<LogLevel::TRACE>("ThreadQueue", "Job " + job->getName() + " stolen by worker " + std::to_string(workerId) +
+                                                                    "\n");
                 }
+                return job;
             }
-            // job = jobs_.front();
-            // jobs_.pop_front();
-            Logger::log<LogLevel::TRACE>("ThreadQueue", "Job " + job->getName() + " popped from the queue\n");
         }
-        std::unique_lock lockJ(job->mtx_);
+    }
+    return nullptr;
+}
+
+void ThreadQueue::workerThread(size_t workerId) {
+    currentThreadQueue = this;
+    currentWorkerId = workerId;
+    for (;;) {
+        if (stop_) {
+            return;
+        }
+        std::shared_ptr<Job> job = popJob(workerId);
+        if (!job) {
+            std::unique_lock lockS(sleepMtx_);
+            sleepingWorkers_++;
+            jobAvailable_.wait(lockS, [this]() { return stop_ || hasPendingJobs(); });
+            sleepingWorkers_--;
+            continue;
+        }
+        Logger::log<LogLevel::TRACE>("ThreadQueue", "Job " + job->getName() + " popped from the queue\n");
+
         assert(job->getState() == threadqueue_job_state::THREADQUEUE_JOB_STATE_READY);
         job->setState(threadqueue_job_state::THREADQUEUE_JOB_STATE_RUNNING);
         Logger::log<LogLevel::DEBUG>("JOB: " + job->getName(), jobStateToStr(job->getState()) + "\n");
-        lockJ.unlock();
-        lockQ.unlock();
 
         job->execute();
 
-        lockQ.lock();
-        lockJ.lock();
         assert(job->getState() == threadqueue_job_state::THREADQUEUE_JOB_STATE_RUNNING);
         job->setState(threadqueue_job_state::THREADQUEUE_JOB_STATE_DONE);
         Logger::log<LogLevel::DEBUG>("JOB: " + job->getName(), jobStateToStr(job->getState()) + "\n");
         job->complete();
-        jobDone_.notify_all();
-
-        // Go through all the jobs that depend on this one, decreasing their
-        // ndepends. Count how many jobs can now start executing so we know how
-        // many threads to wake up.
-        int readyJobs = 0;
-        // for (auto &dep : job->reverseDependencies_) {
-        for (auto dep = job->reverseDependencies_.begin(); dep != job->reverseDependencies_.end();) {
-            const std::lock_guard lockD((*dep)->mtx_);
-            Logger::log<LogLevel::DEBUG>("JOB: " + job->getName(), (*dep)->getName() + "remove dependency\n");
-            assert((*dep)->getState() == threadqueue_job_state::THREADQUEUE_JOB_STATE_WAITING ||
-                   (*dep)->getState() == threadqueue_job_state::THREADQUEUE_JOB_STATE_PAUSED);
-            assert((*dep)->dependencies_ > 0);
-            (*dep)->dependencies_--;
-
-            if ((*dep)->dependencies_ == 0 && (*dep)->getState() == threadqueue_job_state::THREADQUEUE_JOB_STATE_WAITING) {
-                pushJob(*dep);
-                readyJobs++;
-            }
-            job->reverseDependencies_.erase(dep);
-        }
-        for (int i = 0; i < readyJobs - 1; ++i) {
-            jobAvailable_.notify_one();
-        }
+
+        // Release this job from all the jobs depending on it. The ones that can now start are pushed to the deque of this worker.
+        job->releaseReverseDependencies([this](const std::shared_ptr<Job>& dep) { pushJob(dep); });
     }
 }
 
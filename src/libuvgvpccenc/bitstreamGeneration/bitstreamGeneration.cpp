@@ -46,6 +46,7 @@
 #include "atlas_context.hpp"
 #include "bitstream_common.hpp"
 #include "gof.hpp"
+#include "utils/encoderContext.hpp"
 #include "utils/parameters.hpp"
 #include "uvgutils/log.hpp"
 #include "uvgvpcc/uvgvpcc.hpp"
@@ -145,7 +146,7 @@ void BitstreamGeneration::createV3CGOFBitstream(const std::shared_ptr<uvgvpcc_en
     }
 
     if (paramUVG.displayBitstreamGenerationFps) {
-        static double lastStampJobCreateV3CGOFBitstream = 0.0;
+        double& lastStampJobCreateV3CGOFBitstream = uvgvpcc_enc::currentContext->lastStampJobCreateV3CGOFBitstream;
         const double currentStampJobCreateV3CGOFBitstream = uvgutils::global_timer.elapsed();
         const double ms = currentStampJobCreateV3CGOFBitstream - lastStampJobCreateV3CGOFBitstream;
         double fps = (static_cast<double>(gofUVG->nbFrames) * 1000.0) / ms;
@@ -165,6 +166,6 @@ void BitstreamGeneration::createV3CGOFBitstream(const std::shared_ptr<uvgvpcc_en
     output->available_chunks.release();
 
     if(uvgvpcc_enc::p_->exportStatistics){
-        stats.writeToFile(uvgvpcc_enc::p_->statisticsDir + "Statistics.json", gofUVG->gofId);
+        StatsCollector::instance().writeToFile(uvgvpcc_enc::p_->statisticsDir + "Statistics.json", gofUVG->gofId);
     }
 }
\ No newline at end of file
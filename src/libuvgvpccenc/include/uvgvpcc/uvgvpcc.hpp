@@ -46,6 +46,7 @@
 
 #include "../utils/parameters.hpp"
 #include "../utils/constants.hpp"
+#include "../utils/occupancyBitmap.hpp"
 #include "uvgutils/utils.hpp"
 // #include "../utils/commonMemory.hpp"
 
@@ -170,6 +171,8 @@ struct Patch {
 };
 
 struct GOF;
+class CommonMemory;
+struct EncoderContext;
 
 // TODO(lf): Avid using both constant sized and dynamic sized memory member within the same struct.
 struct Frame {
@@ -185,11 +188,11 @@ struct Frame {
     std::vector<uvgutils::VectorN<typeGeometryInput, 3>> pointsGeometry;
     std::vector<uvgutils::VectorN<uint8_t, 3>> pointsAttribute;
 
-    size_t mapHeight = 0;
+    size_t mapHeight = 0;    // Set by the encoder receiving the frame
     size_t mapHeightDS = 0;
 
     Frame(const size_t& frameId, const size_t& frameNumber, const std::string& pointCloudPath)
-        : frameId(frameId), frameNumber(frameNumber), pointCloudPath(pointCloudPath), pointCount(0), mapHeight(p_->minimumMapHeight), mapHeightDS(p_->minimumMapHeight / p_->occupancyMapDSResolution),patchList(nullptr) {}
+        : frameId(frameId), frameNumber(frameNumber), pointCloudPath(pointCloudPath), pointCount(0), patchList(nullptr) {}
     ~Frame() {
         if (conccurentFrameSem) {
             conccurentFrameSem->release();
@@ -200,7 +203,7 @@ struct Frame {
     // lf: Centralized memory handling //
     std::vector<Patch>* patchList;
 
-    std::vector<uint8_t>* occupancyMap;    // (boolean vector)
+    OccupancyBitmap* occupancyMap;         // (bit-packed)
     std::vector<uint8_t>* occupancyMapDS;  // Down-scaled occupancy map of the frame (boolean vector)
     std::vector<uint8_t>* geometryMapL1;  // first layer
     std::vector<uint8_t>* geometryMapL2;  // second layer
@@ -223,12 +226,13 @@ struct GOF {
 
     // lf: centralized memory handling //
     std::array<std::vector<Patch>, MAX_GOF_SIZE>* framePatches;
-    std::array<std::vector<uint8_t>, MAX_GOF_SIZE>* frameOccupancyMaps;
+    std::array<OccupancyBitmap, MAX_GOF_SIZE>* frameOccupancyMaps;
     std::array<std::vector<uint8_t>, MAX_GOF_SIZE>* frameOccupancyMapsDS;
     std::array<std::vector<uint8_t>, MAX_GOF_SIZE>* frameGeometryMapsL1;
     std::array<std::vector<uint8_t>, MAX_GOF_SIZE>* frameGeometryMapsL2;
     std::array<std::vector<uint8_t>, MAX_GOF_SIZE>* frameAttributeMapsL1;
     std::array<std::vector<uint8_t>, MAX_GOF_SIZE>* frameAttributeMapsL2;
+    std::shared_ptr<CommonMemory> commonMemory;  // Memory of the encoder that created this GOF
 
     GOF(const size_t& gofId);
     void setFrameMemoryPtrs(std::shared_ptr<Frame>& frame);
@@ -257,6 +261,36 @@ struct v3c_unit_stream {
     std::mutex io_mutex;  // Locks production and consumption in the v3c_chunks queue
 };
 
+/// @brief Handle of one uvgVPCCenc encoder. Each instance owns its parameters, job maps, memory pools and 2D encoder sessions, so that several
+/// encoders can run in the same process. All instances share the library thread pool: it is spawned by the first initialized instance and
+/// stopped once the last one has been stopped (or destroyed).
+class Encoder {
+   public:
+    Encoder();
+    ~Encoder();
+    Encoder(const Encoder&) = delete;
+    Encoder& operator=(const Encoder&) = delete;
+
+    void initializeEncoder();
+    void setParameter(const std::string& parameterName, const std::string& parameterValue);
+    void encodeFrame(std::shared_ptr<Frame>& frame, v3c_unit_stream* output);
+    void emptyFrameQueue();
+    void stopEncoder();
+
+    const Parameters& getParameters() const;
+    void initializeStatistics(size_t nbFrames);
+
+   private:
+    friend Encoder& defaultEncoder();
+    explicit Encoder(EncoderContext* context);
+
+    std::unique_ptr<EncoderContext> ownedContext_;
+    EncoderContext* context_;
+};
+
+/// @brief Encoder instance used by the free API functions below.
+Encoder& defaultEncoder();
+
 void initializeEncoder();
 void setParameter(const std::string& parameterName, const std::string& parameterValue);
 void encodeFrame(std::shared_ptr<Frame>& frame, v3c_unit_stream* output);
@@ -34,6 +34,8 @@
 
 /// \file Abstract class defining the behaviour of any 2D encoder to be used within the uvgVPCCenc library. 
 
+#include <stdexcept>
+
 #include "uvgvpcc/uvgvpcc.hpp"
 
 enum ENCODER_TYPE {OCCUPANCY, GEOMETRY, ATTRIBUTE};
@@ -46,6 +48,17 @@ public:
     
     virtual void encodeGOFMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof) = 0;
 
+    // Frame-level encoding (parameter 'frameLevel2DEncoding'). The maps of each frame are sent to the 2D encoder as soon as they are
+    // generated, in frame order. 'encodeGOFMaps' is then only called to complete the video of the GOF. An encoder that does not support this
+    // mode keeps the default implementation.
+    virtual void encodeFrameMaps(const std::shared_ptr<uvgvpcc_enc::Frame>& /*frame*/) {
+        throw std::runtime_error("This 2D encoder does not support the frame-level encoding.");
+    };
+
+    // True if the encoder carries its state (e.g. the POC) from one GOF to the next. The GOFs of this video are then encoded in order, so
+    // that the bitstream does not depend on the job scheduling.
+    virtual bool keepsStateAcrossGOFs() const { return false; }
+
 protected:
     const ENCODER_TYPE encoderType_;
 };
@@ -36,6 +36,7 @@
 
 #include <kvazaar.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdarg>
 #include <cstddef>
@@ -43,14 +44,17 @@
 #include <cstdlib>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "abstract2DMapEncoder.hpp"
 #include "catchLibLog.hpp"
 #include "utils/fileExport.hpp"
 #include "utils/parameters.hpp"
+#include "uvgutils/log.hpp"
 #include "uvgvpcc/uvgvpcc.hpp"
 
 using namespace uvgvpcc_enc;
@@ -59,37 +63,33 @@ void EncoderKvazaar::initializeLogCallback() { kvazaar_log_callback = static_cas
 
 namespace {
 
-void setMapList(const std::shared_ptr<uvgvpcc_enc::GOF>& gof, std::vector<std::reference_wrapper<std::vector<uint8_t>>>& mapList,
-                const ENCODER_TYPE& encoderType) {
-    mapList.reserve(gof->nbFrames);
+void setFrameMapList(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<std::reference_wrapper<std::vector<uint8_t>>>& mapList,
+                     const ENCODER_TYPE& encoderType) {
     if (encoderType == OCCUPANCY) {
-        for (const std::shared_ptr<uvgvpcc_enc::Frame>& frame : gof->frames) {
-            mapList.emplace_back(*frame->occupancyMapDS);
-        }
-        // bitstream = &gof->bitstreamOccupancy;
-
+        mapList.emplace_back(*frame->occupancyMapDS);
     } else if (encoderType == GEOMETRY) {
-        for (const std::shared_ptr<uvgvpcc_enc::Frame>& frame : gof->frames) {
-            mapList.emplace_back(*frame->geometryMapL1);
-            if (p_->doubleLayer) {
-                mapList.emplace_back(*frame->geometryMapL2);
-            }
+        mapList.emplace_back(*frame->geometryMapL1);
+        if (p_->doubleLayer) {
+            mapList.emplace_back(*frame->geometryMapL2);
         }
-        // bitstream = &gof->bitstreamGeometry;
-
     } else if (encoderType == ATTRIBUTE) {
-        for (const std::shared_ptr<uvgvpcc_enc::Frame>& frame : gof->frames) {
-            mapList.emplace_back(*frame->attributeMapL1);
-            if (p_->doubleLayer) {
-                mapList.emplace_back(*frame->attributeMapL2);
-            }
+        mapList.emplace_back(*frame->attributeMapL1);
+        if (p_->doubleLayer) {
+            mapList.emplace_back(*frame->attributeMapL2);
         }
-        // bitstream = &gof->bitstreamAttribute;
     } else {
         assert(false);
     }
 }
 
+void setMapList(const std::shared_ptr<uvgvpcc_enc::GOF>& gof, std::vector<std::reference_wrapper<std::vector<uint8_t>>>& mapList,
+                const ENCODER_TYPE& encoderType) {
+    mapList.reserve(gof->nbFrames);
+    for (const std::shared_ptr<uvgvpcc_enc::Frame>& frame : gof->frames) {
+        setFrameMapList(frame, mapList, encoderType);
+    }
+}
+
 void setBitstream(const std::shared_ptr<uvgvpcc_enc::GOF>& gof, std::vector<uint8_t>& bitstream, const ENCODER_TYPE& encoderType) {
     switch (encoderType) {
         case OCCUPANCY:
@@ -125,7 +125,8 @@ std::vector<uint8_t>& getBitstream(const std::shared_ptr<uvgvpcc_enc::GOF>& gof,
 }
 
 //TODO(lf): verify the return value for each api->config_parse (make a wrapper)
-void setKvazaarConfig(kvz_api* api, kvz_config* config, const size_t& width, const size_t& height, const ENCODER_TYPE& encoderType) {
+void setKvazaarConfig(kvz_api* api, kvz_config* config, const size_t& width, const size_t& height, const ENCODER_TYPE& encoderType,
+                      const bool& keepEncoderOpen) {
     // Basic config
     api->config_parse(config, "enable-logging", "1");  // TODO(lf) what about performance ? It should depends on the log level
     api->config_parse(config, "psnr", "0");
@@ -135,6 +136,11 @@ void setKvazaarConfig(kvz_api* api, kvz_config* config, const size_t& width, con
     if(!p_->encoderInfoSEI) {
         api->config_parse(config, "info", "none");
     }
+    if (keepEncoderOpen) {
+        // The encoder stays open across GOFs. Each GOF starts with an intra frame (there is one intra period per frame or per pair of layers),
+        // so re-sending the parameter sets every 'sizeGOF' intra periods keeps each GOF video sub-bitstream independently decodable.
+        api->config_parse(config, "vps-period", std::to_string(p_->sizeGOF).c_str());
+    }
 
     // Map-specific settings
     switch (encoderType) {
@@ -243,92 +249,220 @@ void setKvazaarConfig(kvz_api* api, kvz_config* config, const size_t& width, con
     }
 }
 
-void encodeVideoKvazaar(const std::vector<std::reference_wrapper<std::vector<uint8_t>>>& mapList, kvz_api* api, kvz_config* config,
-                        const size_t width, const size_t height, std::vector<uint8_t>& bitstream, const std::string& encoderName) {
-    // TODO(lf): bitstream.reserve(...)
-    kvz_encoder* cpu_enc = api->encoder_open(config);
-    if (cpu_enc == nullptr) {
-        throw std::runtime_error(encoderName +
-                                 ": Failed to open Kvazaar encoder.");  // TODO(lf): suggest to use log level debug to see Kvazaar log
-    };
-
+// Send one map to the encoder (or nullptr to flush it) and append the output chunks to the bitstream. Return true if a frame was output.
+bool encodePictureKvazaar(std::vector<uint8_t>* map, kvz_api* api, kvz_encoder* cpu_enc, const size_t width, const size_t height,
+                          std::vector<uint8_t>& bitstream, const std::string& encoderName) {
     kvz_data_chunk* chunks_out = nullptr;
     kvz_picture* pic = nullptr;
     uint32_t len_out = 0;
+    const size_t sizeMap = width * height;
+    if (map != nullptr) {
+        pic = api->picture_alloc(static_cast<int32_t>(width), static_cast<int32_t>(height));
+        if (pic == nullptr) {
+            throw std::runtime_error(encoderName + ": Failed to allocate Kvazaar picture.");
+        };
+
+        // All maps are already converted to YUV420 at this moment, even occupancy and geometry maps.
+        pic->y = map->data();
+        pic->u = &(*map)[sizeMap];
+        pic->v = &(*map)[sizeMap + (sizeMap >> 2U)];
+    }
+    api->encoder_encode(cpu_enc, pic, &chunks_out, &len_out, nullptr, nullptr, nullptr);  // kvazaar gateway
+    api->picture_free(pic);                                                               // Do nothing if pic == nullptr
+
+    if (chunks_out == nullptr) {
+        return false;
+    }
+    for (kvz_data_chunk* chunk = chunks_out; chunk != nullptr; chunk = chunk->next) {
+        bitstream.insert(bitstream.end(), &chunk->data[0], &chunk->data[chunk->len]);
+    }
+    api->chunk_free(chunks_out);  // finaly makes chunks_out = nullptr;
+    return true;
+}
+
+// Feed all the maps of the GOF, then flush the encoder. The flush only drains the pictures in flight, so the encoder can be fed again with
+// the maps of a following GOF.
+void encodeVideoKvazaar(const std::vector<std::reference_wrapper<std::vector<uint8_t>>>& mapList, kvz_api* api, kvz_encoder* cpu_enc,
+                        const size_t width, const size_t height, std::vector<uint8_t>& bitstream, const std::string& encoderName) {
+    // TODO(lf): bitstream.reserve(...)
     size_t frameCountIn = 0;
     size_t frameCountOut = 0;
-    const size_t sizeMap = width * height;
     while (frameCountOut < mapList.size()) {
-        pic = nullptr;
+        std::vector<uint8_t>* map = nullptr;
         if (frameCountIn < mapList.size()) {
-            pic = api->picture_alloc(static_cast<int32_t>(width), static_cast<int32_t>(height));
-            if (pic == nullptr) {
-                throw std::runtime_error(encoderName + ": Failed to allocate Kvazaar picture.");
-            };
-
-            // All maps are already converted to YUV420 at this moment, even occupancy and geometry maps.
-            std::vector<uint8_t>& map = mapList[frameCountIn].get();
-            pic->y = map.data();
-            pic->u = &map[sizeMap];
-            pic->v = &map[sizeMap + (sizeMap >> 2U)];
+            map = &mapList[frameCountIn].get();
             ++frameCountIn;
         }
-        api->encoder_encode(cpu_enc, pic, &chunks_out, &len_out, nullptr, nullptr, nullptr);  // kvazaar gateway
-        api->picture_free(pic);                                                               // Do nothing if pic == nullptr
-
-        if (chunks_out == nullptr) {
-            continue;
-        }
-        for (kvz_data_chunk* chunk = chunks_out; chunk != nullptr; chunk = chunk->next) {
-            bitstream.insert(bitstream.end(), &chunk->data[0], &chunk->data[chunk->len]);
+        if (encodePictureKvazaar(map, api, cpu_enc, width, height, bitstream, encoderName)) {
+            ++frameCountOut;
         }
-        api->chunk_free(chunks_out);  // finaly makes chunks_out = nullptr;
-        ++frameCountOut;
     }
-    api->encoder_close(cpu_enc);
 }
 
 }  // anonymous namespace
 
-void EncoderKvazaar::encodeGOFMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof) {
-    std::string encoderName;  // For log and debug
+EncoderKvazaar::EncoderKvazaar(const ENCODER_TYPE& encoderType)
+    : Abstract2DMapEncoder(encoderType),
+      api_(const_cast<kvz_api*>(kvz_api_get(8))),  // NOLINT(cppcoreguidelines-pro-type-const-cast)
+      keepEncoderOpen_(false) {
+    std::string encodingMode;
     switch (encoderType_) {
         case OCCUPANCY:
-            encoderName = "Kvazaar occupancy map encoder";
+            encoderName_ = "Kvazaar occupancy map encoder";
+            encodingMode = p_->occupancyEncodingMode;
             break;
         case GEOMETRY:
-            encoderName = "Kvazaar geometry map encoder";
+            encoderName_ = "Kvazaar geometry map encoder";
+            encodingMode = p_->geometryEncodingMode;
             break;
         case ATTRIBUTE:
-            encoderName = "Kvazaar attribute map encoder";
+            encoderName_ = "Kvazaar attribute map encoder";
+            encodingMode = p_->attributeEncodingMode;
             break;
         default:
             assert(false);
     }
 
-    kvz_api* api = const_cast<kvz_api*>(kvz_api_get(8));  // NOLINT(cppcoreguidelines-pro-type-const-cast)
-    kvz_config* config = api->config_alloc();
+    // In RA mode, the GOP of a GOF can't be completed with the frames of the next one without breaking the independent decoding of each GOF
+    // video sub-bitstream. The encoder is then reopened for each GOF (only the configuration is kept). The encoder info SEI is written in the
+    // first frame of an encoder only, so it also requires a new encoder for each GOF.
+    keepEncoderOpen_ = p_->persistent2DEncoderSessions && encodingMode == "AI" && !p_->encoderInfoSEI;
+}
+
+EncoderKvazaar::~EncoderKvazaar() {
+    for (const auto& streamPair : streams_) {  // Only left when the encoding has been interrupted
+        idleSessions_.push_back(streamPair.second.session);
+    }
+    for (Session& session : idleSessions_) {
+        destroySession(session);
+    }
+}
+
+EncoderKvazaar::Session EncoderKvazaar::acquireSession(const size_t& width, const size_t& height) {
+    Session session;
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex_);
+        auto it = std::find_if(idleSessions_.begin(), idleSessions_.end(), [&height](const Session& idle) { return idle.height == height; });
+        if (it == idleSessions_.end() && !idleSessions_.empty()) {
+            it = idleSessions_.begin();  // No session with the right height. Reconfigure an existing one.
+        }
+        if (it != idleSessions_.end()) {
+            session = *it;
+            idleSessions_.erase(it);
+        }
+    }
 
-    if (config == nullptr) {
-        throw std::runtime_error(encoderName + ": Failed to allocate Kvazaar config.");
-    };
+    if (session.config == nullptr) {
+        session.config = api_->config_alloc();
+        if (session.config == nullptr) {
+            throw std::runtime_error(encoderName_ + ": Failed to allocate Kvazaar config.");
+        };
+        if (api_->config_init(session.config) == 0) {
+            destroySession(session);
+            throw std::runtime_error(encoderName_ + ": Failed to initialize Kvazaar config.");
+        }
+        setKvazaarConfig(api_, session.config, width, height, encoderType_, keepEncoderOpen_);
+        session.height = height;
+    } else if (session.height != height) {
+        uvgutils::Logger::log<uvgutils::LogLevel::DEBUG>("MAP ENCODING", encoderName_ + ": Map height changed from " +
+                                                                             std::to_string(session.height) + " to " + std::to_string(height) +
+                                                                             ". Reconfigure the Kvazaar session.\n");
+        if (session.encoder != nullptr) {
+            api_->encoder_close(session.encoder);
+            session.encoder = nullptr;
+        }
+        api_->config_parse(session.config, "height", std::to_string(height).c_str());
+        session.height = height;
+    }
 
-    if (api->config_init(config) == 0) {
-        throw std::runtime_error(encoderName + ": Failed to initialize Kvazaar config.");
+    if (session.encoder == nullptr) {
+        session.encoder = api_->encoder_open(session.config);
+        if (session.encoder == nullptr) {
+            destroySession(session);
+            throw std::runtime_error(encoderName_ +
+                                     ": Failed to open Kvazaar encoder.");  // TODO(lf): suggest to use log level debug to see Kvazaar log
+        };
     }
+    return session;
+}
+
+void EncoderKvazaar::releaseSession(Session& session) {
+    if (!keepEncoderOpen_) {
+        api_->encoder_close(session.encoder);
+        session.encoder = nullptr;
+    }
+    const std::lock_guard<std::mutex> lock(sessionMutex_);
+    idleSessions_.push_back(session);
+}
+
+void EncoderKvazaar::destroySession(Session& session) {
+    if (session.encoder != nullptr) {
+        api_->encoder_close(session.encoder);
+        session.encoder = nullptr;
+    }
+    if (session.config != nullptr) {
+        api_->config_destroy(session.config);
+        session.config = nullptr;
+    }
+}
 
+void EncoderKvazaar::encodeFrameMaps(const std::shared_ptr<uvgvpcc_enc::Frame>& frame) {
+    const std::shared_ptr<uvgvpcc_enc::GOF> gof = frame->gof.lock();
     const size_t width = encoderType_ == OCCUPANCY ? p_->mapWidth / p_->occupancyMapDSResolution : p_->mapWidth;
     const size_t height = encoderType_ == OCCUPANCY ? gof->mapHeightDSGOF : gof->mapHeightGOF;
-    setKvazaarConfig(api, config, width, height, encoderType_);
+
+    // The frames of a GOF are encoded in order by chained jobs, so a stream is never accessed by two threads at the same time. Only the
+    // stream map itself is shared between the GOFs.
+    Stream* stream = nullptr;
+    {
+        const std::lock_guard<std::mutex> lock(sessionMutex_);
+        stream = &streams_[gof->gofId];
+    }
+    if (stream->session.encoder == nullptr) {
+        stream->session = acquireSession(width, height);
+    }
 
     std::vector<std::reference_wrapper<std::vector<uint8_t>>> mapList;
-    setMapList(gof, mapList, encoderType_);
+    setFrameMapList(frame, mapList, encoderType_);
 
     std::vector<uint8_t>& bitstream = getBitstream(gof, encoderType_);
+    for (const auto& map : mapList) {
+        if (encodePictureKvazaar(&map.get(), api_, stream->session.encoder, width, height, bitstream, encoderName_)) {
+            ++stream->frameCountOut;
+        }
+        ++stream->frameCountIn;
+    }
+}
 
-    encodeVideoKvazaar(mapList, api, config, width, height, bitstream, encoderName);
+void EncoderKvazaar::encodeGOFMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof) {
+    const size_t width = encoderType_ == OCCUPANCY ? p_->mapWidth / p_->occupancyMapDSResolution : p_->mapWidth;
+    const size_t height = encoderType_ == OCCUPANCY ? gof->mapHeightDSGOF : gof->mapHeightGOF;
 
-    api->config_destroy(config);
+    std::vector<uint8_t>& bitstream = getBitstream(gof, encoderType_);
+
+    if (p_->frameLevel2DEncoding) {
+        // All the maps of the GOF have already been sent by 'encodeFrameMaps'. Only the pictures in flight remain to be drained.
+        Stream stream;
+        {
+            const std::lock_guard<std::mutex> lock(sessionMutex_);
+            auto it = streams_.find(gof->gofId);
+            assert(it != streams_.end());
+            stream = it->second;
+            streams_.erase(it);
+        }
+        const SessionGuard guard(*this, stream.session);
+        while (stream.frameCountOut < stream.frameCountIn) {
+            if (encodePictureKvazaar(nullptr, api_, guard.session.encoder, width, height, bitstream, encoderName_)) {
+                ++stream.frameCountOut;
+            }
+        }
+    } else {
+        std::vector<std::reference_wrapper<std::vector<uint8_t>>> mapList;
+        setMapList(gof, mapList, encoderType_);
+
+        SessionGuard guard(*this, acquireSession(width, height));
+        encodeVideoKvazaar(mapList, api_, guard.session.encoder, width, height, bitstream, encoderName_);
+    }
 
     if (p_->exportIntermediateFiles) {
         switch (encoderType_) {
@@ -37,18 +37,78 @@
 
 #include <kvazaar.h>
 
+#include <exception>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "uvgvpcc/uvgvpcc.hpp"
 #include "abstract2DMapEncoder.hpp"
 
 using namespace uvgvpcc_enc;
 
 
+// The Kvazaar sessions (parsed configuration and opened encoder) are kept from one GOF to the next. A session is only reconfigured when the
+// map height of the GOF changes. When the encoding mode allows it (AI), the encoder itself stays open, so that its setup cost is paid once
+// per stream instead of once per GOF. Several sessions can exist at the same time, as several GOFs can be encoded in parallel.
+// With 'frameLevel2DEncoding', a session is attached to its GOF from the first frame sent to the encoder until the GOF video is completed.
 class EncoderKvazaar : public Abstract2DMapEncoder {
 public:
-    EncoderKvazaar(const ENCODER_TYPE& encoderType) : Abstract2DMapEncoder(encoderType) {};
+    EncoderKvazaar(const ENCODER_TYPE& encoderType);
+    ~EncoderKvazaar() override;
     static void initializeLogCallback();
     void encodeGOFMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof) override;
+    void encodeFrameMaps(const std::shared_ptr<uvgvpcc_enc::Frame>& frame) override;
+    bool keepsStateAcrossGOFs() const override { return keepEncoderOpen_; }
+
+private:
+    struct Session {
+        kvz_config* config = nullptr;
+        kvz_encoder* encoder = nullptr;
+        size_t height = 0;
+    };
+
+    // Session of a GOF being encoded frame by frame ('frameLevel2DEncoding').
+    struct Stream {
+        Session session;
+        size_t frameCountIn = 0;
+        size_t frameCountOut = 0;
+    };
+
+    // Give a session back to the pool at the end of its scope. When the scope is left by an exception, the session is in an unknown state
+    // (pictures may be in flight), so it is destroyed instead.
+    class SessionGuard {
+       public:
+        SessionGuard(EncoderKvazaar& owner, const Session& session)
+            : session(session), owner_(owner), uncaughtExceptions_(std::uncaught_exceptions()) {}
+        ~SessionGuard() {
+            if (std::uncaught_exceptions() > uncaughtExceptions_) {
+                owner_.destroySession(session);
+            } else {
+                owner_.releaseSession(session);
+            }
+        }
+        SessionGuard(const SessionGuard&) = delete;
+        SessionGuard& operator=(const SessionGuard&) = delete;
+
+        Session session;
+
+       private:
+        EncoderKvazaar& owner_;
+        int uncaughtExceptions_;
+    };
+
+    Session acquireSession(const size_t& width, const size_t& height);
+    void releaseSession(Session& session);
+    void destroySession(Session& session);
 
+    kvz_api* api_;
+    std::string encoderName_;  // For log and debug
+    bool keepEncoderOpen_;
+    std::mutex sessionMutex_;
+    std::vector<Session> idleSessions_;
+    std::unordered_map<size_t, Stream> streams_;  // Key is the GOF id
 };
 
 
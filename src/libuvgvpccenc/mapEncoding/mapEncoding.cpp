@@ -46,20 +46,13 @@
 #include "encoderFFmpeg.hpp"  // Include FFmepg
 #endif
 
+#include "utils/encoderContext.hpp"
 #include "utils/parameters.hpp"
 #include "uvgutils/log.hpp"
 #include "uvgvpcc/uvgvpcc.hpp"
 
 using namespace uvgvpcc_enc;
 
-namespace {
-
-std::unique_ptr<Abstract2DMapEncoder> occupancyMapDSEncoder;
-std::unique_ptr<Abstract2DMapEncoder> geometryMapEncoder;
-std::unique_ptr<Abstract2DMapEncoder> attributeMapEncoder;
-
-}  // anonymous namespace
-
 void MapEncoding::initializeStaticParameters() {
     if (p_->occupancyEncoderName == "Kvazaar" || p_->geometryEncoderName == "Kvazaar" || p_->attributeEncoderName == "Kvazaar") {
         EncoderKvazaar::initializeLogCallback();
@@ -73,6 +66,11 @@ void MapEncoding::initializeStaticParameters() {
 }
 
 void MapEncoding::initializeEncoderPointers() {
+    // The 2D encoders are owned by the encoder context, so that each encoder instance has its own 2D encoder sessions.
+    auto& occupancyMapDSEncoder = currentContext->occupancyMapDSEncoder;
+    auto& geometryMapEncoder = currentContext->geometryMapEncoder;
+    auto& attributeMapEncoder = currentContext->attributeMapEncoder;
+
     if (p_->occupancyEncoderName == "Kvazaar") {
         occupancyMapDSEncoder = std::make_unique<EncoderKvazaar>(OCCUPANCY);
 #if LINK_FFMPEG
@@ -107,10 +105,35 @@ void MapEncoding::initializeEncoderPointers() {
     }
 }
 
-void MapEncoding::encodeGOFMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof) {
-    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("MAP ENCODING", "Encode maps of GOF " + std::to_string(gof->gofId) + ".\n");
+void MapEncoding::encodeGOFOccupancyMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof) {
+    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("MAP ENCODING", "Encode occupancy maps of GOF " + std::to_string(gof->gofId) + ".\n");
+    currentContext->occupancyMapDSEncoder->encodeGOFMaps(gof);
+}
+
+void MapEncoding::encodeGOFGeometryMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof) {
+    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("MAP ENCODING", "Encode geometry maps of GOF " + std::to_string(gof->gofId) + ".\n");
+    currentContext->geometryMapEncoder->encodeGOFMaps(gof);
+}
+
+void MapEncoding::encodeGOFAttributeMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof) {
+    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("MAP ENCODING", "Encode attribute maps of GOF " + std::to_string(gof->gofId) + ".\n");
+    currentContext->attributeMapEncoder->encodeGOFMaps(gof);
+}
+
+void MapEncoding::encodeFrameOccupancyMaps(const std::shared_ptr<uvgvpcc_enc::Frame>& frame) {
+    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("MAP ENCODING",
+                                                     "Encode occupancy maps of frame " + std::to_string(frame->frameId) + ".\n");
+    currentContext->occupancyMapDSEncoder->encodeFrameMaps(frame);
+}
+
+void MapEncoding::encodeFrameGeometryMaps(const std::shared_ptr<uvgvpcc_enc::Frame>& frame) {
+    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("MAP ENCODING",
+                                                     "Encode geometry maps of frame " + std::to_string(frame->frameId) + ".\n");
+    currentContext->geometryMapEncoder->encodeFrameMaps(frame);
+}
 
-    occupancyMapDSEncoder->encodeGOFMaps(gof);
-    geometryMapEncoder->encodeGOFMaps(gof);
-    attributeMapEncoder->encodeGOFMaps(gof);
+void MapEncoding::encodeFrameAttributeMaps(const std::shared_ptr<uvgvpcc_enc::Frame>& frame) {
+    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("MAP ENCODING",
+                                                     "Encode attribute maps of frame " + std::to_string(frame->frameId) + ".\n");
+    currentContext->attributeMapEncoder->encodeFrameMaps(frame);
 }
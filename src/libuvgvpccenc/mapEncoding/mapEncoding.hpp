@@ -37,5 +37,12 @@
 namespace MapEncoding {
 void initializeStaticParameters();
 void initializeEncoderPointers();
-void encodeGOFMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof);
+// The three videos are independent. Each one is encoded by its own job.
+void encodeGOFOccupancyMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof);
+void encodeGOFGeometryMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof);
+void encodeGOFAttributeMaps(const std::shared_ptr<uvgvpcc_enc::GOF>& gof);
+// Frame-level encoding. The maps of a frame are sent to the 2D encoders as soon as they are generated.
+void encodeFrameOccupancyMaps(const std::shared_ptr<uvgvpcc_enc::Frame>& frame);
+void encodeFrameGeometryMaps(const std::shared_ptr<uvgvpcc_enc::Frame>& frame);
+void encodeFrameAttributeMaps(const std::shared_ptr<uvgvpcc_enc::Frame>& frame);
 }; // namespace MapEncoding
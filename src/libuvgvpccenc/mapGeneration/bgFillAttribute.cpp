@@ -43,6 +43,7 @@
 #include <stdexcept>
 #include <vector>
 
+#include "utils/occupancyBitmap.hpp"
 #include "utils/parameters.hpp"
 #include "uvgvpcc/uvgvpcc.hpp"
 
@@ -217,10 +218,11 @@ void pushPullFill(std::vector<uint8_t>& image, const size_t& width, const size_t
     }
 }
 
-void bgFillAttributePushPull(const std::vector<uint8_t>& occupancyMap, const size_t& gofMapsHeight, std::vector<uint8_t>& attributeMap) {
+void bgFillAttributePushPull(const OccupancyBitmap& occupancyMap, const size_t& gofMapsHeight, std::vector<uint8_t>& attributeMap) {
     // Algorithm from TMC2 (dilateSmoothedPushPull), slight modifications in the implementation //
 
-    auto occupancyMapTemp = occupancyMap;
+    std::vector<uint8_t> occupancyMapTemp;
+    occupancyMap.toBytes(occupancyMapTemp);
 
     int i = 0;
     std::vector<std::vector<uint8_t>> mipVec;
@@ -480,10 +482,7 @@ void attributeBgFillBBPE(uvgvpcc_enc::Frame& frame, std::vector<uint8_t>& attrib
             // Phase 2: Count full-res occupancy
             size_t occupiedPixelCount = 0;
             for (size_t j = 0; j < blockSize; ++j) {
-                const size_t rowOffset = (yBBPE_Pixel_offset + j) * mapWidth + xBBPE_Pixel_offset;
-                for (size_t i = 0; i < blockSize; ++i) {
-                    occupiedPixelCount += (*frame.occupancyMap)[rowOffset + i];
-                }
+                occupiedPixelCount += frame.occupancyMap->countInRow(xBBPE_Pixel_offset, yBBPE_Pixel_offset + j, blockSize);
             }
 
             if (occupiedPixelCount == fullBlockPixelCount) {
@@ -502,11 +501,10 @@ void attributeBgFillBBPE(uvgvpcc_enc::Frame& frame, std::vector<uint8_t>& attrib
             // Initialization
             for (size_t j = 0; j < blockSize; ++j) {
                 const size_t y = yBBPE_Pixel_offset + j;
-                const size_t yStride = y * mapWidth;
                 for (size_t i = 0; i < blockSize; ++i) {
                     const size_t x = xBBPE_Pixel_offset + i;
                     const size_t loc = i + j * blockSize;
-                    iterations[loc] = (*frame.occupancyMap)[x + yStride];
+                    iterations[loc] = static_cast<uint8_t>(frame.occupancyMap->test(x, y));
                 }
             }
 
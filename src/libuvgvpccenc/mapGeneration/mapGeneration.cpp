@@ -49,6 +49,7 @@
 #include "bgFillAttribute.hpp"
 #include "bgFillGeometry.hpp"
 #include "utils/fileExport.hpp"
+#include "utils/occupancyBitmap.hpp"
 #include "utils/parameters.hpp"
 #include "uvgutils/log.hpp"
 #include "uvgutils/utils.hpp"
@@ -60,60 +61,34 @@ namespace {
 
 // lf: Notice that the current implementation of the occupancy map refinement does not remove the involved points from their patch.
 template <uint8_t occBlkSize>
-void occupancyMapDownscaling(const size_t& mapHeight, std::vector<uint8_t>& occupancyMap, std::vector<uint8_t>& occupancyMapDS) {
-    const size_t mapWidth = p_->mapWidth;
+void occupancyMapDownscaling(const size_t& mapHeight, OccupancyBitmap& occupancyMap, std::vector<uint8_t>& occupancyMapDS) {
+    static_assert(occBlkSize == 2 || occBlkSize == 4, "Unsupported block size for occupancy map downscaling");
+    const size_t mapWidthDS = p_->mapWidth / occBlkSize;
+    const size_t mapHeightDS = mapHeight / occBlkSize;
+    const size_t treshold = occBlkSize == 2 ? p_->omRefinementTreshold2 : p_->omRefinementTreshold4;
 
-    uint8_t* occMap = occupancyMap.data();
     uint8_t* occMapDS = occupancyMapDS.data();
-    if constexpr (occBlkSize == 2) {
-        const size_t mapWidthDS = mapWidth >> 1U;
-        const size_t mapHeightDS = mapHeight >> 1U;
-        for (size_t yDS = 0; yDS < mapHeightDS; ++yDS) {
-            const size_t yOffset = (yDS * mapWidth) << 1U;
-            for (size_t xDS = 0; xDS < mapWidthDS; ++xDS) {
-                const size_t xOffset = xDS << 1U;
-                uint8_t* blockPtr = occMap + yOffset + xOffset;
-
-                const uint8_t sum = blockPtr[0] + blockPtr[1] + blockPtr[mapWidth] + blockPtr[mapWidth + 1];
-
-                if (sum >= p_->omRefinementTreshold2) {
-                    occMapDS[yDS * mapWidthDS + xDS] = 1U;
-                } else {
-                    occMapDS[yDS * mapWidthDS + xDS] = 0U;
-                    // Update the occupancy map (lf: usefull for BBPE attribute background filling)
-                    std::fill_n(blockPtr, 2, 0U);
-                    std::fill_n(blockPtr + mapWidth, 2, 0U);
-                }
+    for (size_t yDS = 0; yDS < mapHeightDS; ++yDS) {
+        const size_t y = yDS * occBlkSize;
+        for (size_t xDS = 0; xDS < mapWidthDS; ++xDS) {
+            const size_t x = xDS * occBlkSize;
+
+            // The occupancy map rows are bit-packed, so the pixels of each block row are counted at once
+            size_t sum = 0;
+            for (size_t blockY = 0; blockY < occBlkSize; ++blockY) {
+                sum += occupancyMap.countInRow(x, y + blockY, occBlkSize);
             }
-        }
-    } else if constexpr (occBlkSize == 4) {
-        const size_t mapWidthDS = mapWidth >> 2U;
-        const size_t mapHeightDS = mapHeight >> 2U;
-        for (size_t yDS = 0; yDS < mapHeightDS; ++yDS) {
-            const size_t yOffset = (yDS * mapWidth) << 2U;
-            for (size_t xDS = 0; xDS < mapWidthDS; ++xDS) {
-                const size_t xOffset = xDS << 2U;
-                uint8_t* blockPtr = occMap + yOffset + xOffset;
-
-                const uint8_t sum = blockPtr[0] + blockPtr[1] + blockPtr[2] + blockPtr[3] + blockPtr[mapWidth] + blockPtr[mapWidth + 1] +
-                                    blockPtr[mapWidth + 2] + blockPtr[mapWidth + 3] + blockPtr[2 * mapWidth] + blockPtr[2 * mapWidth + 1] +
-                                    blockPtr[2 * mapWidth + 2] + blockPtr[2 * mapWidth + 3] + blockPtr[3 * mapWidth] +
-                                    blockPtr[3 * mapWidth + 1] + blockPtr[3 * mapWidth + 2] + blockPtr[3 * mapWidth + 3];
-
-                if (sum >= p_->omRefinementTreshold4) {
-                    occMapDS[yDS * mapWidthDS + xDS] = 1U;
-                } else {
-                    occMapDS[yDS * mapWidthDS + xDS] = 0U;
-                    // Update the occupancy map (lf: usefull for BBPE attribute background filling)
-                    std::fill_n(blockPtr, 4, 0U);
-                    std::fill_n(blockPtr + 1 * mapWidth, 4, 0U);
-                    std::fill_n(blockPtr + 2 * mapWidth, 4, 0U);
-                    std::fill_n(blockPtr + 3 * mapWidth, 4, 0U);
+
+            if (sum >= treshold) {
+                occMapDS[yDS * mapWidthDS + xDS] = 1U;
+            } else {
+                occMapDS[yDS * mapWidthDS + xDS] = 0U;
+                // Update the occupancy map (lf: usefull for BBPE attribute background filling)
+                for (size_t blockY = 0; blockY < occBlkSize; ++blockY) {
+                    occupancyMap.clearRow(x, y + blockY, occBlkSize);
                 }
             }
         }
-    } else {
-        assert(false && "Unsupported block size for occupancy map downscaling");
     }
 }
 
@@ -208,7 +183,7 @@ void allocateMaps(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const size_t
     // TODO(lf): is it necessary ? Yes if resizing due to bigger occupancy map (larger than minimumHeight parameter)
     // assert(frame->occupancyMap.size() <= imageSize); //TODO(lf) there is a bug here
     if (frame->occupancyMap->size() != imageSize) {
-        frame->occupancyMap->resize(imageSize, 0);
+        frame->occupancyMap->resize(p_->mapWidth, gofMapsHeight);
     }
 
     if (p_->exportIntermediateFiles) {
@@ -52,6 +52,21 @@ void KdTree::knn(const uvgutils::VectorN<typeGeometryInput, 3>& queryPoint, cons
     index_->index->findNeighbors(resultSet, queryPointDouble);
 }
 
+// Search the nearest neighbors of the query points [begin, end). The indices are written in the flat list 'nnIndices', at the offset
+// 'queryIndex * nnCount'. The distance buffer is shared by all the searches of the batch.
+void KdTree::knnBatch(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& queryPoints, const size_t begin, const size_t end,
+                      const size_t nnCount, uint32_t* nnIndices) const {
+    std::vector<int16_t> out_dists_sqr(nnCount);
+    for (size_t queryIndex = begin; queryIndex < end; ++queryIndex) {
+        nanoflann::KNNResultSet<int16_t, uint32_t, size_t> resultSet(nnCount);
+        resultSet.init(&nnIndices[queryIndex * nnCount], out_dists_sqr.data());
+        const uvgutils::VectorN<typeGeometryInput, 3>& queryPoint = queryPoints[queryIndex];
+        const double queryPointDouble[3] = {static_cast<double>(queryPoint[0]), static_cast<double>(queryPoint[1]),
+                                            static_cast<double>(queryPoint[2])};
+        index_->index->findNeighbors(resultSet, queryPointDouble);
+    }
+}
+
 // TODO(lf)check with tmc2 if squared or not distance is necessary (should change power 2 the parameter instead of computing square root of
 // every distance)
 void KdTree::knnDist(const uvgutils::VectorN<typeGeometryInput, 3>& queryPoint, const size_t nnCount,
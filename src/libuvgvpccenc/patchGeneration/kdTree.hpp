@@ -40,13 +40,16 @@
 
 using namespace uvgvpcc_enc;
 
+// The point indices are stored on 32 bits, like in the neighbor lists.
 using nanoflannAdaptorType =
-    KDTreeVectorOfVectorsAdaptor<std::vector<uvgutils::VectorN<typeGeometryInput, 3>>, double, 3, nanoflann::metric_L2_Simple, size_t>;
+    KDTreeVectorOfVectorsAdaptor<std::vector<uvgutils::VectorN<typeGeometryInput, 3>>, double, 3, nanoflann::metric_L2_Simple, uint32_t>;
 
 class KdTree {
    public:
     KdTree(const size_t& kdTreeMaxLeafSize, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry);
     void knn(const uvgutils::VectorN<typeGeometryInput, 3>& queryPoint, const size_t nnCount, std::vector<size_t>& nnIndices) const;
+    void knnBatch(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& queryPoints, const size_t begin, const size_t end,
+                  const size_t nnCount, uint32_t* nnIndices) const;
     void knnDist(const uvgutils::VectorN<typeGeometryInput, 3>& queryPoint, const size_t nnCount, std::vector<int16_t>& out_dists_sqr) const;
 
     /*void knnRadius(const uvgutils::VectorN<typeGeometryInput, 3>& queryPoint, const int16_t maxNNCount, const uint16_t radius,
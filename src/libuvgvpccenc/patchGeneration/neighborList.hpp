@@ -0,0 +1,77 @@
+/*****************************************************************************
+ * This file is part of uvgVPCCenc V-PCC encoder.
+ *
+ * Copyright (c) 2024-present, Tampere University, ITU/ISO/IEC, project contributors
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ * 
+ * * Neither the name of the Tampere University or ITU/ISO/IEC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+ ****************************************************************************/
+
+
+/// \file Flat storage of the nearest neighbors of all the points of a frame.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// A stride of 0 means that the number of neighbors per point is only known at run time.
+constexpr size_t dynamicNNCount = 0;
+
+// The neighbors of the point 'i' are stored in a single buffer, at [i * stride, (i + 1) * stride). Compared to one vector per point, there is
+// a single allocation and the lists of consecutive points are contiguous in memory. The indices are stored on 32 bits.
+// When the number of neighbors is known at compile time (K != dynamicNNCount), the stride is a constant and the loops of the consumers
+// can be unrolled.
+template <size_t K = dynamicNNCount>
+class NeighborList {
+   public:
+    using IndexType = uint32_t;
+
+    NeighborList(const size_t pointCount, const size_t nnCount) : stride_(K == dynamicNNCount ? nnCount : K) {
+        if (K != dynamicNNCount && nnCount != K) {
+            throw std::runtime_error("NeighborList: the number of neighbors (" + std::to_string(nnCount) +
+                                     ") does not match the compile time stride (" + std::to_string(K) + ").");
+        }
+        if (pointCount > std::numeric_limits<IndexType>::max()) {
+            throw std::runtime_error("NeighborList: the number of points (" + std::to_string(pointCount) +
+                                     ") can not be indexed on 32 bits.");
+        }
+        indices_.resize(pointCount * stride_);
+    }
+
+    size_t stride() const { return K == dynamicNNCount ? stride_ : K; }
+
+    const IndexType* operator[](const size_t pointIndex) const { return &indices_[pointIndex * stride()]; }
+    IndexType* data() { return indices_.data(); }
+
+   private:
+    size_t stride_;
+    std::vector<IndexType> indices_;
+};
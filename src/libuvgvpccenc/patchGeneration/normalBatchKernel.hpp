@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * This file is part of uvgVPCCenc V-PCC encoder.
+ *
+ * Copyright (c) 2024-present, Tampere University, ITU/ISO/IEC, project contributors
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ * 
+ * * Neither the name of the Tampere University or ITU/ISO/IEC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+ ****************************************************************************/
+
+
+/// \file Batched SIMD kernels computing the normals of several points at once.
+
+#pragma once
+
+#include <cstddef>
+
+// The kernels process 'batchSize' points at once, stored in a structure of arrays (SoA) layout: the coordinate 'c' (0 for x, 1 for y, 2 for
+// z) of the lane 'l' is at [c * batchSize + l]. The neighbor 'i' of each lane is at 'neighbors[(i * 3 + c) * batchSize + l]'. The first
+// neighbor is the one used as the first term of the covariance, like in the scalar implementation. The normals are written with the same
+// layout as the points.
+//
+// The kernels reproduce exactly the operations of the scalar implementation (same double precision operations in the same order, and the
+// same early termination of the Jacobi iterations, lane by lane), so that the normals are bit-exact whatever the kernel used. The
+// 'normalComputationKernel' parameter forces a kernel, which lets the tests check each of them against the reference bitstreams.
+//
+// This header and the kernel files do not use the standard library, as they are compiled with their own instruction set.
+namespace NormalBatchKernel {
+
+constexpr size_t batchSize = 8;
+
+using KernelFunction = void (*)(const double* points, const double* neighbors, size_t nnCount, size_t maxSteps, double* normals);
+
+void computeNormalsAvx2(const double* points, const double* neighbors, size_t nnCount, size_t maxSteps, double* normals);
+void computeNormalsAvx512(const double* points, const double* neighbors, size_t nnCount, size_t maxSteps, double* normals);
+
+}  // namespace NormalBatchKernel
@@ -0,0 +1,237 @@
+/*****************************************************************************
+ * This file is part of uvgVPCCenc V-PCC encoder.
+ *
+ * Copyright (c) 2024-present, Tampere University, ITU/ISO/IEC, project contributors
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ * 
+ * * Neither the name of the Tampere University or ITU/ISO/IEC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+ ****************************************************************************/
+
+
+/// \file Instruction set independent implementation of the batched normal computation kernel.
+
+// Included by the kernel file of each instruction set, after the definition of the vector operations 'V':
+// Vec, Mask, width, load, store, set1, add, sub, mul, div, sqrt, abs, gt, lt, eq, select (first value where the mask is set), maskAnd,
+// maskAndNot (not first and second), maskAll, any.
+// Everything is in an anonymous namespace, so that nothing compiled for a given instruction set can be picked by the linker for another
+// translation unit.
+
+#pragma once
+
+#include <cstddef>
+
+#include "normalBatchKernel.hpp"
+
+namespace {
+
+// Same operations as 'computeNormal', 'computeCovMat' and 'diagonalize' of normalComputation.cpp, on 'V::width' lanes.
+// NOLINTBEGIN(readability-function-size)
+template <typename V>
+void computeNormalLanes(const double* points, const double* neighbors, const size_t nnCount, const size_t maxSteps, double* normals,
+                        const size_t lane) {
+    using Vec = typename V::Vec;
+    using Mask = typename V::Mask;
+    constexpr size_t bs = NormalBatchKernel::batchSize;
+    const Vec zero = V::set1(0.0);
+    const Vec one = V::set1(1.0);
+    const Vec two = V::set1(2.0);
+    const Vec minusOne = V::set1(-1.0);
+
+    // Barycenter. The first point returned by the KNN is the query point, which is the initial value of the barycenter.
+    Vec bx = V::load(&points[0 * bs + lane]);
+    Vec by = V::load(&points[1 * bs + lane]);
+    Vec bz = V::load(&points[2 * bs + lane]);
+    for (size_t i = 1; i < nnCount; ++i) {
+        bx = V::add(bx, V::load(&neighbors[(i * 3 + 0) * bs + lane]));
+        by = V::add(by, V::load(&neighbors[(i * 3 + 1) * bs + lane]));
+        bz = V::add(bz, V::load(&neighbors[(i * 3 + 2) * bs + lane]));
+    }
+    const Vec count = V::set1(static_cast<double>(nnCount));
+    bx = V::div(bx, count);
+    by = V::div(by, count);
+    bz = V::div(bz, count);
+
+    // Covariance matrix (upper triangle)
+    Vec a00 = zero;
+    Vec a01 = zero;
+    Vec a02 = zero;
+    Vec a11 = zero;
+    Vec a12 = zero;
+    Vec a22 = zero;
+    for (size_t i = 0; i < nnCount; ++i) {
+        const Vec px = V::sub(V::load(&neighbors[(i * 3 + 0) * bs + lane]), bx);
+        const Vec py = V::sub(V::load(&neighbors[(i * 3 + 1) * bs + lane]), by);
+        const Vec pz = V::sub(V::load(&neighbors[(i * 3 + 2) * bs + lane]), bz);
+        a00 = V::add(a00, V::mul(px, px));
+        a11 = V::add(a11, V::mul(py, py));
+        a22 = V::add(a22, V::mul(pz, pz));
+        a01 = V::add(a01, V::mul(px, py));
+        a02 = V::add(a02, V::mul(px, pz));
+        a12 = V::add(a12, V::mul(py, pz));
+    }
+    const Vec countMinusOne = V::set1(static_cast<double>(nnCount) - 1.0);
+    a00 = V::div(a00, countMinusOne);
+    a01 = V::div(a01, countMinusOne);
+    a02 = V::div(a02, countMinusOne);
+    a11 = V::div(a11, countMinusOne);
+    a12 = V::div(a12, countMinusOne);
+    a22 = V::div(a22, countMinusOne);
+
+    // Jacobi diagonalization. A lane stops being updated at the iteration where the scalar implementation breaks.
+    Vec q0 = zero;
+    Vec q1 = zero;
+    Vec q2 = zero;
+    Vec q3 = one;
+    Vec jr0 = zero;
+    Vec jr1 = zero;
+    Vec jr2 = zero;
+    Vec Q00 = zero;
+    Vec Q01 = zero;
+    Vec Q02 = zero;
+    Vec Q10 = zero;
+    Vec Q11 = zero;
+    Vec Q12 = zero;
+    Vec Q20 = zero;
+    Vec Q21 = zero;
+    Vec Q22 = zero;
+    Vec D00 = zero;
+    Vec D11 = zero;
+    Vec D22 = zero;
+    Mask active = V::maskAll();
+
+    for (size_t step = 0; step < maxSteps && V::any(active); ++step) {
+        // quat to matrix
+        const Vec sqx = V::mul(q0, q0);
+        const Vec sqy = V::mul(q1, q1);
+        const Vec sqz = V::mul(q2, q2);
+        const Vec sqw = V::mul(q3, q3);
+        const Vec nQ00 = V::add(V::sub(V::sub(sqx, sqy), sqz), sqw);
+        const Vec nQ11 = V::add(V::sub(V::sub(sqy, sqx), sqz), sqw);  // -sqx + sqy is exactly sqy - sqx
+        const Vec nQ22 = V::add(V::sub(sqz, V::add(sqx, sqy)), sqw);  // -sqx - sqy + sqz is exactly sqz - (sqx + sqy)
+        Vec tmp1 = V::mul(q0, q1);
+        Vec tmp2 = V::mul(q2, q3);
+        const Vec nQ10 = V::mul(two, V::add(tmp1, tmp2));
+        const Vec nQ01 = V::mul(two, V::sub(tmp1, tmp2));
+        tmp1 = V::mul(q0, q2);
+        tmp2 = V::mul(q1, q3);
+        const Vec nQ20 = V::mul(two, V::sub(tmp1, tmp2));
+        const Vec nQ02 = V::mul(two, V::add(tmp1, tmp2));
+        tmp1 = V::mul(q1, q2);
+        tmp2 = V::mul(q0, q3);
+        const Vec nQ21 = V::mul(two, V::add(tmp1, tmp2));
+        const Vec nQ12 = V::mul(two, V::sub(tmp1, tmp2));
+
+        // AQ = A * Q;
+        const Vec AQ00 = V::add(V::add(V::mul(nQ00, a00), V::mul(nQ10, a01)), V::mul(nQ20, a02));
+        const Vec AQ01 = V::add(V::add(V::mul(nQ01, a00), V::mul(nQ11, a01)), V::mul(nQ21, a02));
+        const Vec AQ02 = V::add(V::add(V::mul(nQ02, a00), V::mul(nQ12, a01)), V::mul(nQ22, a02));
+        const Vec AQ10 = V::add(V::add(V::mul(nQ00, a01), V::mul(nQ10, a11)), V::mul(nQ20, a12));
+        const Vec AQ11 = V::add(V::add(V::mul(nQ01, a01), V::mul(nQ11, a11)), V::mul(nQ21, a12));
+        const Vec AQ12 = V::add(V::add(V::mul(nQ02, a01), V::mul(nQ12, a11)), V::mul(nQ22, a12));
+        const Vec AQ20 = V::add(V::add(V::mul(nQ00, a02), V::mul(nQ10, a12)), V::mul(nQ20, a22));
+        const Vec AQ21 = V::add(V::add(V::mul(nQ01, a02), V::mul(nQ11, a12)), V::mul(nQ21, a22));
+        const Vec AQ22 = V::add(V::add(V::mul(nQ02, a02), V::mul(nQ12, a12)), V::mul(nQ22, a22));
+
+        // D  = Q.transpose() * AQ; (only the used elements)
+        const Vec nD00 = V::add(V::add(V::mul(AQ00, nQ00), V::mul(AQ10, nQ10)), V::mul(AQ20, nQ20));
+        const Vec nD01 = V::add(V::add(V::mul(AQ00, nQ01), V::mul(AQ10, nQ11)), V::mul(AQ20, nQ21));
+        const Vec nD02 = V::add(V::add(V::mul(AQ00, nQ02), V::mul(AQ10, nQ12)), V::mul(AQ20, nQ22));
+        const Vec nD11 = V::add(V::add(V::mul(AQ01, nQ01), V::mul(AQ11, nQ11)), V::mul(AQ21, nQ21));
+        const Vec nD12 = V::add(V::add(V::mul(AQ01, nQ02), V::mul(AQ11, nQ12)), V::mul(AQ21, nQ22));
+        const Vec nD22 = V::add(V::add(V::mul(AQ02, nQ02), V::mul(AQ12, nQ12)), V::mul(AQ22, nQ22));
+
+        // Q and D are the result of the last iteration started by the lane
+        Q00 = V::select(active, nQ00, Q00);
+        Q01 = V::select(active, nQ01, Q01);
+        Q02 = V::select(active, nQ02, Q02);
+        Q10 = V::select(active, nQ10, Q10);
+        Q11 = V::select(active, nQ11, Q11);
+        Q12 = V::select(active, nQ12, Q12);
+        Q20 = V::select(active, nQ20, Q20);
+        Q21 = V::select(active, nQ21, Q21);
+        Q22 = V::select(active, nQ22, Q22);
+        D00 = V::select(active, nD00, D00);
+        D11 = V::select(active, nD11, D11);
+        D22 = V::select(active, nD22, D22);
+
+        // index of largest element of offdiag. k1 = (k0 + 1) % 3 and k2 = (k0 + 2) % 3
+        const Vec m0 = V::abs(nD12);
+        const Vec m1 = V::abs(nD02);
+        const Vec m2 = V::abs(nD01);
+        const Mask isK0 = V::maskAnd(V::gt(m0, m1), V::gt(m0, m2));
+        const Mask isK1 = V::maskAndNot(isK0, V::gt(m1, m2));
+        const Vec ok0 = V::select(isK0, nD12, V::select(isK1, nD02, nD01));
+        const Vec dk1 = V::select(isK0, nD11, V::select(isK1, nD22, nD00));
+        const Vec dk2 = V::select(isK0, nD22, V::select(isK1, nD00, nD11));
+        active = V::maskAndNot(V::eq(ok0, zero), active);  // diagonal already
+
+        Vec thet = V::div(V::sub(dk2, dk1), V::mul(two, ok0));
+        const Vec sgn = V::select(V::gt(thet, zero), one, minusOne);
+        thet = V::mul(thet, sgn);  // make it positive
+        const Vec t = V::div(sgn, V::add(thet, V::select(V::lt(thet, V::set1(1.E6)), V::sqrt(V::add(V::mul(thet, thet), one)), thet)));
+        const Vec c = V::div(one, V::sqrt(V::add(V::mul(t, t), one)));
+        active = V::maskAndNot(V::eq(c, one), active);  // no room for improvement - reached machine precision.
+        Vec jrk0 = V::mul(sgn, V::sqrt(V::div(V::sub(one, c), two)));
+        jrk0 = V::mul(jrk0, minusOne);
+        const Vec jr3 = V::sqrt(V::sub(one, V::mul(jrk0, jrk0)));
+        active = V::maskAndNot(V::eq(jr3, one), active);  // reached limits of floating point precision
+
+        // Only jr[k0] is updated, the two other values are kept from the previous iterations.
+        jr0 = V::select(isK0, jrk0, jr0);
+        jr1 = V::select(isK1, jrk0, jr1);
+        jr2 = V::select(isK0, jr2, V::select(isK1, jr2, jrk0));
+
+        q0 = V::sub(V::add(V::add(V::mul(q3, jr0), V::mul(q0, jr3)), V::mul(q1, jr2)), V::mul(q2, jr1));
+        q1 = V::add(V::add(V::sub(V::mul(q3, jr1), V::mul(q0, jr2)), V::mul(q1, jr3)), V::mul(q2, jr0));
+        q2 = V::add(V::sub(V::add(V::mul(q3, jr2), V::mul(q0, jr1)), V::mul(q1, jr0)), V::mul(q2, jr3));
+        q3 = V::sub(V::sub(V::sub(V::mul(q3, jr3), V::mul(q0, jr0)), V::mul(q1, jr1)), V::mul(q2, jr2));
+        const Vec mq = V::sqrt(V::add(V::add(V::add(V::mul(q0, q0), V::mul(q1, q1)), V::mul(q2, q2)), V::mul(q3, q3)));
+        q0 = V::div(q0, mq);
+        q1 = V::div(q1, mq);
+        q2 = V::div(q2, mq);
+        q3 = V::div(q3, mq);
+    }
+
+    // The normal is the eigenvector of the smallest eigenvalue
+    const Vec absD00 = V::abs(D00);
+    const Vec absD11 = V::abs(D11);
+    const Vec absD22 = V::abs(D22);
+    const Mask isFirst = V::maskAnd(V::lt(absD00, absD11), V::lt(absD00, absD22));
+    const Mask isSecond = V::maskAndNot(isFirst, V::lt(absD11, absD22));
+    V::store(&normals[0 * bs + lane], V::select(isFirst, Q00, V::select(isSecond, Q01, Q02)));
+    V::store(&normals[1 * bs + lane], V::select(isFirst, Q10, V::select(isSecond, Q11, Q12)));
+    V::store(&normals[2 * bs + lane], V::select(isFirst, Q20, V::select(isSecond, Q21, Q22)));
+}
+// NOLINTEND(readability-function-size)
+
+template <typename V>
+void computeNormalBatch(const double* points, const double* neighbors, const size_t nnCount, const size_t maxSteps, double* normals) {
+    for (size_t lane = 0; lane < NormalBatchKernel::batchSize; lane += V::width) {
+        computeNormalLanes<V>(points, neighbors, nnCount, maxSteps, normals, lane);
+    }
+}
+
+}  // anonymous namespace
@@ -0,0 +1,74 @@
+/*****************************************************************************
+ * This file is part of uvgVPCCenc V-PCC encoder.
+ *
+ * Copyright (c) 2024-present, Tampere University, ITU/ISO/IEC, project contributors
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ * 
+ * * Neither the name of the Tampere University or ITU/ISO/IEC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+ ****************************************************************************/
+
+
+/// \file AVX2 version of the batched normal computation kernel. This file is compiled with -mavx2.
+
+#include <immintrin.h>
+
+#include <cstddef>
+
+#include "normalBatchKernel.hpp"
+#include "normalBatchKernel.tpp"
+
+namespace {
+
+struct Avx2 {
+    using Vec = __m256d;
+    using Mask = __m256d;
+    static constexpr size_t width = 4;
+
+    static Vec load(const double* ptr) { return _mm256_loadu_pd(ptr); }
+    static void store(double* ptr, Vec a) { _mm256_storeu_pd(ptr, a); }
+    static Vec set1(double value) { return _mm256_set1_pd(value); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+    static Vec sqrt(Vec a) { return _mm256_sqrt_pd(a); }
+    static Vec abs(Vec a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static Mask gt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static Mask lt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Mask eq(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static Vec select(Mask mask, Vec a, Vec b) { return _mm256_blendv_pd(b, a, mask); }
+    static Mask maskAnd(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+    static Mask maskAndNot(Mask a, Mask b) { return _mm256_andnot_pd(a, b); }
+    static Mask maskAll() { return _mm256_castsi256_pd(_mm256_set1_epi64x(-1)); }
+    static bool any(Mask mask) { return _mm256_movemask_pd(mask) != 0; }
+};
+
+}  // anonymous namespace
+
+void NormalBatchKernel::computeNormalsAvx2(const double* points, const double* neighbors, size_t nnCount, size_t maxSteps,
+                                           double* normals) {
+    computeNormalBatch<Avx2>(points, neighbors, nnCount, maxSteps, normals);
+}
@@ -34,14 +34,17 @@
 
 #include "normalComputation.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "normalBatchKernel.hpp"
 #include "utils/fileExport.hpp"
 #include "utils/parameters.hpp"
 #include "uvgutils/log.hpp"
@@ -52,8 +55,13 @@ using namespace uvgvpcc_enc;
 
 namespace {
 
-void computeCovMat(std::array<uvgutils::VectorN<double, 3>, 3>& covMat, const uvgutils::VectorN<double, 3>& bary, const size_t nnCount,
-                   const std::vector<size_t>& nnIndices, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry) {
+// When N is not dynamicNNCount, the neighbor count is the compile time constant N and the 'nnCount' argument is ignored.
+template <size_t N>
+void computeCovMat(std::array<uvgutils::VectorN<double, 3>, 3>& covMat, const uvgutils::VectorN<double, 3>& bary, size_t nnCount,
+                   const uint32_t* nnIndices, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry) {
+    if constexpr (N != dynamicNNCount) {
+        nnCount = N;
+    }
     uvgutils::VectorN<double, 3> pt;
     for (size_t i = 0; i < nnCount; ++i) {
         pt = pointsGeometry[nnIndices[i]] - bary;
@@ -182,8 +190,12 @@ void diagonalize(const std::array<uvgutils::VectorN<double, 3>, 3>& A, std::arra
 }
 // NOLINTEND(cppcoreguidelines-init-variables)
 
+template <size_t N>
 void computeNormal(uvgutils::VectorN<double, 3>& normal, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                   const uvgutils::VectorN<typeGeometryInput, 3>& point, const std::vector<size_t>& pointNn, const size_t nnCount) {
+                   const uvgutils::VectorN<typeGeometryInput, 3>& point, const uint32_t* pointNn, size_t nnCount) {
+    if constexpr (N != dynamicNNCount) {
+        nnCount = N;
+    }
     uvgutils::VectorN<double, 3> bary{static_cast<double>(point[0]), static_cast<double>(point[1]), static_cast<double>(point[2])};
     for (size_t i = 1; i < nnCount; ++i) {  // The first point return by the KNN is the query point. It is the initial value of bary.
         bary += pointsGeometry[pointNn[i]];
@@ -194,7 +206,7 @@ void computeNormal(uvgutils::VectorN<double, 3>& normal, const std::vector<uvgut
                                                           uvgutils::VectorN<double, 3>(0.0, 0.0, 0.0),
                                                           uvgutils::VectorN<double, 3>(0.0, 0.0, 0.0)};
 
-    computeCovMat(covMat, bary, nnCount, pointNn, pointsGeometry);
+    computeCovMat<N>(covMat, bary, nnCount, pointNn, pointsGeometry);
 
     std::array<uvgutils::VectorN<double, 3>, 3> Q;
     std::array<uvgutils::VectorN<double, 3>, 3> D;
@@ -219,18 +231,129 @@ void computeNormal(uvgutils::VectorN<double, 3>& normal, const std::vector<uvgut
     }
 }
 
+template <size_t N, size_t K>
+void computeNormalsScalar(std::vector<uvgutils::VectorN<double, 3>>& normals,
+                          const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, const NeighborList<K>& pointsNNList,
+                          const size_t nnCount) {
+    for (size_t pointIdx = 0; pointIdx < pointsGeometry.size(); ++pointIdx) {
+        computeNormal<N>(normals[pointIdx], pointsGeometry, pointsGeometry[pointIdx], pointsNNList[pointIdx], nnCount);
+    }
+}
+
+// Gather the points by batches in the SoA layout of the batched kernel (see normalBatchKernel.hpp). In the last batch, the lanes after the
+// last point repeat it.
+template <size_t N, size_t K>
+void computeNormalsBatched(const NormalBatchKernel::KernelFunction kernel, std::vector<uvgutils::VectorN<double, 3>>& normals,
+                           const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, const NeighborList<K>& pointsNNList,
+                           size_t nnCount) {
+    if constexpr (N != dynamicNNCount) {
+        nnCount = N;
+    }
+    constexpr size_t batchSize = NormalBatchKernel::batchSize;
+    std::array<double, 3 * batchSize> batchPoints{};
+    std::array<double, 3 * batchSize> batchNormals{};
+    std::vector<double> batchNeighbors(nnCount * 3 * batchSize);
+    const size_t maxSteps = p_->normalComputationMaxDiagonalStep;
+
+    const size_t pointCount = pointsGeometry.size();
+    for (size_t first = 0; first < pointCount; first += batchSize) {
+        const size_t count = std::min(batchSize, pointCount - first);
+        for (size_t lane = 0; lane < batchSize; ++lane) {
+            const size_t pointIdx = first + std::min(lane, count - 1);
+            const uvgutils::VectorN<typeGeometryInput, 3>& point = pointsGeometry[pointIdx];
+            batchPoints[0 * batchSize + lane] = static_cast<double>(point[0]);
+            batchPoints[1 * batchSize + lane] = static_cast<double>(point[1]);
+            batchPoints[2 * batchSize + lane] = static_cast<double>(point[2]);
+            const uint32_t* pointNn = pointsNNList[pointIdx];
+            for (size_t i = 0; i < nnCount; ++i) {
+                const uvgutils::VectorN<typeGeometryInput, 3>& neighbor = pointsGeometry[pointNn[i]];
+                batchNeighbors[(i * 3 + 0) * batchSize + lane] = static_cast<double>(neighbor[0]);
+                batchNeighbors[(i * 3 + 1) * batchSize + lane] = static_cast<double>(neighbor[1]);
+                batchNeighbors[(i * 3 + 2) * batchSize + lane] = static_cast<double>(neighbor[2]);
+            }
+        }
+
+        kernel(batchPoints.data(), batchNeighbors.data(), nnCount, maxSteps, batchNormals.data());
+
+        for (size_t lane = 0; lane < count; ++lane) {
+            uvgutils::VectorN<double, 3>& normal = normals[first + lane];
+            normal[0] = batchNormals[0 * batchSize + lane];
+            normal[1] = batchNormals[1 * batchSize + lane];
+            normal[2] = batchNormals[2 * batchSize + lane];
+        }
+    }
+}
+
+bool isKernelSupported(const std::string& kernelName) {
+    if (kernelName == "scalar") {
+        return true;
+    }
+#if defined(UVGVPCC_NORMAL_BATCH_KERNELS)
+    __builtin_cpu_init();
+    if (kernelName == "avx512") {
+        return __builtin_cpu_supports("avx512f") != 0;
+    }
+    if (kernelName == "avx2") {
+        return __builtin_cpu_supports("avx2") != 0;
+    }
+#endif
+    return false;
+}
+
+// Return the batched kernel of a resolved kernel name (see NormalComputation::resolveKernel), or nullptr for the scalar implementation.
+NormalBatchKernel::KernelFunction getBatchKernel(const std::string& kernelName) {
+#if defined(UVGVPCC_NORMAL_BATCH_KERNELS)
+    if (kernelName == "avx512") {
+        return &NormalBatchKernel::computeNormalsAvx512;
+    }
+    if (kernelName == "avx2") {
+        return &NormalBatchKernel::computeNormalsAvx2;
+    }
+#endif
+    assert(kernelName == "scalar");
+    return nullptr;
+}
+
 }  // Anonymous namespace
 
 namespace NormalComputation {
 
+std::string resolveKernel(const std::string& kernelName) {
+    if (kernelName != "auto") {
+        return isKernelSupported(kernelName) ? kernelName : "";
+    }
+    for (const std::string candidate : {"avx512", "avx2"}) {
+        if (isKernelSupported(candidate)) {
+            return candidate;
+        }
+    }
+    return "scalar";
+}
+
+template <size_t K>
 void computeNormals(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<uvgutils::VectorN<double, 3>>& normals,
-                    const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                    const std::vector<std::vector<size_t>>& pointsNNList) {
+                    const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, const NeighborList<K>& pointsNNList) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION", "Compute normals of frame " + std::to_string(frame->frameId) + "\n");
     assert(p_->normalComputationKnnCount <= pointsGeometry.size());
+    assert(p_->normalComputationKnnCount <= pointsNNList.stride());
 
-    for (size_t pointIdx = 0; pointIdx < pointsGeometry.size(); ++pointIdx) {
-        computeNormal(normals[pointIdx], pointsGeometry, pointsGeometry[pointIdx], pointsNNList[pointIdx], p_->normalComputationKnnCount);
+    const NormalBatchKernel::KernelFunction batchKernel = getBatchKernel(resolveKernel(p_->normalComputationKernel));
+
+    // Usual case: the neighbor list only holds the neighbors used for the normal computation. The neighbor count is then a constant.
+    const size_t nnCount = p_->normalComputationKnnCount;
+    const bool constantNNCount = K != dynamicNNCount && nnCount == K;
+    if (batchKernel != nullptr) {
+        if (constantNNCount) {
+            computeNormalsBatched<K>(batchKernel, normals, pointsGeometry, pointsNNList, nnCount);
+        } else {
+            computeNormalsBatched<dynamicNNCount>(batchKernel, normals, pointsGeometry, pointsNNList, nnCount);
+        }
+    } else {
+        if (constantNNCount) {
+            computeNormalsScalar<K>(normals, pointsGeometry, pointsNNList, nnCount);
+        } else {
+            computeNormalsScalar<dynamicNNCount>(normals, pointsGeometry, pointsNNList, nnCount);
+        }
     }
 
     if (p_->exportIntermediateFiles) {
@@ -238,4 +361,16 @@ void computeNormals(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vecto
     }
 }
 
+template void computeNormals<6>(const std::shared_ptr<uvgvpcc_enc::Frame>&, std::vector<uvgutils::VectorN<double, 3>>&,
+                                const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>&, const NeighborList<6>&);
+template void computeNormals<8>(const std::shared_ptr<uvgvpcc_enc::Frame>&, std::vector<uvgutils::VectorN<double, 3>>&,
+                                const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>&, const NeighborList<8>&);
+template void computeNormals<9>(const std::shared_ptr<uvgvpcc_enc::Frame>&, std::vector<uvgutils::VectorN<double, 3>>&,
+                                const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>&, const NeighborList<9>&);
+template void computeNormals<12>(const std::shared_ptr<uvgvpcc_enc::Frame>&, std::vector<uvgutils::VectorN<double, 3>>&,
+                                 const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>&, const NeighborList<12>&);
+template void computeNormals<dynamicNNCount>(const std::shared_ptr<uvgvpcc_enc::Frame>&, std::vector<uvgutils::VectorN<double, 3>>&,
+                                             const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>&,
+                                             const NeighborList<dynamicNNCount>&);
+
 }  // namespace NormalComputation
@@ -34,6 +34,9 @@
 
 #pragma once
 
+#include <string>
+
+#include "neighborList.hpp"
 #include "uvgvpcc/uvgvpcc.hpp"
 
 using namespace uvgvpcc_enc;
@@ -41,8 +44,13 @@ using namespace uvgvpcc_enc;
 
 namespace NormalComputation {
 
+// Return the kernel used for the 'normalComputationKernel' parameter value on this CPU: 'auto' gives the widest kernel supported, 'scalar',
+// 'avx2' and 'avx512' give themselves. Return an empty string if the requested kernel is not supported by the CPU or by the build.
+std::string resolveKernel(const std::string& kernelName);
+
+// Instantiated for the neighbor list strides dispatched by PatchGeneration::generateFramePatches.
+template <size_t K>
 void computeNormals(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<uvgutils::VectorN<double, 3>>& normals,
-                    const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                    const std::vector<std::vector<size_t>>& pointsNNList);
+                    const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, const NeighborList<K>& pointsNNList);
 
 }  // namespace NormalComputation
\ No newline at end of file
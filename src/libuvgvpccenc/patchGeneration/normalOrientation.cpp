@@ -35,13 +35,19 @@
 #include "normalOrientation.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
-#include <queue>
+#include <numeric>
 #include <string>
+#include <tuple>
 #include <vector>
 
+#include "utils/encoderContext.hpp"
 #include "utils/fileExport.hpp"
 #include "utils/parameters.hpp"
 #include "utilsPatchGeneration.hpp"
@@ -53,12 +59,17 @@ using namespace uvgvpcc_enc;
 
 namespace NormalOrientation {
 
+namespace {
+
+constexpr size_t orientationBatchSize = 16384;  // Minimum number of points oriented in a single task of the thread pool
+constexpr size_t labellingChunkSize = 65536;    // Number of points handled in a single task of the component labelling
+
 struct WeightedEdge {
     double weight_;
-    size_t start_;  // TODO(lf)be sure it is pc indices
-    size_t end_;
+    uint32_t start_;
+    uint32_t end_;
 
-    explicit WeightedEdge(double w, size_t s, size_t e) : weight_(w), start_(s), end_(e) {};
+    explicit WeightedEdge(double w, uint32_t s, uint32_t e) : weight_(w), start_(s), end_(e) {};
 
     bool operator<(const WeightedEdge& rhs) const {
         if (weight_ == rhs.weight_) {  // TODO(lf): is it really usefull ?
@@ -68,17 +79,67 @@ struct WeightedEdge {
     }
 };
 
-namespace {
-void addNeighborsSeed(const std::vector<uvgutils::VectorN<double, 3>>& normals, const size_t currentIdx,
-                      const std::vector<std::vector<size_t>>& pointsNNList, uvgutils::VectorN<double, 3>& accumulatedNormals,
-                      size_t& numberOfNormals, const size_t nnCount, const std::vector<bool>& visited,
-                      std::priority_queue<WeightedEdge>& edges) {
+// Max priority queue of the propagation edges. The edges are spread over buckets according to their weight, each bucket being a binary heap.
+// As the bucket index never decreases when the weight increases, the top of the highest non-empty bucket is the top of the whole queue. The
+// edges are then popped in the same order as with a single heap, while each push and pop only reorders a small heap.
+class EdgeQueue {
+public:
+    bool empty() const { return size_ == 0; }
+
+    void emplace(const double weight, const uint32_t start, const uint32_t end) {
+        const size_t bucketIdx = bucketIndex(weight);
+        std::vector<WeightedEdge>& bucket = buckets_[bucketIdx];
+        bucket.emplace_back(weight, start, end);
+        std::push_heap(bucket.begin(), bucket.end());
+        topBucket_ = std::max(topBucket_, bucketIdx);
+        ++size_;
+    }
+
+    WeightedEdge pop() {
+        assert(!empty());
+        while (buckets_[topBucket_].empty()) {
+            --topBucket_;
+        }
+        std::vector<WeightedEdge>& bucket = buckets_[topBucket_];
+        std::pop_heap(bucket.begin(), bucket.end());
+        const WeightedEdge edge = bucket.back();
+        bucket.pop_back();
+        --size_;
+        return edge;
+    }
+
+private:
+    static constexpr size_t bucketCount = 256;
+
+    // The weights are absolute cosines between two normals. Most of them are close to one, as neighbor normals are usually almost parallel.
+    // The buckets are therefore thinner near one.
+    static size_t bucketIndex(const double weight) {
+        if (!(weight < 1.0)) {
+            return bucketCount - 1;
+        }
+        if (!(weight > 0.0)) {
+            return 0;
+        }
+        const auto distance = static_cast<size_t>(std::sqrt(1.0 - weight) * static_cast<double>(bucketCount));
+        return bucketCount - 1 - std::min(distance, bucketCount - 1);
+    }
+
+    std::array<std::vector<WeightedEdge>, bucketCount> buckets_;
+    size_t topBucket_ = 0;
+    size_t size_ = 0;
+};
+
+void addNeighborsSeed(const std::vector<uvgutils::VectorN<double, 3>>& normals, const uint32_t currentIdx, const uint32_t* pointNn,
+                      uvgutils::VectorN<double, 3>& accumulatedNormals, size_t& numberOfNormals, const size_t nnCount,
+                      const std::vector<uint8_t>& visited, const std::vector<uint32_t>& componentIds, EdgeQueue& edges) {
     // warning : we use the hypothesis that the knn search always return the query point as the first indexed point (index=0). This query
     // point is always visited at this moment. TODO(lf): this may change in the future
     for (size_t i = 1; i < nnCount; ++i) {  // TODO(lf) use auto or other structure, as the "i" is not used
-        // size_t index = nnIndices[i];
-        size_t const index = pointsNNList[currentIdx][i];
-        if (visited[index]) {
+        const uint32_t index = pointNn[i];
+        if (componentIds[index] != componentIds[currentIdx]) {
+            continue;
+        }
+        if (visited[index] != 0U) {
             accumulatedNormals += normals[index];
             ++numberOfNormals;
         } else {
@@ -87,39 +148,129 @@ void addNeighborsSeed(const std::vector<uvgutils::VectorN<double, 3>>& normals,
     }
 }
 
-void addNeighbors(const std::vector<uvgutils::VectorN<double, 3>>& normals, const size_t currentIdx,
-                  const std::vector<std::vector<size_t>>& pointsNNList, const size_t nnCount, const std::vector<bool>& visited,
-                  std::priority_queue<WeightedEdge>& edges) {
+void addNeighbors(const std::vector<uvgutils::VectorN<double, 3>>& normals, const uint32_t currentIdx, const uint32_t* pointNn,
+                  const size_t nnCount, const std::vector<uint8_t>& visited, const std::vector<uint32_t>& componentIds, EdgeQueue& edges) {
     // warning : we use the hypothesis that the knn search always return the query point as the first indexed point (index=0). This query
     // point is always visited when this function is called. TODO(lf): this may change in the future
     for (size_t i = 1; i < nnCount; ++i) {
-        size_t const index = pointsNNList[currentIdx][i];
-        if (!visited[index]) {
+        const uint32_t index = pointNn[i];
+        // The component is checked first: the 'visited' flags of the other components are written concurrently by other threads.
+        if (componentIds[index] == componentIds[currentIdx] && visited[index] == 0U) {
             edges.emplace(fabs(dotProduct(normals[currentIdx], normals[index])), currentIdx, index);
         }
     }
 }
-}  // anonymous namespace
 
-void orientNormals(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<uvgutils::VectorN<double, 3>>& normals,
-                   const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                   const std::vector<std::vector<size_t>>& pointsNNList) {
-    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION",
-                                                     "Normal orientation of frame " + std::to_string(frame->frameId) + "\n");
+// Root of a point in the concurrent union-find of 'labelComponents', with path halving. A parent always has a smaller index than its child,
+// so the root of a set is its smallest point index. Only the roots are linked, and a point never becomes a root again, so the halving of a
+// non-root point can not conflict with a link.
+uint32_t findRoot(std::vector<std::atomic<uint32_t>>& parents, uint32_t idx) {
+    uint32_t parent = parents[idx].load(std::memory_order_relaxed);
+    while (parent != idx) {
+        const uint32_t grandParent = parents[parent].load(std::memory_order_relaxed);
+        parents[idx].compare_exchange_weak(parent, grandParent, std::memory_order_relaxed);
+        idx = parent;
+        parent = parents[idx].load(std::memory_order_relaxed);
+    }
+    return idx;
+}
+
+// Label the points with the connected components of the (symmetrized) neighbor graph. With spatial blocks, the edges between two blocks are
+// ignored. The components are numbered in increasing order of their first point. Return the number of components.
+//
+// The union-find runs in parallel over chunks of points. A link sets the parent of the greater root to the smaller one with a compare and
+// swap, and is retried if one of the roots got linked meanwhile. The roots, and thus the labels, do not depend on the linking order.
+template <size_t K>
+size_t labelComponents(std::vector<uint32_t>& componentIds, const NeighborList<K>& pointsNNList, const std::vector<uint64_t>& blockIds,
+                       const size_t nnCount) {
+    const size_t pointCount = componentIds.size();
+    const uvgutils::JobManager& jobManager = currentContext->jobManager;
+    const size_t chunkCount = (pointCount + labellingChunkSize - 1) / labellingChunkSize;
 
-    std::vector<bool> visited(pointsGeometry.size());
-    std::fill(visited.begin(), visited.end(), false);
-    std::priority_queue<WeightedEdge> edges;
-    // TODO(lf): may or not be the best data structure for our case. Need some profiling.
+    std::vector<std::atomic<uint32_t>> parents(pointCount);
+    jobManager.parallelFor(pointCount, labellingChunkSize, [&](const size_t begin, const size_t end) {
+        for (size_t pointIdx = begin; pointIdx < end; ++pointIdx) {
+            parents[pointIdx].store(static_cast<uint32_t>(pointIdx), std::memory_order_relaxed);
+        }
+    });
+
+    jobManager.parallelFor(pointCount, labellingChunkSize, [&](const size_t begin, const size_t end) {
+        for (size_t pointIdx = begin; pointIdx < end; ++pointIdx) {
+            const uint32_t* pointNn = pointsNNList[pointIdx];
+            for (size_t i = 1; i < nnCount; ++i) {
+                if (!blockIds.empty() && blockIds[pointIdx] != blockIds[pointNn[i]]) {
+                    continue;
+                }
+                uint32_t rootA = findRoot(parents, static_cast<uint32_t>(pointIdx));
+                uint32_t rootB = findRoot(parents, pointNn[i]);
+                while (rootA != rootB) {
+                    if (rootA < rootB) {
+                        std::swap(rootA, rootB);
+                    }
+                    uint32_t expected = rootA;
+                    if (parents[rootA].compare_exchange_strong(expected, rootB, std::memory_order_relaxed)) {
+                        break;
+                    }
+                    rootA = findRoot(parents, rootA);
+                    rootB = findRoot(parents, rootB);
+                }
+            }
+        }
+    });
+
+    // Number the roots in increasing point order (prefix sum over the chunks), then give each point the number of its root. The root of a
+    // point comes before it, so it is numbered by the first pass.
+    std::vector<size_t> chunkComponentStart(chunkCount);
+    jobManager.parallelFor(pointCount, labellingChunkSize, [&](const size_t begin, const size_t end) {
+        size_t rootCount = 0;
+        for (size_t pointIdx = begin; pointIdx < end; ++pointIdx) {
+            const uint32_t root = findRoot(parents, static_cast<uint32_t>(pointIdx));
+            parents[pointIdx].store(root, std::memory_order_relaxed);
+            rootCount += root == pointIdx ? 1 : 0;
+        }
+        chunkComponentStart[begin / labellingChunkSize] = rootCount;
+    });
+    size_t componentCount = 0;
+    for (size_t& chunkStart : chunkComponentStart) {
+        const size_t rootCount = chunkStart;
+        chunkStart = componentCount;
+        componentCount += rootCount;
+    }
+    jobManager.parallelFor(pointCount, labellingChunkSize, [&](const size_t begin, const size_t end) {
+        auto componentId = static_cast<uint32_t>(chunkComponentStart[begin / labellingChunkSize]);
+        for (size_t pointIdx = begin; pointIdx < end; ++pointIdx) {
+            if (parents[pointIdx].load(std::memory_order_relaxed) == pointIdx) {
+                componentIds[pointIdx] = componentId++;
+            }
+        }
+    });
+    jobManager.parallelFor(pointCount, labellingChunkSize, [&](const size_t begin, const size_t end) {
+        for (size_t pointIdx = begin; pointIdx < end; ++pointIdx) {
+            const uint32_t root = parents[pointIdx].load(std::memory_order_relaxed);
+            if (root != pointIdx) {
+                componentIds[pointIdx] = componentIds[root];
+            }
+        }
+    });
+    return componentCount;
+}
 
-    for (size_t ptIndex = 0; ptIndex < pointsGeometry.size(); ++ptIndex) {
-        if (visited[ptIndex]) {
+// Propagate the orientation over the points of one component. The seeds are taken in increasing point index order, as in a propagation over
+// the whole frame. Without spatial blocks, the result is then the same as the one of a single propagation over all the points.
+template <size_t K>
+void orientComponent(const uint32_t* componentBegin, const uint32_t* componentEnd, std::vector<uvgutils::VectorN<double, 3>>& normals,
+                     const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, const NeighborList<K>& pointsNNList,
+                     const std::vector<uint32_t>& componentIds, std::vector<uint8_t>& visited, EdgeQueue& edges) {
+    const size_t nnCount = p_->normalOrientationKnnCount;
+    for (const uint32_t* ptIt = componentBegin; ptIt != componentEnd; ++ptIt) {
+        const uint32_t ptIndex = *ptIt;
+        if (visited[ptIndex] != 0U) {
             continue;
         }
-        visited[ptIndex] = true;
+        visited[ptIndex] = 1;
         size_t numberOfNormals = 0;
         uvgutils::VectorN<double, 3> accumulatedNormals = {0.0, 0.0, 0.0};
-        addNeighborsSeed(normals, ptIndex, pointsNNList, accumulatedNormals, numberOfNormals, p_->normalOrientationKnnCount, visited, edges);
+        addNeighborsSeed(normals, ptIndex, pointsNNList[ptIndex], accumulatedNormals, numberOfNormals, nnCount, visited, componentIds, edges);
 
         if (numberOfNormals == 0U) {
             // No already visited surrounding points. Serve as seed. Always the first point. Can also be other points when the whole point
@@ -133,22 +284,181 @@ void orientNormals(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector
         }
 
         while (!edges.empty()) {
-            WeightedEdge const edge = edges.top();
-            edges.pop();
-            size_t const current = edge.end_;
-            if (!visited[current]) {
-                visited[current] = true;
+            const WeightedEdge edge = edges.pop();
+            const uint32_t current = edge.end_;
+            if (visited[current] == 0U) {
+                visited[current] = 1;
                 if (dotProduct(normals[edge.start_], normals[current]) < 0.0) {
                     normals[current] = -normals[current];
                 }
-                addNeighbors(normals, current, pointsNNList, p_->normalOrientationKnnCount, visited, edges);
+                addNeighbors(normals, current, pointsNNList[current], nnCount, visited, componentIds, edges);
             }
         }
     }
+}
+
+// Spatial blocks only. The components were oriented independently, so two neighbor components can have opposite orientations. Each component
+// is kept or flipped as a whole. The agreement between two components is the sum of the dot products of their neighbor normals across the
+// block border. The flips are propagated from the first component over the strongest agreements first, like the point orientation itself.
+template <size_t K>
+void reconcileComponents(std::vector<uvgutils::VectorN<double, 3>>& normals, const NeighborList<K>& pointsNNList,
+                         const std::vector<uint32_t>& componentIds, const size_t componentCount) {
+    const size_t nnCount = p_->normalOrientationKnnCount;
+
+    std::vector<std::tuple<uint32_t, uint32_t, double>> borderEdges;
+    for (uint32_t pointIdx = 0; pointIdx < componentIds.size(); ++pointIdx) {
+        const uint32_t* pointNn = pointsNNList[pointIdx];
+        for (size_t i = 1; i < nnCount; ++i) {
+            const uint32_t componentA = componentIds[pointIdx];
+            const uint32_t componentB = componentIds[pointNn[i]];
+            if (componentA != componentB) {
+                borderEdges.emplace_back(std::min(componentA, componentB), std::max(componentA, componentB),
+                                         dotProduct(normals[pointIdx], normals[pointNn[i]]));
+            }
+        }
+    }
+    std::sort(borderEdges.begin(), borderEdges.end());
+
+    // Agreement of each pair of neighbor components, stored in both directions as an adjacency list (CSR)
+    std::vector<std::tuple<uint32_t, uint32_t, double>> agreements;
+    for (const auto& [componentA, componentB, dot] : borderEdges) {
+        if (agreements.empty() || std::get<0>(agreements.back()) != componentA || std::get<1>(agreements.back()) != componentB) {
+            agreements.emplace_back(componentA, componentB, 0.0);
+        }
+        std::get<2>(agreements.back()) += dot;
+    }
+    std::vector<size_t> adjacencyOffsets(componentCount + 1, 0);
+    for (const auto& [componentA, componentB, agreement] : agreements) {
+        ++adjacencyOffsets[componentA + 1];
+        ++adjacencyOffsets[componentB + 1];
+    }
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+    std::vector<std::pair<uint32_t, double>> adjacency(adjacencyOffsets.back());
+    std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (const auto& [componentA, componentB, agreement] : agreements) {
+        adjacency[fill[componentA]++] = {componentB, agreement};
+        adjacency[fill[componentB]++] = {componentA, agreement};
+    }
+
+    std::vector<uint8_t> flipped(componentCount, 0);
+    std::vector<uint8_t> visited(componentCount, 0);
+    EdgeQueue edges;
+    const auto addComponentNeighbors = [&](const uint32_t component) {
+        for (size_t i = adjacencyOffsets[component]; i < adjacencyOffsets[component + 1]; ++i) {
+            if (visited[adjacency[i].first] == 0U) {
+                edges.emplace(std::fabs(adjacency[i].second), component, adjacency[i].first);
+            }
+        }
+    };
+    for (uint32_t seed = 0; seed < componentCount; ++seed) {
+        if (visited[seed] != 0U) {
+            continue;
+        }
+        visited[seed] = 1;
+        addComponentNeighbors(seed);
+        while (!edges.empty()) {
+            const WeightedEdge edge = edges.pop();
+            if (visited[edge.end_] == 0U) {
+                visited[edge.end_] = 1;
+                double agreement = 0.0;
+                for (size_t i = adjacencyOffsets[edge.start_]; i < adjacencyOffsets[edge.start_ + 1]; ++i) {
+                    if (adjacency[i].first == edge.end_) {
+                        agreement = adjacency[i].second;
+                        break;
+                    }
+                }
+                flipped[edge.end_] = static_cast<uint8_t>(flipped[edge.start_] ^ static_cast<uint8_t>(agreement < 0.0));
+                addComponentNeighbors(edge.end_);
+            }
+        }
+    }
+
+    for (uint32_t pointIdx = 0; pointIdx < componentIds.size(); ++pointIdx) {
+        if (flipped[componentIds[pointIdx]] != 0U) {
+            normals[pointIdx] = -normals[pointIdx];
+        }
+    }
+}
+
+}  // anonymous namespace
+
+// The connected components of the neighbor graph do not interact during the propagation. They are oriented in parallel on the library thread
+// pool, several small components being grouped in a single task.
+template <size_t K>
+void orientNormals(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<uvgutils::VectorN<double, 3>>& normals,
+                   const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, const NeighborList<K>& pointsNNList) {
+    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION",
+                                                     "Normal orientation of frame " + std::to_string(frame->frameId) + "\n");
+
+    const size_t pointCount = pointsGeometry.size();
+
+    std::vector<uint64_t> blockIds;
+    if (p_->normalOrientationBlockSize != 0) {
+        const size_t blockSize = p_->normalOrientationBlockSize;
+        blockIds.resize(pointCount);
+        for (size_t pointIdx = 0; pointIdx < pointCount; ++pointIdx) {
+            const uvgutils::VectorN<typeGeometryInput, 3>& point = pointsGeometry[pointIdx];
+            blockIds[pointIdx] = (static_cast<uint64_t>(point[0] / blockSize) << 32U) | (static_cast<uint64_t>(point[1] / blockSize) << 16U) |
+                                 static_cast<uint64_t>(point[2] / blockSize);
+        }
+    }
+
+    std::vector<uint32_t> componentIds(pointCount);
+    const size_t componentCount = labelComponents(componentIds, pointsNNList, blockIds, p_->normalOrientationKnnCount);
+
+    // Points of each component, in increasing index order (CSR)
+    std::vector<uint32_t> componentOffsets(componentCount + 1, 0);
+    for (const uint32_t componentId : componentIds) {
+        ++componentOffsets[componentId + 1];
+    }
+    std::partial_sum(componentOffsets.begin(), componentOffsets.end(), componentOffsets.begin());
+    std::vector<uint32_t> componentPoints(pointCount);
+    {
+        std::vector<uint32_t> fill(componentOffsets.begin(), componentOffsets.end() - 1);
+        for (uint32_t pointIdx = 0; pointIdx < pointCount; ++pointIdx) {
+            componentPoints[fill[componentIds[pointIdx]]++] = pointIdx;
+        }
+    }
+
+    // Group the components in tasks of at least 'orientationBatchSize' points
+    std::vector<size_t> taskOffsets = {0};
+    for (size_t componentId = 0; componentId < componentCount; ++componentId) {
+        if (componentOffsets[componentId + 1] - componentOffsets[taskOffsets.back()] >= orientationBatchSize ||
+            componentId + 1 == componentCount) {
+            taskOffsets.push_back(componentId + 1);
+        }
+    }
+
+    std::vector<uint8_t> visited(pointCount, 0);
+    currentContext->jobManager.parallelFor(taskOffsets.size() - 1, 1, [&](const size_t begin, const size_t end) {
+        EdgeQueue edges;
+        for (size_t taskIdx = begin; taskIdx < end; ++taskIdx) {
+            for (size_t componentId = taskOffsets[taskIdx]; componentId < taskOffsets[taskIdx + 1]; ++componentId) {
+                orientComponent(componentPoints.data() + componentOffsets[componentId], componentPoints.data() + componentOffsets[componentId + 1],
+                                normals, pointsGeometry, pointsNNList, componentIds, visited, edges);
+            }
+        }
+    });
+
+    if (!blockIds.empty()) {
+        reconcileComponents(normals, pointsNNList, componentIds, componentCount);
+    }
 
     if (p_->exportIntermediateFiles) {
         FileExport::exportPointCloudNormalOrientation(frame, pointsGeometry, normals);
     }
 }
 
-}  // namespace NormalOrientation
\ No newline at end of file
+template void orientNormals<6>(const std::shared_ptr<uvgvpcc_enc::Frame>&, std::vector<uvgutils::VectorN<double, 3>>&,
+                               const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>&, const NeighborList<6>&);
+template void orientNormals<8>(const std::shared_ptr<uvgvpcc_enc::Frame>&, std::vector<uvgutils::VectorN<double, 3>>&,
+                               const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>&, const NeighborList<8>&);
+template void orientNormals<9>(const std::shared_ptr<uvgvpcc_enc::Frame>&, std::vector<uvgutils::VectorN<double, 3>>&,
+                               const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>&, const NeighborList<9>&);
+template void orientNormals<12>(const std::shared_ptr<uvgvpcc_enc::Frame>&, std::vector<uvgutils::VectorN<double, 3>>&,
+                                const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>&, const NeighborList<12>&);
+template void orientNormals<dynamicNNCount>(const std::shared_ptr<uvgvpcc_enc::Frame>&, std::vector<uvgutils::VectorN<double, 3>>&,
+                                            const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>&,
+                                            const NeighborList<dynamicNNCount>&);
+
+}  // namespace NormalOrientation
@@ -34,6 +34,7 @@
 
 #pragma once
 
+#include "neighborList.hpp"
 #include "uvgvpcc/uvgvpcc.hpp"
 
 using namespace uvgvpcc_enc;
@@ -41,8 +42,9 @@ using namespace uvgvpcc_enc;
 
 namespace NormalOrientation {
 
+// Instantiated for the neighbor list strides dispatched by PatchGeneration::generateFramePatches.
+template <size_t K>
 void orientNormals(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<uvgutils::VectorN<double, 3>>& normals,
-                   const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                   const std::vector<std::vector<size_t>>& pointsNNList);
+                   const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, const NeighborList<K>& pointsNNList);
 
 }  // namespace NormalOrientation
@@ -50,6 +50,7 @@
 #include "ppiSegmenter.hpp"
 #include "slicingComputation.hpp"
 #include "utils/constants.hpp"
+#include "utils/encoderContext.hpp"
 #include "utils/parameters.hpp"
 #include "utilsPatchGeneration.hpp"
 #include "uvgutils/log.hpp"
@@ -59,26 +60,41 @@
 
 using namespace uvgvpcc_enc;
 
-// TODO(lf): nearestNeighborCount should be static
-void PatchGeneration::computePointsNNList(std::vector<std::vector<size_t>>& pointsNNList,
-                                          const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, const size_t& nnCount) {
+namespace {
+constexpr size_t knnBatchSize = 4096;  // Number of kNN searches in a single task of the thread pool
+}  // anonymous namespace
+
+template <size_t K>
+void PatchGeneration::computePointsNNList(NeighborList<K>& pointsNNList,
+                                          const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION", "computePointsNNList.\n");
 
     KdTree const kdTree(p_->kdTreeMaxLeafSize, pointsGeometry);
 
     // Iterate over all points and find their k Nearest Neighbors //
-    // const size_t nearestNeighborCount = std::max(normalComputationKnnCount_, normalOrientationKnnCount_);
-    pointsNNList.resize(pointsGeometry.size(), std::vector<size_t>(nnCount));
+    // The searches are independent. They are run by batches on the library thread pool, each batch writing its own part of the flat list.
+    const size_t nnCount = pointsNNList.stride();
+    currentContext->jobManager.parallelFor(pointsGeometry.size(), knnBatchSize, [&](const size_t begin, const size_t end) {
+        kdTree.knnBatch(pointsGeometry, begin, end, nnCount, pointsNNList.data());
+    });
+}
 
-    for (size_t ptIndex = 0; ptIndex < pointsGeometry.size(); ++ptIndex) {
-        kdTree.knn(pointsGeometry[ptIndex], nnCount, pointsNNList[ptIndex]);
-    }
+// kdtree init and knn searches, then normal computation & orientation //
+template <size_t K>
+void PatchGeneration::computePointsNormal(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,
+                                          std::vector<uvgutils::VectorN<double, 3>>& pointsNormal,
+                                          const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, const size_t nnCount) {
+    NeighborList<K> pointsNNList(pointsGeometry.size(), nnCount);
+    computePointsNNList(pointsNNList, pointsGeometry);
+
+    NormalComputation::computeNormals(frame, pointsNormal, pointsGeometry, pointsNNList);
+    NormalOrientation::orientNormals(frame, pointsNormal, pointsGeometry, pointsNNList);
 }
 
 // lf : This applyVoxelsDataToPoints function is done in the other direction in TMC2 -> Iterating over the input points, computing the related
 // voxel coords and finding the voxel PPI through a map(voxelCoord, voxelPPI)
 namespace {
-inline void applyVoxelsDataToPoints(const std::vector<size_t>& voxelsPPIs, std::vector<size_t>& pointsPPIs,
+inline void applyVoxelsDataToPoints(const std::vector<typePPI>& voxelsPPIs, std::vector<typePPI>& pointsPPIs,
                                     const std::vector<size_t>& pointsIdToVoxelId) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION", "Apply voxel data to points.\n");    
     for (size_t pointIndex = 0; pointIndex < pointsIdToVoxelId.size(); ++pointIndex) {
@@ -91,6 +107,7 @@ inline void applyVoxelsDataToPoints(const std::vector<size_t>& voxelsPPIs, std::
 void PatchGeneration::generateFramePatches(std::shared_ptr<uvgvpcc_enc::Frame> frame) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION",
                                                      "Generate patches for frame " + std::to_string(frame->frameId) + ".\n");
+    StatsCollector& stats = StatsCollector::instance();
 
     
     // todo(mf): add the condition for export intermediates files
@@ -107,14 +124,14 @@ void PatchGeneration::generateFramePatches(std::shared_ptr<uvgvpcc_enc::Frame> f
     std::vector<size_t> pointsIdToVoxelId;
 
     if (useVoxelization) {
-        voxelization(frame->pointsGeometry, voxelizedGeometryBuffer, pointsIdToVoxelId, p_->geoBitDepthInput, p_->geoBitDepthVoxelized);
+        voxelizationWithSort(frame->pointsGeometry, voxelizedGeometryBuffer, pointsIdToVoxelId, p_->geoBitDepthInput, p_->geoBitDepthVoxelized);
     }
 
     if(p_->exportStatistics){
         stats.collectData(frame->frameId, DataId::NumberOfVoxels, voxelizedPointsGeometry.size());
     }
 
-    std::vector<size_t> voxelsPPIs(voxelizedPointsGeometry.size(),PPI_NON_ASSIGNED);
+    std::vector<typePPI> voxelsPPIs(voxelizedPointsGeometry.size(),PPI_NON_ASSIGNED);
 
     if (p_->activateSlicing) {
         const size_t pointCount = voxelizedPointsGeometry.size();
@@ -128,14 +145,27 @@ void PatchGeneration::generateFramePatches(std::shared_ptr<uvgvpcc_enc::Frame> f
             assert(false);
         }
     } else {
-        // kdtree init and knn searches //
-        std::vector<std::vector<size_t>> pointsNNList;
-        computePointsNNList(pointsNNList, voxelizedPointsGeometry, std::max(p_->normalComputationKnnCount, p_->normalOrientationKnnCount));
-
         // Normal computation & orientation //
+        // The neighbor list stride is a compile time constant for the neighbor counts used by the presets.
+        const size_t nnCount = std::max(p_->normalComputationKnnCount, p_->normalOrientationKnnCount);
         std::vector<uvgutils::VectorN<double, 3>> pointsNormal(voxelizedPointsGeometry.size());
-        NormalComputation::computeNormals(frame, pointsNormal, voxelizedPointsGeometry, pointsNNList);
-        NormalOrientation::orientNormals(frame, pointsNormal, voxelizedPointsGeometry, pointsNNList);
+        switch (nnCount) {
+            case 6:
+                computePointsNormal<6>(frame, pointsNormal, voxelizedPointsGeometry, nnCount);
+                break;
+            case 8:
+                computePointsNormal<8>(frame, pointsNormal, voxelizedPointsGeometry, nnCount);
+                break;
+            case 9:
+                computePointsNormal<9>(frame, pointsNormal, voxelizedPointsGeometry, nnCount);
+                break;
+            case 12:
+                computePointsNormal<12>(frame, pointsNormal, voxelizedPointsGeometry, nnCount);
+                break;
+            default:
+                computePointsNormal<dynamicNNCount>(frame, pointsNormal, voxelizedPointsGeometry, nnCount);
+                break;
+        }
 
         // Projection Plane Index Segmentation //
         PPISegmenter ppiSegmenter(voxelizedPointsGeometry, pointsNormal);
@@ -144,8 +174,8 @@ void PatchGeneration::generateFramePatches(std::shared_ptr<uvgvpcc_enc::Frame> f
     }
 
     // "De-voxelization"
-    std::vector<size_t> pointsPPIsBuffer;
-    const std::vector<size_t>& pointsPPIs = useVoxelization ? pointsPPIsBuffer : voxelsPPIs;
+    std::vector<typePPI> pointsPPIsBuffer;
+    const std::vector<typePPI>& pointsPPIs = useVoxelization ? pointsPPIsBuffer : voxelsPPIs;
     if (useVoxelization) {
         pointsPPIsBuffer.resize(frame->pointsGeometry.size());
         applyVoxelsDataToPoints(voxelsPPIs, pointsPPIsBuffer, pointsIdToVoxelId);
@@ -34,6 +34,7 @@
 
 #pragma once
 
+#include "neighborList.hpp"
 #include "uvgvpcc/uvgvpcc.hpp"
 
 class PatchGeneration {
@@ -42,6 +43,10 @@ class PatchGeneration {
 
    private:
     
-    static void computePointsNNList(std::vector<std::vector<size_t>>& pointsNNList,
-                                    const std::vector<uvgutils::VectorN<uvgvpcc_enc::typeGeometryInput, 3>>& pointsGeometry, const size_t& nnCount);
+    template <size_t K>
+    static void computePointsNNList(NeighborList<K>& pointsNNList,
+                                    const std::vector<uvgutils::VectorN<uvgvpcc_enc::typeGeometryInput, 3>>& pointsGeometry);
+    template <size_t K>
+    static void computePointsNormal(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<uvgutils::VectorN<double, 3>>& pointsNormal,
+                                    const std::vector<uvgutils::VectorN<uvgvpcc_enc::typeGeometryInput, 3>>& pointsGeometry, const size_t nnCount);
 };
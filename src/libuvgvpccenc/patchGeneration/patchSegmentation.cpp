@@ -40,12 +40,15 @@
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "robin_hood.h"
 #include "utils/constants.hpp"
+#include "utils/encoderContext.hpp"
 #include "utils/fileExport.hpp"
 #include "utils/parameters.hpp"
 #include "utilsPatchGeneration.hpp"
@@ -58,6 +61,8 @@ using namespace uvgvpcc_enc;
 
 namespace {
 
+constexpr size_t ppiCount = 6;
+
 struct ConnectedComponent {
     std::vector<size_t> points;
     typeGeometryInput minU{};
@@ -101,40 +106,191 @@ struct ConnectedComponent {
     }
 };
 
-template<typename keyType>
-inline bool findNeighborSeed(const uvgutils::VectorN<typeGeometryInput, 3>& ptSeed,
-                             const robin_hood::unordered_set<keyType>& resamplePointSetLocation1D) {
+// Resampled points (the points stored in the patches) recorded by location in a hash set.
+template <typename keyType>
+class ResampleLocationSet {
+   public:
+    explicit ResampleLocationSet(const size_t pointCount) : gbd_(p_->geoBitDepthInput), gbd2_(p_->geoBitDepthInput * 2) {
+        set_.reserve(pointCount);
+    }
 
-    const size_t adjacentRange = adjacentPointsSearchFlatOffsets[p_->maxAllowedDist2RawPointsDetection];
-    const size_t gbd = p_->geoBitDepthInput;
-    const size_t gbd2 = p_->geoBitDepthInput * 2;
-    const int maxVal = (1U << gbd) - 1;
-    
-    for(size_t i = 0; i < adjacentRange; ++i) {
-        const auto& shift = adjacentPointsSearchFlat[i];
-        
-        const int x = static_cast<int>(ptSeed[0]) + shift[0];
-        const int y = static_cast<int>(ptSeed[1]) + shift[1];
-        const int z = static_cast<int>(ptSeed[2]) + shift[2];
-
-        if (x < 0 || x > maxVal || y < 0 || y > maxVal || z < 0 || z > maxVal) continue;
-        
-        const size_t adjLoc1D = location1DFromCoordinates<keyType>(x,y,z,gbd,gbd2);
-        if (resamplePointSetLocation1D.contains(adjLoc1D)) {
-            return true;
+    void insert(const uvgutils::VectorN<typeGeometryInput, 3>& point) { set_.emplace(location1DFromPoint<keyType>(point, gbd_, gbd2_)); }
+    void erase(const uvgutils::VectorN<typeGeometryInput, 3>& point) { set_.erase(location1DFromPoint<keyType>(point, gbd_, gbd2_)); }
+    void addPatch(const size_t /*patchIndex*/) {}
+
+    // Return true if a resampled point is within maxAllowedDist2RawPointsDetection of the seed.
+    bool hasResampledNeighbor(const uvgutils::VectorN<typeGeometryInput, 3>& ptSeed) const {
+        const size_t adjacentRange = adjacentPointsSearchFlatOffsets[p_->maxAllowedDist2RawPointsDetection];
+        const int maxVal = (1U << gbd_) - 1;
+
+        for (size_t i = 0; i < adjacentRange; ++i) {
+            const auto& shift = adjacentPointsSearchFlat[i];
+
+            const int x = static_cast<int>(ptSeed[0]) + shift[0];
+            const int y = static_cast<int>(ptSeed[1]) + shift[1];
+            const int z = static_cast<int>(ptSeed[2]) + shift[2];
+
+            if (x < 0 || x > maxVal || y < 0 || y > maxVal || z < 0 || z > maxVal) continue;
+
+            if (set_.contains(location1DFromCoordinates<keyType>(x, y, z, gbd_, gbd2_))) {
+                return true;
+            }
         }
+        return false;
+    }
+
+   private:
+    const size_t gbd_;
+    const size_t gbd2_;
+    robin_hood::unordered_set<keyType> set_;
+};
+
+// Resampled points read back from the depth rasters of the patches already created (depthL1_ and depthL2_ hold exactly the resampled
+// points). A coarse grid of cells lists the patches whose 3D bounding box overlaps each cell, so a seed only checks the few patches
+// around it, with array lookups. Nothing is recorded per point. Both lookups give the same answer, except for duplicate points (same
+// location) which the hash set merges.
+class ResamplePatchRaster {
+   public:
+    explicit ResamplePatchRaster(const std::vector<Patch>& patchList)
+        : patchList_(patchList),
+          cellShift_(static_cast<int>(std::max<size_t>(p_->geoBitDepthInput, cellCountLog2) - cellCountLog2)),
+          adjacentRange_(adjacentPointsSearchFlatOffsets[p_->maxAllowedDist2RawPointsDetection]),
+          doubleLayer_(p_->doubleLayer),
+          cells_(size_t{1} << (3 * cellCountLog2)) {
+        for (size_t i = 0; i < adjacentRange_; ++i) {
+            for (const int s : adjacentPointsSearchFlat[i]) {
+                searchRadius_ = std::max(searchRadius_, std::abs(s));
+            }
+        }
+    }
+
+    // The patch rasters already hold the resampled points.
+    void insert(const uvgutils::VectorN<typeGeometryInput, 3>& /*point*/) {}
+    void erase(const uvgutils::VectorN<typeGeometryInput, 3>& /*point*/) {}
+
+    void addPatch(const size_t patchIndex) {
+        const Patch& patch = patchList_[patchIndex];
+        PatchBox box;
+        box.min[patch.tangentAxis_] = static_cast<int>(patch.posU_);
+        box.max[patch.tangentAxis_] = static_cast<int>(patch.posU_ + patch.widthInPixel_ - 1);
+        box.min[patch.bitangentAxis_] = static_cast<int>(patch.posV_);
+        box.max[patch.bitangentAxis_] = static_cast<int>(patch.posV_ + patch.heightInPixel_ - 1);
+        if (patch.projectionMode_) {
+            box.min[patch.normalAxis_] = static_cast<int>(patch.posD_) - static_cast<int>(patch.sizeD_);
+            box.max[patch.normalAxis_] = static_cast<int>(patch.posD_);
+        } else {
+            box.min[patch.normalAxis_] = static_cast<int>(patch.posD_);
+            box.max[patch.normalAxis_] = static_cast<int>(patch.posD_ + patch.sizeD_);
+        }
+        if (boxes_.size() <= patchIndex) {
+            boxes_.resize(patchIndex + 1);
+        }
+        boxes_[patchIndex] = box;
+
+        const std::array<int, 3> cellMin = cellOf(box.min);
+        const std::array<int, 3> cellMax = cellOf(box.max);
+        for (int cz = cellMin[2]; cz <= cellMax[2]; ++cz) {
+            for (int cy = cellMin[1]; cy <= cellMax[1]; ++cy) {
+                for (int cx = cellMin[0]; cx <= cellMax[0]; ++cx) {
+                    cells_[cellIndex(cx, cy, cz)].push_back(static_cast<uint32_t>(patchIndex));
+                }
+            }
+        }
+    }
+
+    // Return true if a resampled point is within maxAllowedDist2RawPointsDetection of the seed.
+    bool hasResampledNeighbor(const uvgutils::VectorN<typeGeometryInput, 3>& ptSeed) const {
+        const std::array<int, 3> seed = {static_cast<int>(ptSeed[0]), static_cast<int>(ptSeed[1]), static_cast<int>(ptSeed[2])};
+        const std::array<int, 3> queryMin = {seed[0] - searchRadius_, seed[1] - searchRadius_, seed[2] - searchRadius_};
+        const std::array<int, 3> queryMax = {seed[0] + searchRadius_, seed[1] + searchRadius_, seed[2] + searchRadius_};
+        const std::array<int, 3> cellMin = cellOf(queryMin);
+        const std::array<int, 3> cellMax = cellOf(queryMax);
+
+        for (int cz = cellMin[2]; cz <= cellMax[2]; ++cz) {
+            for (int cy = cellMin[1]; cy <= cellMax[1]; ++cy) {
+                for (int cx = cellMin[0]; cx <= cellMax[0]; ++cx) {
+                    for (const uint32_t patchIndex : cells_[cellIndex(cx, cy, cz)]) {
+                        const PatchBox& box = boxes_[patchIndex];
+                        if (!overlaps(box, queryMin, queryMax)) continue;
+                        // A patch overlapping several of the query cells is only checked from the first of them.
+                        const std::array<int, 3> firstCell = cellOf({std::max(box.min[0], queryMin[0]), std::max(box.min[1], queryMin[1]),
+                                                                     std::max(box.min[2], queryMin[2])});
+                        if (firstCell[0] != cx || firstCell[1] != cy || firstCell[2] != cz) continue;
+                        if (patchHasResampledNeighbor(patchList_[patchIndex], seed)) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+   private:
+    static constexpr size_t cellCountLog2 = 5;  // 32 cells per axis
+
+    struct PatchBox {
+        std::array<int, 3> min;
+        std::array<int, 3> max;
+    };
+
+    std::array<int, 3> cellOf(const std::array<int, 3>& coord) const {
+        const int maxCell = (1 << cellCountLog2) - 1;
+        return {std::clamp(coord[0] >> cellShift_, 0, maxCell), std::clamp(coord[1] >> cellShift_, 0, maxCell),
+                std::clamp(coord[2] >> cellShift_, 0, maxCell)};
     }
-    return false;
-}
+
+    static size_t cellIndex(const int cx, const int cy, const int cz) {
+        return static_cast<size_t>(cx) + (static_cast<size_t>(cy) << cellCountLog2) + (static_cast<size_t>(cz) << (2 * cellCountLog2));
+    }
+
+    static bool overlaps(const PatchBox& box, const std::array<int, 3>& queryMin, const std::array<int, 3>& queryMax) {
+        return box.min[0] <= queryMax[0] && box.max[0] >= queryMin[0] && box.min[1] <= queryMax[1] && box.max[1] >= queryMin[1] &&
+               box.min[2] <= queryMax[2] && box.max[2] >= queryMin[2];
+    }
+
+    bool patchHasResampledNeighbor(const Patch& patch, const std::array<int, 3>& seed) const {
+        const int width = static_cast<int>(patch.widthInPixel_);
+        const int height = static_cast<int>(patch.heightInPixel_);
+        const int posU = static_cast<int>(patch.posU_);
+        const int posV = static_cast<int>(patch.posV_);
+        const int posD = static_cast<int>(patch.posD_);
+        const int sizeD = static_cast<int>(patch.sizeD_);
+
+        for (size_t i = 0; i < adjacentRange_; ++i) {
+            const auto& shift = adjacentPointsSearchFlat[i];
+            const int u = seed[patch.tangentAxis_] + shift[patch.tangentAxis_] - posU;
+            const int v = seed[patch.bitangentAxis_] + shift[patch.bitangentAxis_] - posV;
+            if (u < 0 || u >= width || v < 0 || v >= height) continue;
+            const int n = seed[patch.normalAxis_] + shift[patch.normalAxis_];
+            const int d = patch.projectionMode_ ? posD - n : n - posD;
+            if (d < 0 || d > sizeD) continue;
+
+            const size_t p = static_cast<size_t>(v) * patch.widthInPixel_ + static_cast<size_t>(u);
+            if (patch.depthL1_[p] == d || (doubleLayer_ && patch.depthL2_[p] == d)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const std::vector<Patch>& patchList_;
+    const int cellShift_;
+    const size_t adjacentRange_;
+    const bool doubleLayer_;
+    int searchRadius_ = 0;
+    std::vector<std::vector<uint32_t>> cells_;
+    std::vector<PatchBox> boxes_;
+};
 
 template <typename keyType>
 inline void createConnectedComponent(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const size_t& seedIndex,
-                                     std::vector<bool>& pointIsInAPatch, ConnectedComponent& cc,
+                                     std::vector<uint8_t>& pointIsInAPatch, ConnectedComponent& cc,
                                      robin_hood::unordered_map<keyType, size_t>& mapLocation1D,
                                      const uvgutils::VectorN<typeGeometryInput, 3>& ptSeed,
                                      std::vector<size_t>& fifo) {
     cc.points.push_back(seedIndex);
-    pointIsInAPatch[seedIndex] = true;
+    pointIsInAPatch[seedIndex] = 1U;
     const size_t gbd = p_->geoBitDepthInput;
     const size_t gbd2 = p_->geoBitDepthInput * 2;    
     mapLocation1D.erase(location1DFromPoint<keyType>(ptSeed,gbd,gbd2));
@@ -170,7 +326,7 @@ inline void createConnectedComponent(const std::shared_ptr<uvgvpcc_enc::Frame>&
                 const size_t adjPtIndex = it->second;
                 mapLocation1D.erase(it);
                 cc.points.push_back(adjPtIndex);
-                pointIsInAPatch[adjPtIndex] = true;
+                pointIsInAPatch[adjPtIndex] = 1U;
                 fifo.emplace_back(adjPtIndex);
                 
                 const uvgutils::VectorN<typeGeometryInput, 3> adjPt = {
@@ -321,10 +477,10 @@ inline void setPatchL1(Patch& patch, const int& minD, const std::vector<typeGeom
     }
 }
 
-template <typename keyType, size_t Ppi, bool DoubleLayer>
+template <typename keyType, typename ResampleIndex, size_t Ppi, bool DoubleLayer>
 inline void finalizePatch(const ConnectedComponent& cc, const std::shared_ptr<uvgvpcc_enc::Frame>& frame, Patch& patch,
-                          robin_hood::unordered_map<keyType, size_t>& mapLocation1D, std::vector<bool>& pointIsInAPatch,
-                          const typeGeometryInput& minD, robin_hood::unordered_set<keyType>& resamplePointSetLocation1D) {
+                          robin_hood::unordered_map<keyType, size_t>& mapLocation1D, std::vector<uint8_t>& pointIsInAPatch,
+                          const typeGeometryInput& minD, ResampleIndex& resampleIndex) {
     constexpr size_t normalAxis = getPatchNormalAxis<Ppi>();
     constexpr size_t tangentAxis = getPatchTangentAxis<Ppi>();
     constexpr size_t bitangentAxis = getPatchBitangentAxis<Ppi>();
@@ -349,7 +505,7 @@ inline void finalizePatch(const ConnectedComponent& cc, const std::shared_ptr<uv
         const keyType loc1D = location1DFromPoint<keyType>(point,gbd,gbd2);
 
         if (patchDL1 == g_infiniteDepth) {
-            pointIsInAPatch[pointIndex] = false;
+            pointIsInAPatch[pointIndex] = 0U;
             mapLocation1D.emplace(loc1D, pointIndex);
             // lf: this point has been filtered (tmp_a>32). It will be processed during next iteration. There is no point in L1 here as the
             // filtering process is done on block of pixels.
@@ -363,7 +519,7 @@ inline void finalizePatch(const ConnectedComponent& cc, const std::shared_ptr<uv
         if (patchDL1 == d) {
             // lf: this point is part of L1
             assert(patch.depthPCidxL1_[p] == pointIndex);
-            resamplePointSetLocation1D.emplace(loc1D);
+            resampleIndex.insert(point);
             continue;
         }
 
@@ -379,21 +535,19 @@ inline void finalizePatch(const ConnectedComponent& cc, const std::shared_ptr<uv
             if (deltaD <= p_->surfaceThickness) {
                 if (patch.depthL2_[p] != g_infiniteDepth && patch.depthL2_[p] != patchDL1) {
                     const auto overwrittenIdx = patch.depthPCidxL2_[p];
-                    const auto& overwrittenPt = frame->pointsGeometry[overwrittenIdx];
-                    const keyType overwrittenLoc1D = location1DFromPoint<keyType>(overwrittenPt,gbd,gbd2);
-                    resamplePointSetLocation1D.erase(overwrittenLoc1D);
+                    resampleIndex.erase(frame->pointsGeometry[overwrittenIdx]);
                     // The overwritten point is between the two layers, it is discarded.
                 }
                 patch.depthL2_[p] = d;
                 patch.depthPCidxL2_[p] = pointIndex;
-                resamplePointSetLocation1D.emplace(loc1D);
+                resampleIndex.insert(point);
                 patch.sizeD_ = std::max<size_t>(patch.sizeD_, static_cast<size_t>(patch.depthL2_[p]));
                 continue;
             }
             if (deltaD <= p_->maxAllowedDist2RawPointsDetection) {
                 continue;
             }
-            pointIsInAPatch[pointIndex] = false;
+            pointIsInAPatch[pointIndex] = 0U;
             mapLocation1D.emplace(loc1D, pointIndex);
         } else {
             assert(d > patchDL1);
@@ -401,17 +555,16 @@ inline void finalizePatch(const ConnectedComponent& cc, const std::shared_ptr<uv
             if (deltaD < p_->surfaceThickness) {
                 continue;
             }
-            pointIsInAPatch[pointIndex] = false;
+            pointIsInAPatch[pointIndex] = 0U;
             mapLocation1D.emplace(loc1D, pointIndex);
         }
     }
 }
 
-template <typename keyType,size_t Ppi>
+template <typename keyType, typename ResampleIndex, size_t Ppi>
 inline void createPatch(Patch& patch, const ConnectedComponent& cc, const std::shared_ptr<uvgvpcc_enc::Frame>& frame,
-                        std::vector<bool>& pointIsInAPatch, robin_hood::unordered_map<keyType, size_t>& mapLocation1D,
-                        robin_hood::unordered_set<keyType>& resamplePointSetLocation1D,
-                        std::vector<typeGeometryInput>& sharedPeakPerBlock) {
+                        std::vector<uint8_t>& pointIsInAPatch, robin_hood::unordered_map<keyType, size_t>& mapLocation1D,
+                        ResampleIndex& resampleIndex, std::vector<typeGeometryInput>& sharedPeakPerBlock) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION", "Create patch for frame " + std::to_string(frame->frameId) + "\n");
     constexpr size_t normalAxis = getPatchNormalAxis<Ppi>();
     constexpr size_t tangentAxis = getPatchTangentAxis<Ppi>();
@@ -453,91 +606,98 @@ inline void createPatch(Patch& patch, const ConnectedComponent& cc, const std::s
     setPatchL1<projectionMode>(patch, minD, sharedPeakPerBlock);
 
     if (p_->doubleLayer) {
-        finalizePatch<keyType, Ppi, true>(cc, frame, patch, mapLocation1D, pointIsInAPatch, minD, resamplePointSetLocation1D);
+        finalizePatch<keyType, ResampleIndex, Ppi, true>(cc, frame, patch, mapLocation1D, pointIsInAPatch, minD, resampleIndex);
     } else {
-        finalizePatch<keyType, Ppi, false>(cc, frame, patch, mapLocation1D, pointIsInAPatch, minD, resamplePointSetLocation1D);
+        finalizePatch<keyType, ResampleIndex, Ppi, false>(cc, frame, patch, mapLocation1D, pointIsInAPatch, minD, resampleIndex);
     }
 }
 
-template <typename keyType, bool FirstIteration>
-inline void createConnectedComponents(std::vector<bool>& pointIsInAPatch, std::vector<bool>& pointCanBeASeed,
-                                      const std::shared_ptr<uvgvpcc_enc::Frame>& frame,
-                                      const robin_hood::unordered_set<keyType>& resamplePointSetLocation1D,
-                                      const std::vector<size_t>& pointsPPIs,
-                                      std::array<robin_hood::unordered_map<keyType, size_t>, 6>& mapList,
-                                      std::vector<ConnectedComponent>& connectedComponents,
-                                      std::vector<size_t>& sharedFifo) {
-    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION",
-                                                     "Create connected components for frame " + std::to_string(frame->frameId) + "\n");
-    for (size_t seedIndex = 0; seedIndex < pointIsInAPatch.size(); ++seedIndex) {
-        if (pointIsInAPatch[seedIndex]) continue;
+// Create the connected components of a single PPI. The seeds are visited in increasing point index order. The flooding only reaches the
+// points of this PPI (through its own location map), and the seed check only reads the resample index, so the PPIs are independent.
+template <typename keyType, typename ResampleIndex, bool FirstIteration>
+inline void createPpiConnectedComponents(const size_t ppi, std::vector<uint8_t>& pointIsInAPatch, std::vector<uint8_t>& pointCanBeASeed,
+                                         const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const ResampleIndex& resampleIndex,
+                                         const std::vector<size_t>& ppiPoints, robin_hood::unordered_map<keyType, size_t>& mapLocation1D,
+                                         std::vector<ConnectedComponent>& connectedComponents, std::vector<size_t>& fifo) {
+    for (const size_t seedIndex : ppiPoints) {
+        if (pointIsInAPatch[seedIndex] != 0U) continue;
         if constexpr (!FirstIteration) {
-            if (!pointCanBeASeed[seedIndex]) continue;
+            if (pointCanBeASeed[seedIndex] == 0U) continue;
         }
 
         const uvgutils::VectorN<typeGeometryInput, 3>& ptSeed = frame->pointsGeometry[seedIndex];
         if constexpr (!FirstIteration) {
             // Find a correct seed point to start a connected component
-            if (findNeighborSeed(ptSeed, resamplePointSetLocation1D)) {
-                pointCanBeASeed[seedIndex] = false;
+            if (resampleIndex.hasResampledNeighbor(ptSeed)) {
+                pointCanBeASeed[seedIndex] = 0U;
                 continue;
             }
         }
 
         // There is no neighboring point of this seed that is in the resample. It is then a correct seed.
-        const size_t ppiCC = pointsPPIs[seedIndex];
-        connectedComponents.emplace_back(ppiCC);
-        createConnectedComponent<keyType>(frame, seedIndex, pointIsInAPatch, connectedComponents.back(), mapList[ppiCC], ptSeed, sharedFifo);
+        connectedComponents.emplace_back(ppi);
+        createConnectedComponent<keyType>(frame, seedIndex, pointIsInAPatch, connectedComponents.back(), mapLocation1D, ptSeed, fifo);
     }
 }
 
-}  // Anonymous namespace
-
-template<typename keyType>
-void PatchSegmentation::patchSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const std::vector<size_t>& pointsPPIs) {
+// The six PPIs are processed in parallel. Their connected components are then merged in increasing seed index order, which is the order
+// of a single scan over all the points.
+template <typename keyType, typename ResampleIndex, bool FirstIteration>
+inline void createConnectedComponents(std::vector<uint8_t>& pointIsInAPatch, std::vector<uint8_t>& pointCanBeASeed,
+                                      const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const ResampleIndex& resampleIndex,
+                                      const std::array<std::vector<size_t>, ppiCount>& ppiPointsList,
+                                      std::array<robin_hood::unordered_map<keyType, size_t>, ppiCount>& mapList,
+                                      std::array<std::vector<ConnectedComponent>, ppiCount>& ppiConnectedComponents,
+                                      std::vector<ConnectedComponent>& connectedComponents,
+                                      std::array<std::vector<size_t>, ppiCount>& sharedFifos) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION",
-                                                     "Patch segmentation of frame " + std::to_string(frame->frameId) + "\n");
-
-    const size_t pointCount = frame->pointsGeometry.size();
-    
-    auto gofPtr = frame->gof.lock();
-    assert(gofPtr);
-    const size_t framePos = frame->frameId % p_->sizeGOF;
-    
-    std::vector<bool> pointIsInAPatch(pointCount, false);
-    std::vector<bool> pointCanBeASeed(pointCount, true);
-    std::array<robin_hood::unordered_map<keyType, size_t>, 6> mapList;
-    for (auto& map : mapList) {
-        map.reserve(65536);
+                                                     "Create connected components for frame " + std::to_string(frame->frameId) + "\n");
+    currentContext->jobManager.parallelFor(ppiCount, 1, [&](const size_t begin, const size_t end) {
+        for (size_t ppi = begin; ppi < end; ++ppi) {
+            ppiConnectedComponents[ppi].clear();
+            createPpiConnectedComponents<keyType, ResampleIndex, FirstIteration>(ppi, pointIsInAPatch, pointCanBeASeed, frame, resampleIndex,
+                                                                                 ppiPointsList[ppi], mapList[ppi],
+                                                                                 ppiConnectedComponents[ppi], sharedFifos[ppi]);
+        }
+    });
+
+    // The first point of a connected component is its seed.
+    std::array<size_t, ppiCount> readIndex{};
+    while (true) {
+        size_t nextPpi = ppiCount;
+        for (size_t ppi = 0; ppi < ppiCount; ++ppi) {
+            if (readIndex[ppi] == ppiConnectedComponents[ppi].size()) continue;
+            if (nextPpi == ppiCount || ppiConnectedComponents[ppi][readIndex[ppi]].points.front() <
+                                           ppiConnectedComponents[nextPpi][readIndex[nextPpi]].points.front()) {
+                nextPpi = ppi;
+            }
+        }
+        if (nextPpi == ppiCount) break;
+        connectedComponents.emplace_back(std::move(ppiConnectedComponents[nextPpi][readIndex[nextPpi]++]));
     }
+}
 
-    const size_t gbd = p_->geoBitDepthInput;
-    const size_t gbd2 = p_->geoBitDepthInput * 2;    
-    for (size_t ptIndex = 0; ptIndex < pointCount; ++ptIndex) {
-        const keyType pointLocation1D = location1DFromPoint<keyType>(frame->pointsGeometry[ptIndex],gbd,gbd2);
-        assert(pointsPPIs[ptIndex] < 6);
-        mapList[pointsPPIs[ptIndex]].emplace(pointLocation1D, ptIndex);
-    }
-    
-    robin_hood::unordered_set<keyType> resamplePointSetLocation1D;
-    resamplePointSetLocation1D.reserve(pointCount);
-    
+// Alternate the connected components creation and the patches creation until no connected component is left.
+template <typename keyType, typename ResampleIndex>
+void createPatches(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<uint8_t>& pointIsInAPatch,
+                   std::vector<uint8_t>& pointCanBeASeed, const std::array<std::vector<size_t>, ppiCount>& ppiPointsList,
+                   std::array<robin_hood::unordered_map<keyType, size_t>, ppiCount>& mapList, ResampleIndex& resampleIndex) {
     std::vector<ConnectedComponent> connectedComponents;
     connectedComponents.reserve(256);
+    std::array<std::vector<ConnectedComponent>, ppiCount> ppiConnectedComponents;
 
-    std::vector<size_t> sharedFifo;
-    sharedFifo.reserve(65536);
+    std::array<std::vector<size_t>, ppiCount> sharedFifos;
+    for (auto& fifo : sharedFifos) {
+        fifo.reserve(65536);
+    }
     std::vector<typeGeometryInput> sharedPeakPerBlock;
-    sharedPeakPerBlock.reserve(16384); 
-    
+    sharedPeakPerBlock.reserve(16384);
+
     // Connected components creation (first iteration)
-    createConnectedComponents<keyType,true>(pointIsInAPatch, pointCanBeASeed, frame, resamplePointSetLocation1D, pointsPPIs, mapList,
-        connectedComponents, sharedFifo);
-        
-    
+    createConnectedComponents<keyType, ResampleIndex, true>(pointIsInAPatch, pointCanBeASeed, frame, resampleIndex, ppiPointsList, mapList,
+                                                            ppiConnectedComponents, connectedComponents, sharedFifos);
+
     auto& patchList = *frame->patchList;
-    patchList.reserve(256);
-    
     while (!connectedComponents.empty()) {
         // Patches creation
         for (const ConnectedComponent& cc : connectedComponents) {
@@ -548,33 +708,80 @@ void PatchSegmentation::patchSegmentation(const std::shared_ptr<uvgvpcc_enc::Fra
 
             switch (cc.ppi) {
                 case 0:
-                    createPatch<keyType,0>(patch, cc, frame, pointIsInAPatch, mapList[0], resamplePointSetLocation1D, sharedPeakPerBlock);
+                    createPatch<keyType, ResampleIndex, 0>(patch, cc, frame, pointIsInAPatch, mapList[0], resampleIndex, sharedPeakPerBlock);
                     break;
                 case 1:
-                    createPatch<keyType,1>(patch, cc, frame, pointIsInAPatch, mapList[1], resamplePointSetLocation1D, sharedPeakPerBlock);
+                    createPatch<keyType, ResampleIndex, 1>(patch, cc, frame, pointIsInAPatch, mapList[1], resampleIndex, sharedPeakPerBlock);
                     break;
                 case 2:
-                    createPatch<keyType,2>(patch, cc, frame, pointIsInAPatch, mapList[2], resamplePointSetLocation1D, sharedPeakPerBlock);
+                    createPatch<keyType, ResampleIndex, 2>(patch, cc, frame, pointIsInAPatch, mapList[2], resampleIndex, sharedPeakPerBlock);
                     break;
                 case 3:
-                    createPatch<keyType,3>(patch, cc, frame, pointIsInAPatch, mapList[3], resamplePointSetLocation1D, sharedPeakPerBlock);
+                    createPatch<keyType, ResampleIndex, 3>(patch, cc, frame, pointIsInAPatch, mapList[3], resampleIndex, sharedPeakPerBlock);
                     break;
                 case 4:
-                    createPatch<keyType,4>(patch, cc, frame, pointIsInAPatch, mapList[4], resamplePointSetLocation1D, sharedPeakPerBlock);
+                    createPatch<keyType, ResampleIndex, 4>(patch, cc, frame, pointIsInAPatch, mapList[4], resampleIndex, sharedPeakPerBlock);
                     break;
                 case 5:
-                    createPatch<keyType,5>(patch, cc, frame, pointIsInAPatch, mapList[5], resamplePointSetLocation1D, sharedPeakPerBlock);
+                    createPatch<keyType, ResampleIndex, 5>(patch, cc, frame, pointIsInAPatch, mapList[5], resampleIndex, sharedPeakPerBlock);
                     break;
                 default:
                     assert(false);
                     break;
             }
+            resampleIndex.addPatch(patchList.size() - 1);
         }
 
         // Connected components creation
         connectedComponents.clear();
-        createConnectedComponents<keyType,false>(pointIsInAPatch, pointCanBeASeed, frame, resamplePointSetLocation1D, pointsPPIs,
-                                         mapList, connectedComponents, sharedFifo);
+        createConnectedComponents<keyType, ResampleIndex, false>(pointIsInAPatch, pointCanBeASeed, frame, resampleIndex, ppiPointsList,
+                                                                 mapList, ppiConnectedComponents, connectedComponents, sharedFifos);
+    }
+}
+
+}  // Anonymous namespace
+
+template<typename keyType>
+void PatchSegmentation::patchSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const std::vector<typePPI>& pointsPPIs) {
+    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION",
+                                                     "Patch segmentation of frame " + std::to_string(frame->frameId) + "\n");
+
+    const size_t pointCount = frame->pointsGeometry.size();
+    
+    auto gofPtr = frame->gof.lock();
+    assert(gofPtr);
+    const size_t framePos = frame->frameId % p_->sizeGOF;
+    
+    // Byte flags (rather than std::vector<bool>) as the PPIs are written concurrently.
+    std::vector<uint8_t> pointIsInAPatch(pointCount, 0U);
+    std::vector<uint8_t> pointCanBeASeed(pointCount, 1U);
+    std::array<robin_hood::unordered_map<keyType, size_t>, ppiCount> mapList;
+    std::array<std::vector<size_t>, ppiCount> ppiPointsList;
+
+    // Each PPI builds its own location map and its list of points (in increasing point index order).
+    const size_t gbd = p_->geoBitDepthInput;
+    const size_t gbd2 = p_->geoBitDepthInput * 2;
+    currentContext->jobManager.parallelFor(ppiCount, 1, [&](const size_t begin, const size_t end) {
+        for (size_t ppi = begin; ppi < end; ++ppi) {
+            mapList[ppi].reserve(65536);
+            for (size_t ptIndex = 0; ptIndex < pointCount; ++ptIndex) {
+                assert(pointsPPIs[ptIndex] < ppiCount);
+                if (pointsPPIs[ptIndex] != ppi) continue;
+                ppiPointsList[ppi].push_back(ptIndex);
+                mapList[ppi].emplace(location1DFromPoint<keyType>(frame->pointsGeometry[ptIndex], gbd, gbd2), ptIndex);
+            }
+        }
+    });
+    
+    auto& patchList = *frame->patchList;
+    patchList.reserve(256);
+
+    if (p_->patchSegmentationRasterLookup) {
+        ResamplePatchRaster resampleIndex(patchList);
+        createPatches<keyType>(frame, pointIsInAPatch, pointCanBeASeed, ppiPointsList, mapList, resampleIndex);
+    } else {
+        ResampleLocationSet<keyType> resampleIndex(pointCount);
+        createPatches<keyType>(frame, pointIsInAPatch, pointCanBeASeed, ppiPointsList, mapList, resampleIndex);
     }
 
     if(p_->exportStatistics){
@@ -611,7 +818,7 @@ void PatchSegmentation::patchSegmentation(const std::shared_ptr<uvgvpcc_enc::Fra
             numberOfLostPointPS++;
         }
         // stats.setNumberOfLostPoints(frame->frameId, numberOfLostPointPS);
-        stats.collectData(frame->frameId, DataId::NumberOfLostPoints, numberOfLostPointPS);
+        StatsCollector::instance().collectData(frame->frameId, DataId::NumberOfLostPoints, numberOfLostPointPS);
     }
 
 
@@ -625,16 +832,16 @@ void PatchSegmentation::patchSegmentation(const std::shared_ptr<uvgvpcc_enc::Fra
 
 template void PatchSegmentation::patchSegmentation<uint64_t>(
     const std::shared_ptr<uvgvpcc_enc::Frame>&,
-    const std::vector<size_t>&
+    const std::vector<typePPI>&
 );
 
 
 template void PatchSegmentation::patchSegmentation<uint32_t>(
     const std::shared_ptr<uvgvpcc_enc::Frame>&,
-    const std::vector<size_t>&
+    const std::vector<typePPI>&
 );
 
 template void PatchSegmentation::patchSegmentation<uint16_t>(
     const std::shared_ptr<uvgvpcc_enc::Frame>&,
-    const std::vector<size_t>&
+    const std::vector<typePPI>&
 );
\ No newline at end of file
@@ -35,14 +35,17 @@
 #include "ppiSegmenter.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
-#include "robin_hood.h"
+#include "utils/encoderContext.hpp"
 #include "utils/fileExport.hpp"
 #include "utils/parameters.hpp"
 #include "utils/constants.hpp"
@@ -54,6 +57,31 @@
 
 using namespace uvgvpcc_enc;
 
+namespace {
+constexpr size_t refineBatchSize = 1024;  // Number of voxels refined in a single task of the thread pool
+
+// Neighborhood of the refine segmentation voxels, as a compressed sparse row graph. The neighbors of all the voxels are stored in a single
+// buffer, with 32-bit indices. A row lists the neighbors of a voxel by increasing distance, so its IDE-V neighbors (IDEV_List) are a prefix
+// of the row (ADJ_List). As only the voxels processed by the iterations need a row, the rows are built by batches, the first time their
+// voxel is processed, and are reused by all the following iterations.
+struct VoxelAdjacency {
+    static constexpr size_t noRow = std::numeric_limits<size_t>::max();
+
+    explicit VoxelAdjacency(const size_t voxelCount) : rowBegin(voxelCount, noRow), rowLength(voxelCount), rowIdevLength(voxelCount) {}
+
+    bool hasRow(const size_t voxelIndex) const { return rowBegin[voxelIndex] != noRow; }
+    std::span<const uint32_t> row(const size_t voxelIndex) const { return {neighbors.data() + rowBegin[voxelIndex], rowLength[voxelIndex]}; }
+    std::span<const uint32_t> idevRow(const size_t voxelIndex) const {
+        return {neighbors.data() + rowBegin[voxelIndex], rowIdevLength[voxelIndex]};
+    }
+
+    std::vector<uint32_t> neighbors;
+    std::vector<size_t> rowBegin;
+    std::vector<uint32_t> rowLength;
+    std::vector<uint32_t> rowIdevLength;
+};
+}  // anonymous namespace
+
 PPISegmenter::PPISegmenter(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
                            const std::vector<uvgutils::VectorN<double, 3>>& pointsNormals)
     : pointsNormals_(pointsNormals),
@@ -78,12 +106,12 @@ PPISegmenter::PPISegmenter(const std::vector<uvgutils::VectorN<typeGeometryInput
           return geoRange;
       }()) {}
 
-VoxelAttribute::VoxelAttribute(const size_t projectionPlaneCount_)
-    : updateFlag_(false), voxClass_(VoxClass::NO_EDGE), voxPPI_(0), voxScore_{0} {}
+VoxelAttributes::VoxelAttributes(const size_t voxelCount)
+    : scores(voxelCount, {0}), ppis(voxelCount, 0), classes(voxelCount, VoxClass::NO_EDGE), updateFlags(voxelCount, 0) {}
 
 // TODO(lf): check if the initial segmentation can be done inside the precomputation of the refineSegmentation
 // TODO(lf): use auto& : ... everywhere instead of for loop (and try avoiding using pointCount or size())
-void PPISegmenter::initialSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<size_t>& pointsPPIs,
+void PPISegmenter::initialSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<typePPI>& pointsPPIs,
                                        const size_t& frameId) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION", "Initial segmentation of frame " + std::to_string(frameId) + "\n");
     for (size_t ptIndex = 0; ptIndex < pointsPPIs.size(); ++ptIndex) {
@@ -98,7 +126,7 @@ void PPISegmenter::initialSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>
                 ppi = ppIndex;
             }
         }
-        pointsPPIs[ptIndex] = ppi;
+        pointsPPIs[ptIndex] = static_cast<typePPI>(ppi);
     }
 
     if (p_->exportIntermediateFiles) {
@@ -109,14 +137,16 @@ void PPISegmenter::initialSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>
 // TODO(lf): the number of points in the voxel is usefull only for DE-V voxel no ? So why to set the value for all voxels ?
 // TODO(lf): use two flags, compute one time the flag for S or M instead of checking it like the other classification
 
-inline void PPISegmenter::updateVoxelAttribute(VoxelAttribute& voxAttribute, const std::vector<size_t>& voxPoints,
-                                               const std::vector<size_t>& pointsPPIs) {
-    std::array<size_t, 6>& voxScore = voxAttribute.voxScore_;
+inline void PPISegmenter::updateVoxelAttribute(VoxelAttributes& voxAttributes, const size_t voxelIndex, const std::vector<size_t>& voxPoints,
+                                               const std::vector<typePPI>& pointsPPIs) {
+    std::array<uint32_t, 6>& voxScore = voxAttributes.scores[voxelIndex];
+    VoxClass& voxClass = voxAttributes.classes[voxelIndex];
+    typePPI& voxPPI = voxAttributes.ppis[voxelIndex];
 
     // Single Direct Edge Voxel : One point in the voxel //
-    if (voxAttribute.voxClass_ == VoxClass::S_DIRECT_EDGE) {
-        voxAttribute.voxPPI_ = pointsPPIs[voxPoints[0]];
-        voxScore[voxAttribute.voxPPI_] = 1;
+    if (voxClass == VoxClass::S_DIRECT_EDGE) {
+        voxPPI = pointsPPIs[voxPoints[0]];
+        voxScore[voxPPI] = 1;
         return;
     }
 
@@ -127,45 +157,51 @@ inline void PPISegmenter::updateVoxelAttribute(VoxelAttribute& voxAttribute, con
 
     if (voxScore[pointsPPIs[voxPoints[0]]] == voxPoints.size()) {
         // No Edge Voxel : All points within the voxel have the same PPI //
-        voxAttribute.voxClass_ = VoxClass::NO_EDGE;
-        voxAttribute.voxPPI_ = pointsPPIs[voxPoints[0]];
+        voxClass = VoxClass::NO_EDGE;
+        voxPPI = pointsPPIs[voxPoints[0]];
         return;
     }
 
     // Multiple Direct Edge Voxel : Points within the voxel have different PPI //
-    voxAttribute.voxClass_ = VoxClass::M_DIRECT_EDGE;
+    voxClass = VoxClass::M_DIRECT_EDGE;
 
     // The voxel PPI is the most represented PPI among the points inside it //
     const auto& maxScore = std::max_element(voxScore.begin(), voxScore.end());
-    voxAttribute.voxPPI_ = static_cast<size_t>(std::distance(voxScore.begin(), maxScore));
+    voxPPI = static_cast<typePPI>(std::distance(voxScore.begin(), maxScore));
 }
 
-void PPISegmenter::computeExtendedScore(std::array<size_t,6>& voxExtendedScore, const std::vector<size_t>& ADJ_List,
-                                        const std::vector<VoxelAttribute>& voxAttributeList) {
+void PPISegmenter::computeExtendedScore(std::array<size_t,6>& voxExtendedScore, const std::span<const uint32_t> ADJ_List,
+                                        const VoxelAttributes& voxAttributes) {
     std::fill(voxExtendedScore.begin(), voxExtendedScore.end(), 0);
-    for (const auto& voxelIndex : ADJ_List) {
+    for (const uint32_t voxelIndex : ADJ_List) {
+        const std::array<uint32_t, 6>& voxScore = voxAttributes.scores[voxelIndex];
         for (size_t k = 0; k < p_->projectionPlaneCount; ++k) {
-            voxExtendedScore[k] += voxAttributeList[voxelIndex].voxScore_[k];
+            voxExtendedScore[k] += voxScore[k];
         }
     }
 }
 
 // TODO(lf)warning : adjacent (old name) voxel contain the voxel itself!
-void PPISegmenter::updateAdjacentVoxelsClass(std::vector<VoxelAttribute>& voxAttributeList, const std::array<size_t,6>& voxExtendedScore,
-                                             const std::vector<size_t>& IDEV_List) {
+// The classification of the current iteration is not modified : the promoted voxels are marked in 'promotedVoxels', which can be written by
+// several threads. The promoted voxels located after the current voxel are also returned in 'promotedAfter'.
+void PPISegmenter::updateAdjacentVoxelsClass(std::vector<uint8_t>& promotedVoxels, std::vector<size_t>& promotedAfter,
+                                             const VoxelAttributes& voxAttributes, const std::array<size_t,6>& voxExtendedScore,
+                                             const std::span<const uint32_t> IDEV_List, const size_t currentVoxelIndex) {
     // Common and effective way to find the index of the maximum element in a C++ container
     const auto& maxScoreSmooth = std::max_element(voxExtendedScore.begin(), voxExtendedScore.end());
     const size_t ppiOfScoreSmooth = std::distance(voxExtendedScore.begin(), maxScoreSmooth);
 
-    for (const auto& voxelIndex : IDEV_List) {
-        VoxelAttribute& adjVoxAttribute = voxAttributeList[voxelIndex];
-        if (adjVoxAttribute.voxClass_ == VoxClass::NO_EDGE && adjVoxAttribute.voxPPI_ != ppiOfScoreSmooth) {
-            adjVoxAttribute.voxClass_ = VoxClass::INDIRECT_EDGE;
+    for (const uint32_t voxelIndex : IDEV_List) {
+        if (voxAttributes.classes[voxelIndex] == VoxClass::NO_EDGE && voxAttributes.ppis[voxelIndex] != ppiOfScoreSmooth) {
+            std::atomic_ref<uint8_t>(promotedVoxels[voxelIndex]).store(1, std::memory_order_relaxed);
+            if (voxelIndex > currentVoxelIndex) {
+                promotedAfter.push_back(voxelIndex);
+            }
         }
     }
 }
 
-inline bool PPISegmenter::checkNEV(const VoxClass voxClass, const size_t voxPPI, const std::array<size_t,6>& voxExtendedScore) {
+inline bool PPISegmenter::checkNEV(const VoxClass voxClass, const typePPI voxPPI, const std::array<size_t,6>& voxExtendedScore) {
     // TODO(lf): why not to check if S_DIRECT_EDGE ?
 
     if (voxClass == VoxClass::M_DIRECT_EDGE) {  // TMC2 : VoxClass::S_DIRECT_EDGE or VoxClass::INDIRECT_EDGE
@@ -191,7 +227,8 @@ inline bool PPISegmenter::checkNEV(const VoxClass voxClass, const size_t voxPPI,
 }
 
 // TODO(lf): special algorithm trajectory for S_DIRECT_EDGE_VOXEL
-inline void PPISegmenter::refinePointsPPIs(std::vector<size_t>& pointsPPIs, const std::vector<size_t>& pointsIndices, const double weight,
+// Return the number of points whose PPI has changed
+inline size_t PPISegmenter::refinePointsPPIs(std::vector<typePPI>& pointsPPIs, const std::vector<size_t>& pointsIndices, const double weight,
                                            const std::array<size_t,6>& voxExtendedScore) const {
     std::array<double,6> weightedScoreSmooth{0};
     for (size_t k = 0; k < p_->projectionPlaneCount; ++k) {
@@ -199,6 +236,7 @@ inline void PPISegmenter::refinePointsPPIs(std::vector<size_t>& pointsPPIs, cons
     }
 
     // For each point in the current voxel //
+    size_t ppiChangeCount = 0;
     for (const auto& pointIndex : pointsIndices) {
         const auto& normal = pointsNormals_[pointIndex];
         double scoreMax = weightedScoreSmooth[0] + dotProduct(normal, p_->projectionPlaneOrientations[0]);
@@ -210,13 +248,15 @@ inline void PPISegmenter::refinePointsPPIs(std::vector<size_t>& pointsPPIs, cons
                 PPIscoreMax = k;
             }
         }
-        pointsPPIs[pointIndex] = PPIscoreMax;
+        ppiChangeCount += static_cast<size_t>(pointsPPIs[pointIndex] != PPIscoreMax);
+        pointsPPIs[pointIndex] = static_cast<typePPI>(PPIscoreMax);
     }
+    return ppiChangeCount;
 }
 
-void PPISegmenter::voxelizationWithBitArray(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& inputPointsGeometry,
-                                            std::vector<bool>& occFlagArray, robin_hood::unordered_map<size_t, size_t>& voxelIdxMap,
-                                            std::vector<size_t>& filledVoxels, std::vector<std::vector<size_t>>& pointListInVoxels) {
+void PPISegmenter::voxelizationWithSparseGrid(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& inputPointsGeometry,
+                                              SparseVoxelGrid& voxelGrid, std::vector<size_t>& filledVoxels,
+                                              std::vector<std::vector<size_t>>& pointListInVoxels) {
     const size_t voxelizationShift =
         p_->geoBitDepthVoxelized - p_->geoBitDepthRefineSegmentation;  // i.e. : 9 - 8 = 1 (meaning 2x2x2 voxel dimension)
     const size_t gbdrs = p_->geoBitDepthRefineSegmentation;
@@ -225,7 +265,7 @@ void PPISegmenter::voxelizationWithBitArray(const std::vector<uvgutils::VectorN<
     // TODO(lf): this is a simple heuristic from longdress (10->9->8). At least round up to the power of 2
     // (as it will already be done by the reserve function)
     const size_t estimatedVoxelCount = 3U * (inputPointsGeometry.size() >> (voxelizationShift * 3U));
-    voxelIdxMap.reserve(estimatedVoxelCount);
+    voxelGrid.reserve(estimatedVoxelCount);
     filledVoxels.reserve(estimatedVoxelCount);
     pointListInVoxels.reserve(estimatedVoxelCount);
 
@@ -235,25 +275,18 @@ void PPISegmenter::voxelizationWithBitArray(const std::vector<uvgutils::VectorN<
     // it be better to reserve the main vector with constant sized (already allocated) smaller vectors and then call resize(0) on each of them
     // before to add the first point ?
 
-    size_t vox_id = 0;
     for (size_t point_idx = 0; point_idx < inputPointsGeometry.size(); ++point_idx) {
         const uvgutils::VectorN<typeGeometryInput, 3>& inputPoint = inputPointsGeometry[point_idx];
 
         const int vx = inputPoint[0] >> voxelizationShift;
         const int vy = inputPoint[1] >> voxelizationShift;
         const int vz = inputPoint[2] >> voxelizationShift;
-        const size_t pos_1D = location1DFromCoordinates<uint64_t>(vx, vy, vz, gbdrs,gbdrs2);
-
-        if (!occFlagArray[pos_1D]) {
-            occFlagArray[pos_1D] = true;
-            voxelIdxMap.emplace(pos_1D, vox_id++);
-            filledVoxels.emplace_back(pos_1D);
+        const size_t filled_v_idx = voxelGrid.insert(vx, vy, vz, static_cast<SparseVoxelGrid::IndexType>(filledVoxels.size()));
+        if (filled_v_idx == filledVoxels.size()) {
+            filledVoxels.emplace_back(location1DFromCoordinates<uint64_t>(vx, vy, vz, gbdrs, gbdrs2));
             pointListInVoxels.emplace_back().reserve(estimatedPointsPerVoxel);
-            pointListInVoxels.back().push_back(point_idx);
-        } else {
-            const size_t filled_v_idx = voxelIdxMap.at(pos_1D);
-            pointListInVoxels[filled_v_idx].push_back(point_idx);
         }
+        pointListInVoxels[filled_v_idx].push_back(point_idx);
     }
 }
 
@@ -289,23 +322,22 @@ in a voxel. The former is usually isolated points, and the latter indicates the
 // TODO(lf): in the whole refine segmentation, be consistent between talking about grid cell or voxel
 // TODO(lf): use two flags, compute one time the flag for S or M instead of checking it like the other classification
 // TODO(lf): the refine segmentation voxelization (voxel dim etc..) should depend on geometry bit, not on the max range
-void PPISegmenter::refineSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<size_t>& pointsPPIs,
+void PPISegmenter::refineSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<typePPI>& pointsPPIs,
                                       const size_t& frameId) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION", "Refine segmentation of frame " + std::to_string(frameId) + "\n");
+    StatsCollector& stats = StatsCollector::instance();
     const size_t gbdrs = p_->geoBitDepthRefineSegmentation;
     const size_t gbdrs2 = p_->geoBitDepthRefineSegmentation * 2;
     const size_t gridSize = 1U << gbdrs;
     const int maxVal = gridSize - 1;
     
-    // One boolean for each voxel of the grid, indicating if a voxel is filled or not //
-    std::vector<bool> occFlagArray(gridSize * gridSize * gridSize, false);
-
-    robin_hood::unordered_map<size_t, size_t> voxelIdxMap;  // location1D -> index in voxel list (filledVoxels)
+    // Index in the voxel list (filledVoxels) of each filled voxel of the grid //
+    SparseVoxelGrid voxelGrid;
 
     std::vector<size_t> filledVoxels;                    // list of location1D
     std::vector<std::vector<size_t>> pointListInVoxels;  // for each voxel, the list of the index of the points inside
 
-    voxelizationWithBitArray(pointsGeometry_, occFlagArray, voxelIdxMap, filledVoxels, pointListInVoxels);
+    voxelizationWithSparseGrid(pointsGeometry_, voxelGrid, filledVoxels, pointListInVoxels);
 
     const size_t voxelCount = filledVoxels.size();
 
@@ -314,20 +346,18 @@ void PPISegmenter::refineSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>&
     }
 
     // The 1st classification is made here (+ score computation)
-    std::vector<VoxelAttribute> voxAttributeList(voxelCount, VoxelAttribute(p_->projectionPlaneCount));
+    VoxelAttributes voxAttributes(voxelCount);
     for (size_t v_idx = 0; v_idx < filledVoxels.size(); ++v_idx) {
         // Iterate through all voxels to set score, classification and voxel PPI //
         // First classification : NE-V or DE-V (SDE-V or MDE-V) //
-        VoxelAttribute& voxAttribute = voxAttributeList[v_idx];
         if (pointListInVoxels[v_idx].size() == 1) {
             // Single Direct Edge Voxel : One point in the voxel //
-            voxAttribute.voxClass_ = VoxClass::S_DIRECT_EDGE;
+            voxAttributes.classes[v_idx] = VoxClass::S_DIRECT_EDGE;
         }
-        updateVoxelAttribute(voxAttribute, pointListInVoxels[v_idx], pointsPPIs);
+        updateVoxelAttribute(voxAttributes, v_idx, pointListInVoxels[v_idx], pointsPPIs);
     }
 
-    std::vector<std::vector<size_t>> ADJ_List(voxelCount);   // large    // This is voxNeighborsList
-    std::vector<std::vector<size_t>> IDEV_List(voxelCount);  // small    // This is voxAdjacentsList
+    VoxelAdjacency adjacency(voxelCount);  // ADJ_List (voxNeighborsList) and IDEV_List (voxAdjacentsList) of each voxel
     std::vector<double> voxWeightList(voxelCount);
 
     // TODO(lf): find a way to break the refine segmentation iteration before reaching the number of iteration parameter (if number of updated
@@ -336,34 +366,28 @@ void PPISegmenter::refineSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>&
     // TODO(lf): in the for loop over all voxel, we access a lot of list to get the related voxel element. Why not TODO(lf)a structure voxel
     // with everything at the same memory location and so reduce memory call ?
 
-    std::array<size_t, 6> voxExtendedScore{0};
-    std::vector<uint8_t> hasBeenComputed(voxelCount, 0);
-
     const size_t bitMask = (1U << gbdrs) - 1;
     const size_t distanceSearch = p_->refineSegmentationMaxNNVoxelDistanceLUT;
-
-    for (size_t iter = 0; iter < p_->refineSegmentationIterationCount; ++iter) {
-        for (size_t voxelIndex = 0; voxelIndex < voxelCount; ++voxelIndex) {
-            // TODO(lf): should we use a stack of voxel index instead of a for loop with a lot of if(true) ?
-            const VoxClass& voxClass = voxAttributeList[voxelIndex].voxClass_;
-            if (voxClass == VoxClass::NO_EDGE) {
-                if(p_->exportStatistics){
-                    stats.collectData(frame->frameId, DataId::SkippedVoxels, iter);
-                }
-                continue;  // This voxel has been marked as NE-V before the current iteration //
-            }
-            
-            voxExtendedScore.fill(0);
-            if(hasBeenComputed[voxelIndex] == 1){
-                computeExtendedScore(voxExtendedScore, ADJ_List[voxelIndex], voxAttributeList);
-            } else {
-                hasBeenComputed[voxelIndex] = 1;
-            
+    const size_t IDEV_range = p_->refineSegmentationIDEVDist; // TODO(lf)justifiy this value, and make it dependent on the geobitdepth
+
+    // Build the adjacency rows of the given voxels, in parallel. Each task writes the rows of its voxels in a local buffer, then the buffers
+    // are appended to the graph.
+    std::vector<size_t> rowVoxels;
+    const auto buildAdjacencyRows = [&]() {
+        const size_t chunkCount = (rowVoxels.size() + refineBatchSize - 1) / refineBatchSize;
+        std::vector<std::vector<uint32_t>> chunkNeighbors(chunkCount);
+        currentContext->jobManager.parallelFor(rowVoxels.size(), refineBatchSize, [&](const size_t begin, const size_t end) {
+            SparseVoxelGrid::Cursor voxelCursor(voxelGrid);
+            std::vector<uint32_t>& rowNeighbors = chunkNeighbors[begin / refineBatchSize];
+            for (size_t i = begin; i < end; ++i) {
+                const size_t voxelIndex = rowVoxels[i];
                 const size_t cur_pos_1D = filledVoxels[voxelIndex];
                 const int curz = cur_pos_1D >> gbdrs2;
                 const int cury = (cur_pos_1D >> gbdrs) & bitMask;
                 const int curx = cur_pos_1D & bitMask;
-                
+
+                const size_t rowStart = rowNeighbors.size();
+                size_t idevLength = 0;
                 size_t num_nn_points = 0;
                 for (size_t dist = 0; dist < distanceSearch; ++dist) {  // dist is squared distance
                     for (const auto& shift : adjacentPointsSearch[dist]) {
@@ -374,88 +398,158 @@ void PPISegmenter::refineSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>&
 
                         if (x < 0 || x > maxVal || y < 0 || y > maxVal || z < 0 || z > maxVal) continue;
 
-                        const size_t adjLoc1D = location1DFromCoordinates<uint64_t>(x,y,z,gbdrs,gbdrs2);
-                        if (occFlagArray[adjLoc1D]) {
-                            const size_t neighbor_v_idx = voxelIdxMap.at(adjLoc1D);
-                            // ADJ_List.push_back(neighbor_v_idx);  // TODO(lf): do a big check everywhere because here adjacent and neighbor are inverted
-                            ADJ_List[voxelIndex].push_back(neighbor_v_idx);
-            
-                            // Extended score computation
-                            for (size_t k = 0; k < p_->projectionPlaneCount; ++k) {
-                                voxExtendedScore[k] += voxAttributeList[neighbor_v_idx].voxScore_[k];
-                            }
-            
-                            const size_t IDEV_range = p_->refineSegmentationIDEVDist; // TODO(lf)justifiy this value, and make it dependent on the geobitdepth
+                        const uint32_t neighbor_v_idx = voxelCursor.find(x, y, z);
+                        if (neighbor_v_idx != SparseVoxelGrid::emptyVoxel) {
+                            // TODO(lf): do a big check everywhere because here adjacent and neighbor are inverted
+                            rowNeighbors.push_back(neighbor_v_idx);
                             if (dist <= IDEV_range) {
-                                IDEV_List[voxelIndex].push_back(neighbor_v_idx);
+                                ++idevLength;
                             }
-            
                             num_nn_points += pointListInVoxels[neighbor_v_idx].size();
                         }
                     }
                 }
+                adjacency.rowLength[voxelIndex] = static_cast<uint32_t>(rowNeighbors.size() - rowStart);
+                adjacency.rowIdevLength[voxelIndex] = static_cast<uint32_t>(idevLength);
                 voxWeightList[voxelIndex] = p_->refineSegmentationLambda / static_cast<double>(num_nn_points);  // NOLINT(clang-analyzer-core.DivideZero)
             }
+        });
 
-            updateAdjacentVoxelsClass(voxAttributeList, voxExtendedScore, IDEV_List[voxelIndex]);
-            if (checkNEV(voxClass, voxAttributeList[voxelIndex].voxPPI_, voxExtendedScore)) {
-                continue;  // The current iteration found that this voxel is NE-V //
+        for (size_t chunkIdx = 0; chunkIdx < chunkCount; ++chunkIdx) {
+            size_t rowBegin = adjacency.neighbors.size();
+            for (size_t i = chunkIdx * refineBatchSize; i < std::min(rowVoxels.size(), (chunkIdx + 1) * refineBatchSize); ++i) {
+                adjacency.rowBegin[rowVoxels[i]] = rowBegin;
+                rowBegin += adjacency.rowLength[rowVoxels[i]];
             }
+            adjacency.neighbors.insert(adjacency.neighbors.end(), chunkNeighbors[chunkIdx].begin(), chunkNeighbors[chunkIdx].end());
+        }
+    };
+
+    // Each iteration is a Jacobi-style pass : the voxel scores and classifications of the previous iteration are read, and the changes are
+    // written in separate buffers (points PPIs, update flags and 'promotedVoxels') that are applied at the end of the iteration. The voxels of
+    // the iteration are thus processed in parallel on the library thread pool.
+    // In the serial order, a NE-V promoted to IDE-V by a voxel located before it is processed during the same iteration. Such voxels form the
+    // next round of the iteration, so the result is the same as the one of the serial pass.
+    std::vector<size_t> roundVoxels;            // Voxels processed by the current round of the iteration
+    std::vector<uint8_t> isProcessed(voxelCount);  // Voxels processed by the current iteration
+    std::vector<uint8_t> promotedVoxels(voxelCount);
+    LocalStats frameStats(p_->exportStatistics ? p_->refineSegmentationIterationCount : 0);
+
+    const auto processVoxel = [&](const size_t voxelIndex, std::vector<size_t>& promotedAfter, LocalStats& chunkStats, const size_t iter) {
+        std::array<size_t, 6> voxExtendedScore{0};
+        computeExtendedScore(voxExtendedScore, adjacency.row(voxelIndex), voxAttributes);
+
+        updateAdjacentVoxelsClass(promotedVoxels, promotedAfter, voxAttributes, voxExtendedScore, adjacency.idevRow(voxelIndex), voxelIndex);
+        if (checkNEV(voxAttributes.classes[voxelIndex], voxAttributes.ppis[voxelIndex], voxExtendedScore)) {
+            return;  // The current iteration found that this voxel is NE-V //
+        }
 
-            // The voxel is not NE-V, so it is D-EV or IDE-V and its points PPI can be refined //
-            if(p_->exportStatistics){
-                std::vector<size_t> previousPointsPPI = pointsPPIs;
-                refinePointsPPIs(pointsPPIs, pointListInVoxels[voxelIndex], voxWeightList[voxelIndex], voxExtendedScore);
-                voxAttributeList[voxelIndex].updateFlag_ = true;
-                for(size_t i = 0 ; i < pointsPPIs.size() ; ++i){
-                    if(previousPointsPPI[i] != pointsPPIs[i]){
-                        stats.collectData(frame->frameId, DataId::PpiChange, iter);
-                    }
-                }
+        // The voxel is not NE-V, so it is D-EV or IDE-V and its points PPI can be refined //
+        const size_t ppiChangeCount = refinePointsPPIs(pointsPPIs, pointListInVoxels[voxelIndex], voxWeightList[voxelIndex], voxExtendedScore);
+        voxAttributes.updateFlags[voxelIndex] = 1;
+
+        if(p_->exportStatistics){
+            chunkStats.add(DataId::PpiChange, iter, ppiChangeCount);
+            chunkStats.add(DataId::ScoreComputations, iter, pointListInVoxels[voxelIndex].size());
+            // A NE-V voxel processed by this iteration has been promoted to IDE-V
+            switch (voxAttributes.classes[voxelIndex]){
+                case VoxClass::NO_EDGE:       chunkStats.add(DataId::IndirectEdge_R, iter); break;
+                case VoxClass::INDIRECT_EDGE: chunkStats.add(DataId::IndirectEdge_R, iter); break;
+                case VoxClass::S_DIRECT_EDGE: chunkStats.add(DataId::SingleEdge_R,   iter); break;
+                case VoxClass::M_DIRECT_EDGE: chunkStats.add(DataId::MultiEdge_R,    iter); break;
             }
-            else{
-                refinePointsPPIs(pointsPPIs, pointListInVoxels[voxelIndex], voxWeightList[voxelIndex], voxExtendedScore);
-                voxAttributeList[voxelIndex].updateFlag_ = true;
+        }
+    };
+
+    for (size_t iter = 0; iter < p_->refineSegmentationIterationCount; ++iter) {
+        // The NE-V voxels are skipped, as they have been marked as NE-V before the current iteration //
+        roundVoxels.clear();
+        for (size_t voxelIndex = 0; voxelIndex < voxelCount; ++voxelIndex) {
+            if (voxAttributes.classes[voxelIndex] != VoxClass::NO_EDGE) {
+                roundVoxels.push_back(voxelIndex);
+            }
+        }
+        std::fill(isProcessed.begin(), isProcessed.end(), 0);
+        std::fill(promotedVoxels.begin(), promotedVoxels.end(), 0);
+        size_t processedCount = 0;
+
+        while (!roundVoxels.empty()) {
+            for (const size_t voxelIndex : roundVoxels) {
+                isProcessed[voxelIndex] = 1;
             }
-            
-            if(p_->exportStatistics){
-                for(size_t i = 0 ; i < pointListInVoxels[voxelIndex].size() ; ++i){
-                    stats.collectData(frame->frameId, DataId::ScoreComputations, iter);
+            processedCount += roundVoxels.size();
+
+            // The adjacency of a voxel is built the first time it is processed //
+            rowVoxels.clear();
+            for (const size_t voxelIndex : roundVoxels) {
+                if (!adjacency.hasRow(voxelIndex)) {
+                    rowVoxels.push_back(voxelIndex);
                 }
-                switch (voxAttributeList[voxelIndex].voxClass_){
-                    case VoxClass::NO_EDGE:       stats.collectData(frame->frameId, DataId::NoEdge_R,       iter); break;
-                    case VoxClass::INDIRECT_EDGE: stats.collectData(frame->frameId, DataId::IndirectEdge_R, iter); break;
-                    case VoxClass::S_DIRECT_EDGE: stats.collectData(frame->frameId, DataId::SingleEdge_R,   iter); break;
-                    case VoxClass::M_DIRECT_EDGE: stats.collectData(frame->frameId, DataId::MultiEdge_R,    iter); break;
+            }
+            buildAdjacencyRows();
+
+            const size_t chunkCount = (roundVoxels.size() + refineBatchSize - 1) / refineBatchSize;
+            std::vector<std::vector<size_t>> promotedAfter(chunkCount);
+            std::vector<LocalStats> chunkStats(chunkCount, LocalStats(frameStats.iterationCount()));  // Empty if the statistics are disabled
+            currentContext->jobManager.parallelFor(roundVoxels.size(), refineBatchSize, [&](const size_t begin, const size_t end) {
+                const size_t chunkIdx = begin / refineBatchSize;
+                for (size_t i = begin; i < end; ++i) {
+                    processVoxel(roundVoxels[i], promotedAfter[chunkIdx], chunkStats[chunkIdx], iter);
                 }
+            });
+            for (const LocalStats& localStats : chunkStats) {
+                frameStats.merge(localStats);
             }
+
+            // Next round : the promoted voxels that have not been processed yet by this iteration //
+            roundVoxels.clear();
+            for (const std::vector<size_t>& chunkPromotedAfter : promotedAfter) {
+                for (const size_t voxelIndex : chunkPromotedAfter) {
+                    if (isProcessed[voxelIndex] == 0U) {
+                        roundVoxels.push_back(voxelIndex);
+                    }
+                }
+            }
+            std::sort(roundVoxels.begin(), roundVoxels.end());
+            roundVoxels.erase(std::unique(roundVoxels.begin(), roundVoxels.end()), roundVoxels.end());
+        }
+
+        if(p_->exportStatistics){
+            frameStats.add(DataId::SkippedVoxels, iter, voxelCount - processedCount);
         }
 
         // Update voxel classification and scores if points PPI inside have changed during the iteration //
-        for (size_t voxelIndex = 0; voxelIndex < voxelCount; ++voxelIndex) {
-            // TODO(lf): it might be faster to use a stack of index instead of using a flag
-            if (!voxAttributeList[voxelIndex].updateFlag_) {
-                continue;
+        currentContext->jobManager.parallelFor(voxelCount, refineBatchSize, [&](const size_t begin, const size_t end) {
+            for (size_t voxelIndex = begin; voxelIndex < end; ++voxelIndex) {
+                if (promotedVoxels[voxelIndex] != 0U && voxAttributes.classes[voxelIndex] == VoxClass::NO_EDGE) {
+                    voxAttributes.classes[voxelIndex] = VoxClass::INDIRECT_EDGE;
+                }
+                if (voxAttributes.updateFlags[voxelIndex] == 0U) {
+                    continue;
+                }
+                voxAttributes.updateFlags[voxelIndex] = 0;
+                voxAttributes.scores[voxelIndex].fill(0);
+                updateVoxelAttribute(voxAttributes, voxelIndex, pointListInVoxels[voxelIndex], pointsPPIs);
             }
-            voxAttributeList[voxelIndex].updateFlag_ = false;
-            std::fill(voxAttributeList[voxelIndex].voxScore_.begin(), voxAttributeList[voxelIndex].voxScore_.end(), 0);
-            updateVoxelAttribute(voxAttributeList[voxelIndex], pointListInVoxels[voxelIndex], pointsPPIs);
-        }
+        });
 
         // Compute de number of changes of classification
         if(p_->exportStatistics){
-            for(auto& voxel : voxAttributeList){
-                VoxClass VC = voxel.voxClass_;
+            for(const VoxClass VC : voxAttributes.classes){
                 switch (VC) {
-                    case VoxClass::NO_EDGE:       stats.collectData(frame->frameId, DataId::NoEdge,       iter); break;
-                    case VoxClass::INDIRECT_EDGE: stats.collectData(frame->frameId, DataId::IndirectEdge, iter); break;
-                    case VoxClass::S_DIRECT_EDGE: stats.collectData(frame->frameId, DataId::SingleEdge,   iter); break;
-                    case VoxClass::M_DIRECT_EDGE: stats.collectData(frame->frameId, DataId::MultiEdge,    iter); break;
+                    case VoxClass::NO_EDGE:       frameStats.add(DataId::NoEdge,       iter); break;
+                    case VoxClass::INDIRECT_EDGE: frameStats.add(DataId::IndirectEdge, iter); break;
+                    case VoxClass::S_DIRECT_EDGE: frameStats.add(DataId::SingleEdge,   iter); break;
+                    case VoxClass::M_DIRECT_EDGE: frameStats.add(DataId::MultiEdge,    iter); break;
                 }
             }
         }
     }
 
+    if(p_->exportStatistics){
+        stats.merge(frame->frameId, frameStats);
+    }
+
     if (p_->exportIntermediateFiles) {
         FileExport::exportPointCloudRefineSegmentation(frame, pointsGeometry_, pointsPPIs);
     }
@@ -35,8 +35,9 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 #include <vector>
-#include "patchGeneration/robin_hood.h"
+#include "patchGeneration/sparseVoxelGrid.hpp"
 #include "utils/constants.hpp"
 #include "uvgutils/utils.hpp"
 #include "uvgvpcc/uvgvpcc.hpp"
@@ -54,15 +55,17 @@ enum class VoxClass : uint8_t {
 // TODO(lf): Are S DIRECT EGDE always considered as direct edge ? Even if they share the same PPI as their neighbor ? Does this mean each
 // iteration focus on all single  direct edge voxel ?
 
-struct VoxelAttribute {
-    bool updateFlag_;
-    // size_t nbPoint_;  // TODO(lf): not used ?
-    VoxClass voxClass_;
-    size_t voxPPI_;
-    std::array<size_t, 6> voxScore_;  // TODO(lf): should be an array ?
-    // Voxel score is a PPI histogram : how many points inside the voxel is associated with each projection planes //
+// Attributes of the refine segmentation voxels, stored as one array per attribute (structure of arrays). The loops of an iteration only read
+// the attribute they need, so the classification pass and the neighbor score accumulation do not pull the others into the cache.
+struct VoxelAttributes {
+    // Voxel score is a PPI histogram : how many points inside the voxel is associated with each projection planes. The histogram of a
+    // voxel is kept contiguous, as the extended score reads all of it. (uint32_t, as the points count of a voxel is not bounded)
+    std::vector<std::array<uint32_t, 6>> scores;
+    std::vector<typePPI> ppis;
+    std::vector<VoxClass> classes;
+    std::vector<uint8_t> updateFlags;
 
-    explicit VoxelAttribute(const size_t projectionPlaneCount_);
+    explicit VoxelAttributes(size_t voxelCount);
 };
 
 class PPISegmenter {
@@ -70,27 +73,27 @@ class PPISegmenter {
     PPISegmenter(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
                  const std::vector<uvgutils::VectorN<double, 3>>& pointsNormals);
 
-    void initialSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,std::vector<size_t>& pointsPPIs, const size_t& frameId);
-    void refineSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,std::vector<size_t>& pointsPPIs, const size_t& frameId);
+    void initialSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,std::vector<typePPI>& pointsPPIs, const size_t& frameId);
+    void refineSegmentation(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,std::vector<typePPI>& pointsPPIs, const size_t& frameId);
 
    private:
-    static void voxelizationWithBitArray(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& inputPointsGeometry,
-                                         std::vector<bool>& occFlagArray, robin_hood::unordered_map<size_t, size_t>& voxelIdxMap,
-                                         std::vector<size_t>& filledVoxels, std::vector<std::vector<size_t>>& pointListInVoxels);                                               
+    static void voxelizationWithSparseGrid(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& inputPointsGeometry,
+                                           SparseVoxelGrid& voxelGrid, std::vector<size_t>& filledVoxels,
+                                           std::vector<std::vector<size_t>>& pointListInVoxels);
 
-    static void computeExtendedScore(std::array<size_t,6>& voxExtendedScore, const std::vector<size_t>& ADJ_List,
-                                               const std::vector<VoxelAttribute>& voxAttributeList);
+    static void computeExtendedScore(std::array<size_t,6>& voxExtendedScore, std::span<const uint32_t> ADJ_List,
+                                     const VoxelAttributes& voxAttributes);
 
-    static void updateAdjacentVoxelsClass(std::vector<VoxelAttribute>& voxAttributeList,
-                                                    const std::array<size_t,6>& voxExtendedScore,
-                                                    const std::vector<size_t>& IDEV_List);
-    static inline bool checkNEV(const VoxClass voxClass, const size_t voxPPI,
+    static void updateAdjacentVoxelsClass(std::vector<uint8_t>& promotedVoxels, std::vector<size_t>& promotedAfter,
+                                          const VoxelAttributes& voxAttributes, const std::array<size_t, 6>& voxExtendedScore,
+                                          std::span<const uint32_t> IDEV_List, size_t currentVoxelIndex);
+    static inline bool checkNEV(const VoxClass voxClass, const typePPI voxPPI,
                                           const std::array<size_t,6>& voxExtendedScore);
 
-    inline void refinePointsPPIs(std::vector<size_t>& pointsPPIs, const std::vector<size_t>& pointsIndices,
+    inline size_t refinePointsPPIs(std::vector<typePPI>& pointsPPIs, const std::vector<size_t>& pointsIndices,
                                            const double weight, const std::array<size_t, 6>& voxExtendedScore) const;
-    static inline void updateVoxelAttribute(VoxelAttribute& voxAttribute, const std::vector<size_t>& voxPoints,
-                                                      const std::vector<size_t>& pointsPPIs);
+    static inline void updateVoxelAttribute(VoxelAttributes& voxAttributes, size_t voxelIndex, const std::vector<size_t>& voxPoints,
+                                                      const std::vector<typePPI>& pointsPPIs);
     
     const std::vector<uvgutils::VectorN<double, 3>>& pointsNormals_;
     const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry_;
@@ -46,12 +46,13 @@
 #include <limits>
 #include <memory>
 #include <mutex>
-#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
 #include "slicingPpiSegmenter.hpp"
 #include "robin_hood.h"
+#include "utils/encoderContext.hpp"
 #include "utils/fileExport.hpp"
 #include "utils/parameters.hpp"
 #include "utils/constants.hpp"
@@ -77,6 +78,23 @@ static std::mutex exportMapMutex;  // For intermediate files exportation only
 
 namespace {
 
+constexpr size_t slicesPerTask = 16;  // Number of consecutive slice levels woven in a single task of the thread pool
+
+// The child/parent links of an axis are stored in a vector indexed by the child point index (point indices are dense), holding the index
+// of the parent point. 'PARENT_NA' marks the points which are not a child on this axis. As the point count is lower or equal to the maximum
+// value of 'indexType', this value is never a point index.
+template <typename indexType>
+constexpr indexType PARENT_NA = std::numeric_limits<indexType>::max();
+
+// Slices of an axis : the indices of the points of all slices in a single buffer, grouped by slice level. The points of the slice 'level'
+// are in [offsets[level], offsets[level + 1]).
+struct AxisSlices {
+    std::vector<size_t> points;
+    std::vector<size_t> offsets;
+
+    std::span<size_t> slice(const size_t level) { return {points.data() + offsets[level], offsets[level + 1] - offsets[level]}; }
+};
+
 template <const std::array<size_t, 2>& axis>
 constexpr size_t AxisIndex() {
     if constexpr (axis == axisX) {
@@ -264,7 +282,7 @@ struct MapSearch {
     robin_hood::unordered_flat_map<size_t, size_t> pos1DToIndexSlicePointsNotInASubsliceYet;
     std::vector<size_t> currentSubsliceChildPos1D;
 
-    MapSearch(const std::vector<size_t>& slice, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry) {
+    MapSearch(const std::span<const size_t> slice, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry) {
         pos1DToIndexSlicePointsNotInASubsliceYet.reserve(slice.size());
         currentSubsliceChildPos1D.reserve(slice.size());
 
@@ -299,8 +317,8 @@ struct MapSearch {
 
 template <typename indexType,const std::array<size_t, 2>& axis>
 inline bool findNSetNextPoint(size_t& bestCandidateIndexSlice, size_t& distanceBestCandidate,
-                              robin_hood::unordered_map<indexType, size_t>& childToParentAxis, const size_t& currentPointIndexPG,
-                              const std::vector<size_t>& slice, std::vector<bool>& isInASubslice, MapSearch<axis>& mapSearch,
+                              std::vector<indexType>& childToParentAxis, const size_t& currentPointIndexPG,
+                              const std::span<const size_t> slice, std::vector<bool>& isInASubslice, MapSearch<axis>& mapSearch,
                               const Point2D& currentPoint2D, const Vector2D& previousVector) {
     const size_t bitDepth = 1U << p_->geoBitDepthVoxelized;
 
@@ -358,7 +376,7 @@ inline bool findNSetNextPoint(size_t& bestCandidateIndexSlice, size_t& distanceB
             if (isInASubslice[neighborIndexSlice]) continue;
             isInASubslice[neighborIndexSlice] = true;
             const indexType neighborIndexPG = slice[neighborIndexSlice];
-            childToParentAxis[neighborIndexPG] = currentPointIndexPG;
+            childToParentAxis[neighborIndexPG] = static_cast<indexType>(currentPointIndexPG);
             mapSearch.addSubsliceChild(adjPos1D);
         }
     }
@@ -436,16 +454,22 @@ inline bool compareBestCandidateAndStartingScores(const Point2D& bestCandidatePo
     // is worse than the score of the best candidate. The best candidate will then become the next point. This is not the end of the subslice.
 }
 
+// The points are sorted along the first axis of the slice plane. The order of the points sharing the same coordinate is the one given by
+// std::sort, which the weaving depends on, so a stable (e.g. radix) sort would change the result. The coordinate is instead packed with the
+// point index in a single word : the comparisons, and thus the resulting order, are the same as when sorting the indices, but the sort no
+// longer reads the geometry of the points.
 template <const std::array<size_t, 2>& axis>
-inline void sortSlice(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, std::vector<size_t>& slice) {
-    std::sort(slice.begin(), slice.end(), [&](const size_t& a, const size_t& b) {
-        // if (pointsGeometry[a][axis[0]] == pointsGeometry[b][axis[0]]) {
-        // Allow consistency
-        //     return pointsGeometry[a][axis[1]] < pointsGeometry[b][axis[1]];
-        // }
-        // with a runtime parameter, it slows down the execution. We would need compilation time parameters
-        return pointsGeometry[a][axis[0]] < pointsGeometry[b][axis[0]];
-    });
+inline void sortSlice(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, const std::span<size_t> slice,
+                      std::vector<uint64_t>& sortBuffer) {
+    constexpr size_t keyShift = 48;  // The point indices are lower than 2^48
+    sortBuffer.resize(slice.size());
+    for (size_t i = 0; i < slice.size(); ++i) {
+        sortBuffer[i] = (static_cast<uint64_t>(pointsGeometry[slice[i]][axis[0]]) << keyShift) | slice[i];
+    }
+    std::sort(sortBuffer.begin(), sortBuffer.end(), [](const uint64_t& a, const uint64_t& b) { return (a >> keyShift) < (b >> keyShift); });
+    for (size_t i = 0; i < slice.size(); ++i) {
+        slice[i] = sortBuffer[i] & ((uint64_t{1} << keyShift) - 1);
+    }
 }
 
 template <const std::array<size_t, 2>& axis>
@@ -486,9 +510,9 @@ template <typename indexType,const std::array<size_t, 2>& axis>
 void subsliceWeaving(
     const size_t subsliceStartingPointIndexPG,  // Point geometry (global shared indexing) index of the starting point in the subslice
     const Point2D& startingPoint2D,
-    const std::vector<size_t>& slice,  // Slice containing the point indices in PG
+    const std::span<const size_t> slice,  // Slice containing the point indices in PG
     const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-    robin_hood::unordered_map<indexType, size_t>& childToParentAxis,
+    std::vector<indexType>& childToParentAxis,
     std::vector<bool>& isInASubslice,           // Flags to track which slice points are already in a subslice
     std::vector<size_t>& parentOrderedIndexPG,  // Ordered list of parents (global indices)
     std::vector<PPI>& parentOrderedPPIs,        // Ordered list of PPIs corresponding to parents
@@ -522,7 +546,7 @@ void subsliceWeaving(
             if (closeSubslice) {
                 if (!isInASubslice[bestCandidateIndexSlice]) {
                     // Mark the best candidate as child of the current point
-                    childToParentAxis[bestCandidateIndexPG] = currentPointIndexPG;
+                    childToParentAxis[bestCandidateIndexPG] = static_cast<indexType>(currentPointIndexPG);
                     isInASubslice[bestCandidateIndexSlice] = true;
                 }
                 break;  // Subslice ends by looping back to its starting point
@@ -549,7 +573,7 @@ void subsliceWeaving(
 
         if (isInASubslice[bestCandidateIndexSlice]) {
             // The best candidate point has been marked as a child previously in this subslice. Remove this child/parent link.
-            childToParentAxis.erase(bestCandidateIndexPG);
+            childToParentAxis[bestCandidateIndexPG] = PARENT_NA<indexType>;
         } else {
             isInASubslice[bestCandidateIndexSlice] = true;
         }
@@ -588,8 +612,8 @@ void subsliceWeaving(
 }
 
 template <typename indexType,const std::array<size_t, 2>& axis>
-void sliceWeaving(const std::vector<size_t>& slice, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                  robin_hood::unordered_map<indexType, size_t>& childToParentAxis, std::vector<PPI>& pointPPIsAxis, const size_t& frameId) {
+void sliceWeaving(const std::span<const size_t> slice, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
+                  std::vector<indexType>& childToParentAxis, std::vector<PPI>& pointPPIsAxis, const size_t& frameId) {
     const size_t sliceSize = slice.size();
     int startingPointIndexSlice = -1;
 
@@ -645,33 +669,33 @@ void sliceWeaving(const std::vector<size_t>& slice, const std::vector<uvgutils::
 }
 
 template<typename indexType>
-void childPPIAttribution(const robin_hood::unordered_map<indexType, size_t>& childToParentX,
-                         const robin_hood::unordered_map<indexType, size_t>& childToParentY,
-                         const robin_hood::unordered_map<indexType, size_t>& childToParentZ, std::vector<size_t>& pointPPIs) {
+void childPPIAttribution(const std::vector<indexType>& childToParentX,
+                         const std::vector<indexType>& childToParentY,
+                         const std::vector<indexType>& childToParentZ, std::vector<typePPI>& pointPPIs) {
     for (size_t ptIndexPG = 0; ptIndexPG < pointPPIs.size(); ++ptIndexPG) {
         if (pointPPIs[ptIndexPG] < 6) continue;  // Already has a PPI
 
-        auto itY = childToParentY.find(ptIndexPG);
-        if (itY != childToParentY.end()) {
-            const size_t ppiParentY = pointPPIs[itY->second];
+        const indexType parentY = childToParentY[ptIndexPG];
+        if (parentY != PARENT_NA<indexType>) {
+            const typePPI ppiParentY = pointPPIs[parentY];
             if (ppiParentY < 6) {
                 pointPPIs[ptIndexPG] = ppiParentY;
                 continue;
             }
         }
 
-        auto itX = childToParentX.find(ptIndexPG);
-        if (itX != childToParentX.end()) {
-            const size_t ppiParentX = pointPPIs[itY->second];
+        const indexType parentX = childToParentX[ptIndexPG];
+        if (parentX != PARENT_NA<indexType>) {
+            const typePPI ppiParentX = pointPPIs[parentX];
             if (ppiParentX < 6) {
                 pointPPIs[ptIndexPG] = ppiParentX;
                 continue;
             }
         }
 
-        auto itZ = childToParentZ.find(ptIndexPG);
-        if (itZ != childToParentZ.end()) {
-            const size_t ppiParentZ = pointPPIs[itY->second];
+        const indexType parentZ = childToParentZ[ptIndexPG];
+        if (parentZ != PARENT_NA<indexType>) {
+            const typePPI ppiParentZ = pointPPIs[parentZ];
             if (ppiParentZ < 6) {
                 pointPPIs[ptIndexPG] = ppiParentZ;
                 continue;
@@ -682,39 +706,33 @@ void childPPIAttribution(const robin_hood::unordered_map<indexType, size_t>& chi
     }
 }
 
-void createSlices(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                  std::vector<std::optional<std::vector<size_t>>>& levelToSliceX,
-                  std::vector<std::optional<std::vector<size_t>>>& levelToSliceY,
-                  std::vector<std::optional<std::vector<size_t>>>& levelToSliceZ) {
+// The slices of the three axes are built by a counting sort of the points on their coordinate along each axis. The points of a slice are in
+// increasing index order.
+void createSlices(const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, std::array<AxisSlices, 3>& axesSlices) {
     const size_t nbMaxSlices = (1U << p_->geoBitDepthVoxelized);
-    const size_t estNbPointsPerSlice = nbMaxSlices * 2;
-
-    for (size_t ptIndexPG = 0; ptIndexPG < pointsGeometry.size(); ++ptIndexPG) {
-        const auto& point = pointsGeometry[ptIndexPG];
 
-        // X axis
-        auto& xSlice = levelToSliceX[point[0]];
-        if (!xSlice.has_value()) {
-            xSlice = std::vector<size_t>();
-            xSlice->reserve(estNbPointsPerSlice);
+    for (size_t axisIndex = 0; axisIndex < 3; ++axisIndex) {
+        AxisSlices& axisSlices = axesSlices[axisIndex];
+        axisSlices.offsets.assign(nbMaxSlices + 1, 0);
+        axisSlices.points.resize(pointsGeometry.size());
+        for (const auto& point : pointsGeometry) {
+            ++axisSlices.offsets[point[axisIndex] + 1];
         }
-        xSlice->push_back(ptIndexPG);
-
-        // Y axis
-        auto& ySlice = levelToSliceY[point[1]];
-        if (!ySlice.has_value()) {
-            ySlice = std::vector<size_t>();
-            ySlice->reserve(estNbPointsPerSlice);
+        for (size_t level = 0; level < nbMaxSlices; ++level) {
+            axisSlices.offsets[level + 1] += axisSlices.offsets[level];
         }
-        ySlice->push_back(ptIndexPG);
+    }
 
-        // Z axis
-        auto& zSlice = levelToSliceZ[point[2]];
-        if (!zSlice.has_value()) {
-            zSlice = std::vector<size_t>();
-            zSlice->reserve(estNbPointsPerSlice);
+    // Position of the next point of each slice
+    std::array<std::vector<size_t>, 3> insertPositions;
+    for (size_t axisIndex = 0; axisIndex < 3; ++axisIndex) {
+        insertPositions[axisIndex].assign(axesSlices[axisIndex].offsets.begin(), axesSlices[axisIndex].offsets.end() - 1);
+    }
+    for (size_t ptIndexPG = 0; ptIndexPG < pointsGeometry.size(); ++ptIndexPG) {
+        const auto& point = pointsGeometry[ptIndexPG];
+        for (size_t axisIndex = 0; axisIndex < 3; ++axisIndex) {
+            axesSlices[axisIndex].points[insertPositions[axisIndex][point[axisIndex]]++] = ptIndexPG;
         }
-        zSlice->push_back(ptIndexPG);
     }
 }
 
@@ -771,19 +789,25 @@ void createTempPointCloudForSlicingExportation(const std::shared_ptr<Frame>& fra
     FileExport::exportPointCloudSubslices(frame, pointsGeometry, attributes, axisStr);
 }
 
+// The slices are independent : a slice only writes the PPIs and the child/parent links of its own points, so they are woven in parallel.
+// The intermediate files need the subslices in the serial order, so their exportation keeps a single task.
 template <typename indexType, const std::array<size_t, 2>& axis>
-inline void axisSlicesWeaving(std::vector<std::optional<std::vector<size_t>>>& levelToSlice,
+inline void axisSlicesWeaving(AxisSlices& axisSlices,
                               const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                              robin_hood::unordered_map<indexType, size_t>& childToParent, std::vector<PPI>& pointPPIsAxis,
+                              std::vector<indexType>& childToParent, std::vector<PPI>& pointPPIsAxis,
                               const size_t& frameId) {
-    childToParent.reserve(pointsGeometry.size());
-    for (auto& sliceOpt : levelToSlice) {
-        if (sliceOpt.has_value()) {
-            auto& slice = sliceOpt.value();
-            sortSlice<axis>(pointsGeometry, slice);
-            sliceWeaving<indexType,axis>(slice, pointsGeometry, childToParent, pointPPIsAxis, frameId);
+    const size_t levelCount = axisSlices.offsets.size() - 1;
+    const size_t levelsPerTask = p_->exportIntermediateFiles ? levelCount : slicesPerTask;
+    currentContext->jobManager.parallelFor(levelCount, levelsPerTask, [&](const size_t begin, const size_t end) {
+        std::vector<uint64_t> sortBuffer;
+        for (size_t level = begin; level < end; ++level) {
+            const std::span<size_t> slice = axisSlices.slice(level);
+            if (!slice.empty()) {
+                sortSlice<axis>(pointsGeometry, slice, sortBuffer);
+                sliceWeaving<indexType,axis>(slice, pointsGeometry, childToParent, pointPPIsAxis, frameId);
+            }
         }
-    }
+    });
 }
 
 // TODO(lf): use PPI type everywhere
@@ -810,21 +834,21 @@ inline uvgutils::VectorN<double, 3> ppiToNormal(const PPI& ppi) {
     return {0.0, 0.0, 0.0};
 }
 
-inline size_t getParentPpi(const PPI& ppiX, const PPI& ppiY, const PPI& ppiZ, const size_t& nAttributions, bool& hasNormal) {
+inline typePPI getParentPpi(const PPI& ppiX, const PPI& ppiY, const PPI& ppiZ, const size_t& nAttributions, bool& hasNormal) {
     if (nAttributions == 1) return UNDEFINED_PARENT_PPI;
 
     // If two axes agree → choose that PPI and mark point as weighted (unity normal)
     if (ppiX == ppiY || ppiZ == ppiY) {
         hasNormal = true;
-        return static_cast<size_t>(ppiY);
+        return static_cast<typePPI>(ppiY);
     }
     if (ppiX == ppiZ) {
         hasNormal = true;
-        return static_cast<size_t>(ppiX);
+        return static_cast<typePPI>(ppiX);
     }
     if (nAttributions == 3) {
         // All axis ppi differ → pick Y-axis PPI, but point is not weighted (normal stays (0,0,0))
-        return static_cast<size_t>(ppiY);
+        return static_cast<typePPI>(ppiY);
     }
 
     // nAttributions==2 but the two temporary axis ppi differ → undefined parent
@@ -832,10 +856,10 @@ inline size_t getParentPpi(const PPI& ppiX, const PPI& ppiY, const PPI& ppiZ, co
 }
 
 template<typename indexType>
-inline size_t getUndefinedParentPpi(const std::vector<size_t>& pointPPIs, const PPI& ppiX, const PPI& ppiY, const PPI& ppiZ,
-                                    const robin_hood::unordered_map<indexType, size_t>& childToParentX,
-                                    const robin_hood::unordered_map<indexType, size_t>& childToParentY,
-                                    const robin_hood::unordered_map<indexType, size_t>& childToParentZ, const size_t& idx) {
+inline typePPI getUndefinedParentPpi(const std::vector<typePPI>& pointPPIs, const PPI& ppiX, const PPI& ppiY, const PPI& ppiZ,
+                                    const std::vector<indexType>& childToParentX,
+                                    const std::vector<indexType>& childToParentY,
+                                    const std::vector<indexType>& childToParentZ, const size_t& idx) {
     // An undefined parent is a point with ambiguous or incomplete PPI attribution.
     // Strategy:
     //  1) Try to inherit a valid PPI from its own parent along missing axes.
@@ -844,7 +868,8 @@ inline size_t getUndefinedParentPpi(const std::vector<size_t>& pointPPIs, const
 
     // Inherit from parent along Y-axis if this axis has no PPI
     if (ppiY == PPI::notAssigned) {
-        const size_t ppiParentY = pointPPIs[childToParentY.at(idx)];
+        assert(childToParentY[idx] != PARENT_NA<indexType>);
+        const typePPI ppiParentY = pointPPIs[childToParentY[idx]];
         if (ppiParentY < 6) {
             return ppiParentY;
         }
@@ -852,7 +877,8 @@ inline size_t getUndefinedParentPpi(const std::vector<size_t>& pointPPIs, const
 
     // Inherit from parent along X-axis
     if (ppiX == PPI::notAssigned) {
-        const size_t ppiParentX = pointPPIs[childToParentX.at(idx)];
+        assert(childToParentX[idx] != PARENT_NA<indexType>);
+        const typePPI ppiParentX = pointPPIs[childToParentX[idx]];
         if (ppiParentX < 6) {
             return ppiParentX;
         }
@@ -860,7 +886,8 @@ inline size_t getUndefinedParentPpi(const std::vector<size_t>& pointPPIs, const
 
     // Inherit from parent along Z-axis
     if (ppiZ == PPI::notAssigned) {
-        const size_t ppiParentZ = pointPPIs[childToParentZ.at(idx)];
+        assert(childToParentZ[idx] != PARENT_NA<indexType>);
+        const typePPI ppiParentZ = pointPPIs[childToParentZ[idx]];
         if (ppiParentZ < 6) {
             return ppiParentZ;
         }
@@ -868,9 +895,9 @@ inline size_t getUndefinedParentPpi(const std::vector<size_t>& pointPPIs, const
 
     // If no inheritance is possible → fallback to already assigned axis PPIs.
     // Axis priority: Y first, then X, then Z.
-    if (ppiY != PPI::notAssigned) return static_cast<size_t>(ppiY);
-    if (ppiX != PPI::notAssigned) return static_cast<size_t>(ppiX);
-    return static_cast<size_t>(ppiZ);
+    if (ppiY != PPI::notAssigned) return static_cast<typePPI>(ppiY);
+    if (ppiX != PPI::notAssigned) return static_cast<typePPI>(ppiX);
+    return static_cast<typePPI>(ppiZ);
 }
 
 // TODO(lf): in the end handle all memory swap etc...
@@ -878,9 +905,9 @@ template<typename indexType>
 void finalPPIAttributionFastPreset(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,
                                    const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
                                    const std::vector<PPI>& pointPPIsX, const std::vector<PPI>& pointPPIsY, const std::vector<PPI>& pointPPIsZ,
-                                   const robin_hood::unordered_map<indexType, size_t>& childToParentX,
-                                   const robin_hood::unordered_map<indexType, size_t>& childToParentY,
-                                   const robin_hood::unordered_map<indexType, size_t>& childToParentZ, std::vector<size_t>& pointPPIs) {
+                                   const std::vector<indexType>& childToParentX,
+                                   const std::vector<indexType>& childToParentY,
+                                   const std::vector<indexType>& childToParentZ, std::vector<typePPI>& pointPPIs) {
     const size_t nbPoints = pointsGeometry.size();
 
     // A parent point is a point with at least one temporary PPI
@@ -896,7 +923,7 @@ void finalPPIAttributionFastPreset(const std::shared_ptr<uvgvpcc_enc::Frame>& fr
     // 1) Only parent points are refined (need for temporary data structure).
     // 2) After refinement, children inherit PPI from their parents.
 
-    std::vector<size_t> parentPointsPPIs(nbPoints);
+    std::vector<typePPI> parentPointsPPIs(nbPoints);
     std::vector<uvgutils::VectorN<typeGeometryInput, 3>> parentPointsGeometry(nbPoints);
     std::vector<bool> normalBool(nbPoints, false);
     std::vector<size_t> parentPointsIndexInPG(nbPoints);
@@ -940,7 +967,7 @@ void finalPPIAttributionFastPreset(const std::shared_ptr<uvgvpcc_enc::Frame>& fr
     // Handle undefined parents (always considered non-weighted → normal (0,0,0)).
     for (size_t ptIndexPG = 0; ptIndexPG < nbPoints; ++ptIndexPG) {
         if (pointPPIs[ptIndexPG] != UNDEFINED_PARENT_PPI) continue;
-        const size_t parentPpi = getUndefinedParentPpi(pointPPIs, pointPPIsX[ptIndexPG], pointPPIsY[ptIndexPG], pointPPIsZ[ptIndexPG],
+        const typePPI parentPpi = getUndefinedParentPpi(pointPPIs, pointPPIsX[ptIndexPG], pointPPIsY[ptIndexPG], pointPPIsZ[ptIndexPG],
                                                        childToParentX, childToParentY, childToParentZ, ptIndexPG);
 
         // Store undefined parent in the sublist for refine segmentation.
@@ -992,9 +1019,9 @@ template<typename indexType>
 void finalPPIAttributionSlowPreset(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,
                                    const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
                                    const std::vector<PPI>& pointPPIsX, const std::vector<PPI>& pointPPIsY, const std::vector<PPI>& pointPPIsZ,
-                                   const robin_hood::unordered_map<indexType, size_t>& childToParentX,
-                                   const robin_hood::unordered_map<indexType, size_t>& childToParentY,
-                                   const robin_hood::unordered_map<indexType, size_t>& childToParentZ, std::vector<size_t>& pointPPIs) {
+                                   const std::vector<indexType>& childToParentX,
+                                   const std::vector<indexType>& childToParentY,
+                                   const std::vector<indexType>& childToParentZ, std::vector<typePPI>& pointPPIs) {
     const size_t nbPoints = pointsGeometry.size();
 
     // A parent point is a point with at least one temporary PPI
@@ -1071,13 +1098,10 @@ void finalPPIAttributionSlowPreset(const std::shared_ptr<uvgvpcc_enc::Frame>& fr
 
 template<typename indexType>
 void ppiAssignationSlicing(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,
-                           const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, std::vector<size_t>& pointPPIs) {
+                           const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, std::vector<typePPI>& pointPPIs) {
     // Create the 2D slices for each axis.
-    const size_t nbMaxSlices = (1U << p_->geoBitDepthVoxelized);
-    std::vector<std::optional<std::vector<size_t>>> levelToSliceX(nbMaxSlices);
-    std::vector<std::optional<std::vector<size_t>>> levelToSliceY(nbMaxSlices);
-    std::vector<std::optional<std::vector<size_t>>> levelToSliceZ(nbMaxSlices);
-    createSlices(pointsGeometry, levelToSliceX, levelToSliceY, levelToSliceZ);
+    std::array<AxisSlices, 3> axesSlices;
+    createSlices(pointsGeometry, axesSlices);
 
     const size_t frameId = frame->frameId;
     // Slice weaving : for each axis, set the PPI of the parent point and associate child points with parent points.
@@ -1087,12 +1111,20 @@ void ppiAssignationSlicing(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,
     std::vector<PPI> pointPPIsX(nbPoints, PPI::notAssigned);
     std::vector<PPI> pointPPIsY(nbPoints, PPI::notAssigned);
     std::vector<PPI> pointPPIsZ(nbPoints, PPI::notAssigned);
-    robin_hood::unordered_map<indexType, size_t> childToParentX;
-    robin_hood::unordered_map<indexType, size_t> childToParentY;
-    robin_hood::unordered_map<indexType, size_t> childToParentZ;
-    axisSlicesWeaving<indexType,axisX>(levelToSliceX, pointsGeometry, childToParentX, pointPPIsX, frameId);
-    axisSlicesWeaving<indexType,axisY>(levelToSliceY, pointsGeometry, childToParentY, pointPPIsY, frameId);
-    axisSlicesWeaving<indexType,axisZ>(levelToSliceZ, pointsGeometry, childToParentZ, pointPPIsZ, frameId);
+    std::vector<indexType> childToParentX(nbPoints, PARENT_NA<indexType>);
+    std::vector<indexType> childToParentY(nbPoints, PARENT_NA<indexType>);
+    std::vector<indexType> childToParentZ(nbPoints, PARENT_NA<indexType>);
+    // The three axes are independent until the final PPI attribution, so they are processed as parallel tasks (serially when exporting the
+    // intermediate files, which share the subslice exportation map)
+    currentContext->jobManager.parallelFor(3, p_->exportIntermediateFiles ? 3 : 1, [&](const size_t begin, const size_t end) {
+        for (size_t axisIndex = begin; axisIndex < end; ++axisIndex) {
+            switch (axisIndex) {
+                case 0: axisSlicesWeaving<indexType,axisX>(axesSlices[0], pointsGeometry, childToParentX, pointPPIsX, frameId); break;
+                case 1: axisSlicesWeaving<indexType,axisY>(axesSlices[1], pointsGeometry, childToParentY, pointPPIsY, frameId); break;
+                default: axisSlicesWeaving<indexType,axisZ>(axesSlices[2], pointsGeometry, childToParentZ, pointPPIsZ, frameId); break;
+            }
+        }
+    });
     if (p_->exportIntermediateFiles) {
         createTempPointCloudForSlicingExportation<axisX>(frame, pointsGeometry);
         createTempPointCloudForSlicingExportation<axisY>(frame, pointsGeometry);
@@ -1113,8 +1145,8 @@ void ppiAssignationSlicing(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,
     }
 }
 
-template void ppiAssignationSlicing<uint16_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, std::vector<size_t>& pointPPIs);
-template void ppiAssignationSlicing<uint32_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, std::vector<size_t>& pointPPIs);
-template void ppiAssignationSlicing<uint64_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, std::vector<size_t>& pointPPIs);
+template void ppiAssignationSlicing<uint16_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, std::vector<typePPI>& pointPPIs);
+template void ppiAssignationSlicing<uint32_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, std::vector<typePPI>& pointPPIs);
+template void ppiAssignationSlicing<uint64_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry, std::vector<typePPI>& pointPPIs);
 
 }  // namespace slicingComputation
\ No newline at end of file
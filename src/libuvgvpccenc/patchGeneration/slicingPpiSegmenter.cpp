@@ -78,20 +78,22 @@ PPISegmenter_NewRS::PPISegmenter_NewRS(const std::vector<uvgutils::VectorN<typeG
           return geoRange;
       }()) {}
 
-VoxelAttribute_NewRS::VoxelAttribute_NewRS(const size_t projectionPlaneCount_)
-    : updateFlag_(false), voxClass_(VoxClass_NewRS::NO_EDGE), voxPPI_(0), voxScore_{0} {}
+VoxelAttributes_NewRS::VoxelAttributes_NewRS(const size_t voxelCount)
+    : scores(voxelCount, {0}), ppis(voxelCount, 0), classes(voxelCount, VoxClass_NewRS::NO_EDGE), updateFlags(voxelCount, 0) {}
 
 // TODO(lf): the number of points in the voxel is usefull only for DE-V voxel no ? So why to set the value for all voxels ?
 // TODO(lf): use two flags, compute one time the flag for S or M instead of checking it like the other classification
 
-inline void PPISegmenter_NewRS::updateVoxelAttribute_NewRS(VoxelAttribute_NewRS& voxAttribute, const std::vector<size_t>& voxPoints,
-                                               const std::vector<size_t>& pointsPPIs) {
-    std::array<size_t, 6>& voxScore = voxAttribute.voxScore_;
+inline void PPISegmenter_NewRS::updateVoxelAttribute_NewRS(VoxelAttributes_NewRS& voxAttributes, const size_t voxelIndex,
+                                                           const std::vector<size_t>& voxPoints, const std::vector<typePPI>& pointsPPIs) {
+    std::array<uint32_t, 6>& voxScore = voxAttributes.scores[voxelIndex];
+    VoxClass_NewRS& voxClass = voxAttributes.classes[voxelIndex];
+    typePPI& voxPPI = voxAttributes.ppis[voxelIndex];
 
     // Single Direct Edge Voxel : One point in the voxel //
-    if (voxAttribute.voxClass_ == VoxClass_NewRS::S_DIRECT_EDGE) {
-        voxAttribute.voxPPI_ = pointsPPIs[voxPoints[0]];
-        voxScore[voxAttribute.voxPPI_] = 1;
+    if (voxClass == VoxClass_NewRS::S_DIRECT_EDGE) {
+        voxPPI = pointsPPIs[voxPoints[0]];
+        voxScore[voxPPI] = 1;
         return;
     }
 
@@ -102,46 +104,47 @@ inline void PPISegmenter_NewRS::updateVoxelAttribute_NewRS(VoxelAttribute_NewRS&
 
     if (voxScore[pointsPPIs[voxPoints[0]]] == voxPoints.size()) {
         // No Edge Voxel : All points within the voxel have the same PPI //
-        voxAttribute.voxClass_ = VoxClass_NewRS::NO_EDGE;
-        voxAttribute.voxPPI_ = pointsPPIs[voxPoints[0]];
+        voxClass = VoxClass_NewRS::NO_EDGE;
+        voxPPI = pointsPPIs[voxPoints[0]];
         return;
     }
 
     // Multiple Direct Edge Voxel : Points within the voxel have different PPI //
-    voxAttribute.voxClass_ = VoxClass_NewRS::M_DIRECT_EDGE;
+    voxClass = VoxClass_NewRS::M_DIRECT_EDGE;
 
     // The voxel PPI is the most represented PPI among the points inside it //
     const auto& maxScore = std::max_element(voxScore.begin(), voxScore.end());
-    voxAttribute.voxPPI_ = static_cast<size_t>(std::distance(voxScore.begin(), maxScore));
+    voxPPI = static_cast<typePPI>(std::distance(voxScore.begin(), maxScore));
 }
 
 void PPISegmenter_NewRS::computeExtendedScore_NewRS(std::array<size_t,6>& voxExtendedScore,
-                                        const std::vector<VoxelAttribute_NewRS>& voxAttributeList,
+                                        const VoxelAttributes_NewRS& voxAttributes,
                                         const std::vector<size_t>& ADJ_ListNew) {
     std::fill(voxExtendedScore.begin(), voxExtendedScore.end(), 0);
     for (const auto& voxelIndex : ADJ_ListNew) {
+        const std::array<uint32_t, 6>& voxScore = voxAttributes.scores[voxelIndex];
         for (size_t k = 0; k < p_->projectionPlaneCount; ++k) {
-            voxExtendedScore[k] += voxAttributeList[voxelIndex].voxScore_[k];
+            voxExtendedScore[k] += voxScore[k];
         }
     }
 }
 
 // TODO(lf)warning : adjacent (old name) voxel contain the voxel itself!
-void PPISegmenter_NewRS::updateAdjacentVoxelsClass_NewRS(std::vector<VoxelAttribute_NewRS>& voxAttributeList, const std::array<size_t,6>& voxExtendedScore,
+void PPISegmenter_NewRS::updateAdjacentVoxelsClass_NewRS(VoxelAttributes_NewRS& voxAttributes, const std::array<size_t,6>& voxExtendedScore,
                                              const std::vector<size_t>& IDEV_List) {
     // Common and effective way to find the index of the maximum element in a C++ container
     const auto& maxScoreSmooth = std::max_element(voxExtendedScore.begin(), voxExtendedScore.end());
     const size_t ppiOfScoreSmooth = std::distance(voxExtendedScore.begin(), maxScoreSmooth);
 
     for (const auto& voxelIndex : IDEV_List) {
-        VoxelAttribute_NewRS& adjVoxAttribute = voxAttributeList[voxelIndex];
-        if (adjVoxAttribute.voxClass_ == VoxClass_NewRS::NO_EDGE && adjVoxAttribute.voxPPI_ != ppiOfScoreSmooth) {
-            adjVoxAttribute.voxClass_ = VoxClass_NewRS::INDIRECT_EDGE;
+        VoxClass_NewRS& adjVoxClass = voxAttributes.classes[voxelIndex];
+        if (adjVoxClass == VoxClass_NewRS::NO_EDGE && voxAttributes.ppis[voxelIndex] != ppiOfScoreSmooth) {
+            adjVoxClass = VoxClass_NewRS::INDIRECT_EDGE;
         }
     }
 }
 
-inline bool PPISegmenter_NewRS::checkNEV_NewRS(const VoxClass_NewRS voxClass, const size_t voxPPI, const std::array<size_t,6>& voxExtendedScore) {
+inline bool PPISegmenter_NewRS::checkNEV_NewRS(const VoxClass_NewRS voxClass, const typePPI voxPPI, const std::array<size_t,6>& voxExtendedScore) {
     // TODO(lf): why not to check if S_DIRECT_EDGE ?
 
     if (voxClass == VoxClass_NewRS::M_DIRECT_EDGE) {  // TMC2 : VoxClass::S_DIRECT_EDGE or VoxClass::INDIRECT_EDGE
@@ -167,13 +170,15 @@ inline bool PPISegmenter_NewRS::checkNEV_NewRS(const VoxClass_NewRS voxClass, co
 }
 
 // TODO(lf): special algorithm trajectory for S_DIRECT_EDGE_VOXEL
-inline void PPISegmenter_NewRS::refinePointsPPIs_NewRS(std::vector<size_t>& pointsPPIs, const std::vector<size_t>& pointsPPIs_origin, const std::vector<size_t>& pointsIndices,
+// Return the number of points whose PPI has changed
+inline size_t PPISegmenter_NewRS::refinePointsPPIs_NewRS(std::vector<typePPI>& pointsPPIs, const std::vector<typePPI>& pointsPPIs_origin, const std::vector<size_t>& pointsIndices,
                                          const std::array<size_t,6>& voxExtendedScore, const size_t nnPointCount) const {
     std::array<double,6> weightedScoreSmooth{0};
     for (size_t k = 0; k < p_->projectionPlaneCount; ++k) {
         weightedScoreSmooth[k] = p_->refineSegmentationLambda * static_cast<double>(voxExtendedScore[k]); 
     }
     // For each point in the current voxel //
+    size_t ppiChangeCount = 0;
     for (const auto& pointIndex : pointsIndices) {
         const auto& dotProductList = normalsDotProducts[pointsPPIs_origin[pointIndex]];
         const bool normalBool = normalExists_[pointIndex];
@@ -188,8 +193,10 @@ inline void PPISegmenter_NewRS::refinePointsPPIs_NewRS(std::vector<size_t>& poin
                 PPIscoreMax = k;
             }
         }
-        pointsPPIs[pointIndex] = PPIscoreMax;
+        ppiChangeCount += static_cast<size_t>(pointsPPIs[pointIndex] != PPIscoreMax);
+        pointsPPIs[pointIndex] = static_cast<typePPI>(PPIscoreMax);
     }
+    return ppiChangeCount;
 }
 
 template<typename keyType>
@@ -269,9 +276,10 @@ in a voxel. The former is usually isolated points, and the latter indicates the
 // TODO(lf): use two flags, compute one time the flag for S or M instead of checking it like the other classification
 // TODO(lf): the refine segmentation voxelization (voxel dim etc..) should depend on geometry bit, not on the max range
 template<typename keyType>
-void PPISegmenter_NewRS::refineSegmentation_NewRS(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<size_t>& pointsPPIs,
+void PPISegmenter_NewRS::refineSegmentation_NewRS(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<typePPI>& pointsPPIs,
                                       const size_t& frameId) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION", "Refine segmentation of frame " + std::to_string(frameId) + "\n");
+    StatsCollector& stats = StatsCollector::instance();
     const size_t gbdrs = p_->geoBitDepthRefineSegmentation;
     const size_t gbdrs2 = p_->geoBitDepthRefineSegmentation * 2;
     const size_t gridSize = 1U << gbdrs;
@@ -294,19 +302,18 @@ void PPISegmenter_NewRS::refineSegmentation_NewRS(const std::shared_ptr<uvgvpcc_
     }
 
     // The 1st classification is made here (+ score computation)
-    std::vector<VoxelAttribute_NewRS> voxAttributeList(voxelCount, VoxelAttribute_NewRS(p_->projectionPlaneCount));
+    VoxelAttributes_NewRS voxAttributes(voxelCount);
     for (size_t v_idx = 0; v_idx < voxelCount; ++v_idx) {
         // Iterate through all voxels to set score, classification and voxel PPI //
         // First classification : NE-V or DE-V (SDE-V or MDE-V) //
-        VoxelAttribute_NewRS& voxAttribute = voxAttributeList[v_idx];
         if (pointListInVoxels[v_idx].size() == 1) {
             // Single Direct Edge Voxel : One point in the voxel //
-            voxAttribute.voxClass_ = VoxClass_NewRS::S_DIRECT_EDGE;
+            voxAttributes.classes[v_idx] = VoxClass_NewRS::S_DIRECT_EDGE;
         }
-        updateVoxelAttribute_NewRS(voxAttribute, pointListInVoxels[v_idx], pointsPPIs);
+        updateVoxelAttribute_NewRS(voxAttributes, v_idx, pointListInVoxels[v_idx], pointsPPIs);
     }
 
-    const std::vector<size_t> pointsPPIs_O = pointsPPIs;
+    const std::vector<typePPI> pointsPPIs_O = pointsPPIs;
     std::vector<std::vector<size_t>> ADJ_List(voxelCount);   // large    // This is voxNeighborsList
     std::vector<std::vector<size_t>> IDEV_List(voxelCount);  // small    // This is voxAdjacentsList
     std::vector<size_t> nnPointCountList(voxelCount);
@@ -319,6 +326,7 @@ void PPISegmenter_NewRS::refineSegmentation_NewRS(const std::shared_ptr<uvgvpcc_
 
     std::array<size_t, 6> voxExtendedScore{0};
     std::vector<uint8_t> hasBeenComputed(voxelCount, 0);
+    LocalStats frameStats(p_->exportStatistics ? p_->refineSegmentationIterationCount : 0);
 
     const size_t bitMask = (1U << gbdrs) - 1;
     const size_t distanceSearch = p_->refineSegmentationMaxNNVoxelDistanceLUT;
@@ -326,17 +334,17 @@ void PPISegmenter_NewRS::refineSegmentation_NewRS(const std::shared_ptr<uvgvpcc_
     for (size_t iter = 0; iter < p_->refineSegmentationIterationCount; ++iter) {
         for (size_t voxelIndex = 0; voxelIndex < voxelCount; ++voxelIndex) {
             // TODO(lf): should we use a stack of voxel index instead of a for loop with a lot of if(true) ?
-            const VoxClass_NewRS& voxClass = voxAttributeList[voxelIndex].voxClass_;
+            const VoxClass_NewRS& voxClass = voxAttributes.classes[voxelIndex];
             if (voxClass == VoxClass_NewRS::NO_EDGE) {
                 if(p_->exportStatistics){
-                    stats.collectData(frame->frameId, DataId::SkippedVoxels, iter);
+                    frameStats.add(DataId::SkippedVoxels, iter);
                 }
                 continue;  // This voxel has been marked as NE-V before the current iteration //
             }
             
             voxExtendedScore.fill(0);
             if(hasBeenComputed[voxelIndex] == 1){
-                computeExtendedScore_NewRS(voxExtendedScore, voxAttributeList, ADJ_List[voxelIndex]);
+                computeExtendedScore_NewRS(voxExtendedScore, voxAttributes, ADJ_List[voxelIndex]);
             } else {
                 hasBeenComputed[voxelIndex] = 1;
             
@@ -363,7 +371,7 @@ void PPISegmenter_NewRS::refineSegmentation_NewRS(const std::shared_ptr<uvgvpcc_
             
                             // Extended score computation
                             for (size_t k = 0; k < p_->projectionPlaneCount; ++k) {
-                                voxExtendedScore[k] += voxAttributeList[neighbor_v_idx].voxScore_[k];
+                                voxExtendedScore[k] += voxAttributes.scores[neighbor_v_idx][k];
                             }
             
                             const size_t IDEV_range = p_->refineSegmentationIDEVDist; // TODO(lf)justifiy this value, and make it dependent on the geobitdepth
@@ -377,36 +385,24 @@ void PPISegmenter_NewRS::refineSegmentation_NewRS(const std::shared_ptr<uvgvpcc_
                 nnPointCountList[voxelIndex] = num_nn_points;
             }
 
-            updateAdjacentVoxelsClass_NewRS(voxAttributeList, voxExtendedScore, IDEV_List[voxelIndex]);
-            if (checkNEV_NewRS(voxClass, voxAttributeList[voxelIndex].voxPPI_, voxExtendedScore)) {
+            updateAdjacentVoxelsClass_NewRS(voxAttributes, voxExtendedScore, IDEV_List[voxelIndex]);
+            if (checkNEV_NewRS(voxClass, voxAttributes.ppis[voxelIndex], voxExtendedScore)) {
                 continue;  // The current iteration found that this voxel is NE-V //
             }
 
             // The voxel is not NE-V, so it is D-EV or IDE-V and its points PPI can be refined //
+            const size_t ppiChangeCount = refinePointsPPIs_NewRS(pointsPPIs, pointsPPIs_O, pointListInVoxels[voxelIndex], voxExtendedScore,
+                                                                 nnPointCountList[voxelIndex]);
+            voxAttributes.updateFlags[voxelIndex] = 1;
+
             if(p_->exportStatistics){
-                std::vector<size_t> previousPointsPPI = pointsPPIs;
-                refinePointsPPIs_NewRS(pointsPPIs, pointsPPIs_O, pointListInVoxels[voxelIndex], voxExtendedScore, nnPointCountList[voxelIndex]);
-                voxAttributeList[voxelIndex].updateFlag_ = true;
-                for(size_t i = 0 ; i < pointsPPIs.size() ; ++i){
-                    if(previousPointsPPI[i] != pointsPPIs[i]){
-                        stats.collectData(frame->frameId, DataId::PpiChange, iter);
-                    }
-                }
-            }
-            else{
-                refinePointsPPIs_NewRS(pointsPPIs, pointsPPIs_O, pointListInVoxels[voxelIndex], voxExtendedScore, nnPointCountList[voxelIndex]);
-                voxAttributeList[voxelIndex].updateFlag_ = true;
-            }
-            
-            if(p_->exportStatistics){
-                for(size_t i = 0 ; i < pointListInVoxels[voxelIndex].size() ; ++i){
-                    stats.collectData(frame->frameId, DataId::ScoreComputations, iter);
-                }
-                switch (voxAttributeList[voxelIndex].voxClass_){
-                    case VoxClass_NewRS::NO_EDGE:       stats.collectData(frame->frameId, DataId::NoEdge_R,       iter); break;
-                    case VoxClass_NewRS::INDIRECT_EDGE: stats.collectData(frame->frameId, DataId::IndirectEdge_R, iter); break;
-                    case VoxClass_NewRS::S_DIRECT_EDGE: stats.collectData(frame->frameId, DataId::SingleEdge_R,   iter); break;
-                    case VoxClass_NewRS::M_DIRECT_EDGE: stats.collectData(frame->frameId, DataId::MultiEdge_R,    iter); break;
+                frameStats.add(DataId::PpiChange, iter, ppiChangeCount);
+                frameStats.add(DataId::ScoreComputations, iter, pointListInVoxels[voxelIndex].size());
+                switch (voxAttributes.classes[voxelIndex]){
+                    case VoxClass_NewRS::NO_EDGE:       frameStats.add(DataId::NoEdge_R,       iter); break;
+                    case VoxClass_NewRS::INDIRECT_EDGE: frameStats.add(DataId::IndirectEdge_R, iter); break;
+                    case VoxClass_NewRS::S_DIRECT_EDGE: frameStats.add(DataId::SingleEdge_R,   iter); break;
+                    case VoxClass_NewRS::M_DIRECT_EDGE: frameStats.add(DataId::MultiEdge_R,    iter); break;
                 }
             }
         }
@@ -414,28 +410,31 @@ void PPISegmenter_NewRS::refineSegmentation_NewRS(const std::shared_ptr<uvgvpcc_
         // Update voxel classification and scores if points PPI inside have changed during the iteration //
         for (size_t voxelIndex = 0; voxelIndex < voxelCount; ++voxelIndex) {
             // TODO(lf): it might be faster to use a stack of index instead of using a flag
-            if (!voxAttributeList[voxelIndex].updateFlag_) {
+            if (voxAttributes.updateFlags[voxelIndex] == 0U) {
                 continue;
             }
-            voxAttributeList[voxelIndex].updateFlag_ = false;
-            std::fill(voxAttributeList[voxelIndex].voxScore_.begin(), voxAttributeList[voxelIndex].voxScore_.end(), 0);
-            updateVoxelAttribute_NewRS(voxAttributeList[voxelIndex], pointListInVoxels[voxelIndex], pointsPPIs);
+            voxAttributes.updateFlags[voxelIndex] = 0;
+            voxAttributes.scores[voxelIndex].fill(0);
+            updateVoxelAttribute_NewRS(voxAttributes, voxelIndex, pointListInVoxels[voxelIndex], pointsPPIs);
         }
 
         // Compute de number of changes of classification
         if(p_->exportStatistics){
-            for(auto& voxel : voxAttributeList){
-                VoxClass_NewRS VC = voxel.voxClass_;
+            for(const VoxClass_NewRS VC : voxAttributes.classes){
                 switch (VC) {
-                    case VoxClass_NewRS::NO_EDGE:       stats.collectData(frame->frameId, DataId::NoEdge,       iter); break;
-                    case VoxClass_NewRS::INDIRECT_EDGE: stats.collectData(frame->frameId, DataId::IndirectEdge, iter); break;
-                    case VoxClass_NewRS::S_DIRECT_EDGE: stats.collectData(frame->frameId, DataId::SingleEdge,   iter); break;
-                    case VoxClass_NewRS::M_DIRECT_EDGE: stats.collectData(frame->frameId, DataId::MultiEdge,    iter); break;
+                    case VoxClass_NewRS::NO_EDGE:       frameStats.add(DataId::NoEdge,       iter); break;
+                    case VoxClass_NewRS::INDIRECT_EDGE: frameStats.add(DataId::IndirectEdge, iter); break;
+                    case VoxClass_NewRS::S_DIRECT_EDGE: frameStats.add(DataId::SingleEdge,   iter); break;
+                    case VoxClass_NewRS::M_DIRECT_EDGE: frameStats.add(DataId::MultiEdge,    iter); break;
                 }
             }
         }
     }
 
+    if(p_->exportStatistics){
+        stats.merge(frame->frameId, frameStats);
+    }
+
     if (p_->exportIntermediateFiles) {
         FileExport::exportPointCloudRefineSegmentation(frame, pointsGeometry_, pointsPPIs);
     }
@@ -453,9 +452,9 @@ template void PPISegmenter_NewRS::voxelizationWithBitArray_NewRS<uint64_t>(const
                                             std::vector<uint64_t>& filledVoxels, std::vector<std::vector<size_t>>& pointListInVoxels);                                                                                        
 
 
-template void PPISegmenter_NewRS::refineSegmentation_NewRS<uint16_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<size_t>& pointsPPIs,
+template void PPISegmenter_NewRS::refineSegmentation_NewRS<uint16_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<typePPI>& pointsPPIs,
                                     const size_t& frameId);
-template void PPISegmenter_NewRS::refineSegmentation_NewRS<uint32_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<size_t>& pointsPPIs,
+template void PPISegmenter_NewRS::refineSegmentation_NewRS<uint32_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<typePPI>& pointsPPIs,
                                     const size_t& frameId);
-template void PPISegmenter_NewRS::refineSegmentation_NewRS<uint64_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<size_t>& pointsPPIs,
+template void PPISegmenter_NewRS::refineSegmentation_NewRS<uint64_t>(const std::shared_ptr<uvgvpcc_enc::Frame>& frame, std::vector<typePPI>& pointsPPIs,
                                     const size_t& frameId);
\ No newline at end of file
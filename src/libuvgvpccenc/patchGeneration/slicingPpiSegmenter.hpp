@@ -62,14 +62,14 @@ enum class VoxClass_NewRS : uint8_t {
 // TODO(lf): Are S DIRECT EGDE always considered as direct edge ? Even if they share the same PPI as their neighbor ? Does this mean each
 // iteration focus on all single  direct edge voxel ?
 
-struct VoxelAttribute_NewRS {
-    bool updateFlag_; // Va peut-être disparaître
-    VoxClass_NewRS voxClass_;
-    size_t voxPPI_;
-    std::array<size_t,6> voxScore_;  // TODO(lf): should be an array ?
-    // Voxel score is a PPI histogram : how many points inside the voxel is associated with each projection planes //
-
-    explicit VoxelAttribute_NewRS(const size_t projectionPlaneCount_);
+// Attributes of the voxels, one array per attribute (c.f. VoxelAttributes in ppiSegmenter.hpp)
+struct VoxelAttributes_NewRS {
+    std::vector<std::array<uint32_t, 6>> scores;  // PPI histogram of each voxel
+    std::vector<typePPI> ppis;
+    std::vector<VoxClass_NewRS> classes;
+    std::vector<uint8_t> updateFlags;
+
+    explicit VoxelAttributes_NewRS(size_t voxelCount);
 };
 
 class PPISegmenter_NewRS {
@@ -78,7 +78,7 @@ class PPISegmenter_NewRS {
                  const std::vector<bool>& normalExists);
 
     template<typename keyType>
-    void refineSegmentation_NewRS(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,std::vector<size_t>& pointsPPIs, const size_t& frameId);
+    void refineSegmentation_NewRS(const std::shared_ptr<uvgvpcc_enc::Frame>& frame,std::vector<typePPI>& pointsPPIs, const size_t& frameId);
 
    private:
    
@@ -88,22 +88,22 @@ class PPISegmenter_NewRS {
                                          std::vector<keyType>& filledVoxels, std::vector<std::vector<size_t>>& pointListInVoxels);    
 
     static void computeExtendedScore_NewRS(std::array<size_t,6>& voxExtendedScore,
-                                        const std::vector<VoxelAttribute_NewRS>& voxAttributeList,
+                                        const VoxelAttributes_NewRS& voxAttributes,
                                         const std::vector<size_t>& ADJ_ListNew);
 
-    static void updateAdjacentVoxelsClass_NewRS(std::vector<VoxelAttribute_NewRS>& voxAttributeList,
+    static void updateAdjacentVoxelsClass_NewRS(VoxelAttributes_NewRS& voxAttributes,
                                                     const std::array<size_t,6>& voxExtendedScore,
                                                     const std::vector<size_t>& IDEV_List);
                                                     
-    static inline bool checkNEV_NewRS(const VoxClass_NewRS voxClass, const size_t voxPPI,
+    static inline bool checkNEV_NewRS(const VoxClass_NewRS voxClass, const typePPI voxPPI,
                                           const std::array<size_t,6>& voxExtendedScore);
 
-    inline void refinePointsPPIs_NewRS(std::vector<size_t>& pointsPPIs, const std::vector<size_t>& pointsPPIs_origin, const std::vector<size_t>& pointsIndices,
+    inline size_t refinePointsPPIs_NewRS(std::vector<typePPI>& pointsPPIs, const std::vector<typePPI>& pointsPPIs_origin, const std::vector<size_t>& pointsIndices,
                                          const std::array<size_t,6>& voxExtendedScore, const size_t nnPointCount) const;
 
 
-    static inline void updateVoxelAttribute_NewRS(VoxelAttribute_NewRS& voxAttribute, const std::vector<size_t>& voxPoints,
-                                                      const std::vector<size_t>& pointsPPIs);
+    static inline void updateVoxelAttribute_NewRS(VoxelAttributes_NewRS& voxAttributes, size_t voxelIndex, const std::vector<size_t>& voxPoints,
+                                                      const std::vector<typePPI>& pointsPPIs);
 
     const std::vector<bool>& normalExists_;
     const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry_;
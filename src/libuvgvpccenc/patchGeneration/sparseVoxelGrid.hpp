@@ -0,0 +1,114 @@
+/*****************************************************************************
+ * This file is part of uvgVPCCenc V-PCC encoder.
+ *
+ * Copyright (c) 2024-present, Tampere University, ITU/ISO/IEC, project contributors
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ * 
+ * * Neither the name of the Tampere University or ITU/ISO/IEC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+ ****************************************************************************/
+
+/// \file Sparse index of the occupied voxels of a grid.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "robin_hood.h"
+
+// Occupied voxels of a grid, stored by bricks of 8x8x8 cells. Only the bricks holding at least one voxel are allocated, so the memory is
+// bounded by the occupied surface instead of the grid volume. Each cell of a brick holds the index of its voxel, or 'emptyVoxel'. A lookup
+// is then a single probe of the brick hash map, which is skipped when the previous lookup was already in the same brick.
+class SparseVoxelGrid {
+   public:
+    using IndexType = uint32_t;
+    static constexpr IndexType emptyVoxel = std::numeric_limits<IndexType>::max();
+
+    // Lookups with a cache of the last brick. The lookups around a voxel mostly fall in the same brick. A cursor is used by a single thread.
+    class Cursor {
+       public:
+        explicit Cursor(const SparseVoxelGrid& grid) : grid_(grid) {}
+
+        // Index of the voxel at (x, y, z), or 'emptyVoxel'. The coordinates must be inside the grid.
+        IndexType find(const int x, const int y, const int z) {
+            const uint64_t key = brickKey(x, y, z);
+            if (key != brickKey_) {
+                brickKey_ = key;
+                const auto it = grid_.brickIds_.find(key);
+                brick_ = it == grid_.brickIds_.end() ? nullptr : grid_.bricks_[it->second].data();
+            }
+            return brick_ == nullptr ? emptyVoxel : brick_[cellIndex(x, y, z)];
+        }
+
+       private:
+        const SparseVoxelGrid& grid_;
+        uint64_t brickKey_ = invalidBrickKey;
+        const IndexType* brick_ = nullptr;
+    };
+
+    void reserve(const size_t voxelCount) { brickIds_.reserve(voxelCount / estimatedVoxelsPerBrick + 1); }
+
+    // Return the index of the voxel at (x, y, z). If the voxel is not in the grid yet, it is inserted with the index 'newVoxelIdx'.
+    IndexType insert(const int x, const int y, const int z, const IndexType newVoxelIdx) {
+        const uint64_t key = brickKey(x, y, z);
+        if (key != insertBrickKey_) {
+            insertBrickKey_ = key;
+            const auto [it, inserted] = brickIds_.try_emplace(key, bricks_.size());
+            if (inserted) {
+                bricks_.emplace_back().fill(emptyVoxel);
+            }
+            insertBrickIdx_ = it->second;
+        }
+        IndexType& cell = bricks_[insertBrickIdx_][cellIndex(x, y, z)];
+        if (cell == emptyVoxel) {
+            cell = newVoxelIdx;
+        }
+        return cell;
+    }
+
+   private:
+    static constexpr size_t brickShift = 3;
+    static constexpr size_t brickMask = (1U << brickShift) - 1;
+    static constexpr size_t estimatedVoxelsPerBrick = 64;  // A surface crossing a brick fills roughly one of its planes
+    static constexpr uint64_t invalidBrickKey = std::numeric_limits<uint64_t>::max();
+
+    static uint64_t brickKey(const int x, const int y, const int z) {
+        return (static_cast<uint64_t>(x) >> brickShift) | ((static_cast<uint64_t>(y) >> brickShift) << 21U) |
+               ((static_cast<uint64_t>(z) >> brickShift) << 42U);
+    }
+    static size_t cellIndex(const int x, const int y, const int z) {
+        return (static_cast<size_t>(x) & brickMask) | ((static_cast<size_t>(y) & brickMask) << brickShift) |
+               ((static_cast<size_t>(z) & brickMask) << (2 * brickShift));
+    }
+
+    robin_hood::unordered_flat_map<uint64_t, size_t> brickIds_;  // brick key -> index in 'bricks_'
+    std::vector<std::array<IndexType, 1U << (3 * brickShift)>> bricks_;
+    uint64_t insertBrickKey_ = invalidBrickKey;
+    size_t insertBrickIdx_ = 0;
+};
@@ -36,11 +36,15 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
+#include <array>
+#include <cassert>
 #include <cstdint>
 #include <vector>
 
 #include "robin_hood.h"
 #include "utils/constants.hpp"
+#include "utils/encoderContext.hpp"
 #include "uvgutils/utils.hpp"
 #include "uvgutils/log.hpp"
 
@@ -228,67 +232,150 @@ inline keyType location1DFromPoint(const uvgutils::VectorN<typeGeometryInput, 3>
 // voxelIdToPointsId[i] stores the index of the points inside the voxel i
 // voxelsPPIs[i] stores the PPI of the voxel i
 //
-// The use of a map is needed as several points can be inside one voxel. We want to find in a fast way if the current point resides in a voxel
-// that has already been created. For an input point j:       voxelCoordToVoxelIndex[  voxelCoordsOf(j) ] = i
+// Several points can be inside one voxel. The voxel index is given by the order of the first input point of each voxel: the voxel of the
+// first input point has the index 0, the voxel of the first input point that is not inside voxel 0 has the index 1, and so on.
 //
-// This structure makes computation easier for the patch generation and for applying voxel data to points data.
-// To achieve this, we need a temporary map that interfaces the voxel coordinates with the voxel index in those three list.
-
-// voxelizedPointsGeometry -> list of the voxels. That is, a list of the coordinates of the voxels.
-// voxelIdToPointsId -> For each voxel, stores the index of the points inside. A voxel is defined by a voxel index, that is given by the
-// filling order of the vector. Thus, the third voxel to be added to this structure will have a voxel index of 2.
-// voxelCoordToVoxelIndex -> Temporary structure. Associate a voxel to its index in 'voxelIdToPointsId' (its voxel index). This structure is a
-// map whose key is a voxel coordinate and the value is a voxel index.
-//
-// For each point if the input point cloud :
-//     Compute the coordinates of the voxel inside which the current point should be.
-//     If those voxel coordinates are already in the map 'voxelCoordToVoxelIndex':
-//         Add the current input point index to the list of points index of the found voxel.
-//         That is, add the current input point index to the list of points of the voxel in 'voxelIdToPointsId'
-//     If those voxel coordinates are not in the map 'voxelCoordToVoxelIndex':
-//         Create a new item in the map 'voxelCoordToVoxelIndex'. This associates the voxel coordinates to its voxel index (the current size
-//         of the list of voxel === the index of this voxel in the list of voxel). Add a new voxel to 'voxelIdToPointsId'. This associates the
-//         voxel index (the current size of the list of voxel === the index of this voxel in the list of voxel) to an empty list of input
-//         point index. Create a new voxel by adding the voxel coordinates in the voxel list 'voxelizedPointsGeometry'. Add the current input
-//         point index to the list of points index of the new voxel. That is, add the current input point index to the list of points of the
-//         voxel in 'voxelIdToPointsId'
-
 // Notice that in the refined segmentation, the inputPointsGeometry can be the voxelizedPointsGeometry. Indeed, when the voxelization is
 // activated, the refined segmentation is applying a second voxelization step. The created voxelized point cloud is then the result of two
 // voxelizations.
-inline void voxelization(
+//
+// The voxel coordinates of each point are concatenated in a 1D key. The (key, point index) pairs are sorted with a LSD radix sort. As the
+// radix sort is stable, the points of a voxel end up in a single run of the sorted list, in increasing point index order. The first element
+// of a run is thus the first input point inside this voxel. The voxel index is the number of such first points that come before it in the
+// input order.
+//
+// The key holds 'outputBitResolution' bits per axis, so every input coordinate must be lower than 2^inputBitResolution. Larger
+// coordinates would alias with other voxels.
+inline void voxelizationWithSort(
     const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& inputPointsGeometry,
     std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& voxelizedPointsGeometry,
     std::vector<size_t>& pointsIdToVoxelId,
     const size_t inputBitResolution,
     const size_t outputBitResolution
-) 
+)
 {
-    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION", "Voxelization from " + std::to_string(inputBitResolution) + " to " +
-        std::to_string(outputBitResolution) + " bits of resolution.\n");
-    pointsIdToVoxelId.resize(inputPointsGeometry.size());
-
-    const size_t voxelizationShift = inputBitResolution - outputBitResolution;
-    const typeGeometryInput shift = static_cast<typeGeometryInput>(voxelizationShift);
-
-    const size_t approximateVoxelCount = 1U << (outputBitResolution * 2U);
-    voxelizedPointsGeometry.reserve(approximateVoxelCount);
-
-    robin_hood::unordered_map<uvgutils::VectorN<typeGeometryInput, 3>, size_t, vector3Hash<typeGeometryInput>> voxelCoordToVoxelIndex;
-    voxelCoordToVoxelIndex.reserve(approximateVoxelCount);
-    size_t voxelIndex = 0;
-    for (size_t inputPointIndex = 0; inputPointIndex < inputPointsGeometry.size(); ++inputPointIndex) {
-        const uvgutils::VectorN<typeGeometryInput, 3> & inputPoint = inputPointsGeometry[inputPointIndex];
-
-        uvgutils::VectorN<typeGeometryInput, 3> voxCoord{static_cast<typeGeometryInput>(static_cast<uint32_t>(inputPoint[0]) >> shift),
-                                            static_cast<typeGeometryInput>(static_cast<uint32_t>(inputPoint[1]) >> shift),
-                                            static_cast<typeGeometryInput>(static_cast<uint32_t>(inputPoint[2]) >> shift)};
-
-        auto [it, inserted] = voxelCoordToVoxelIndex.try_emplace(voxCoord, voxelIndex);
-        if (inserted) {
-            voxelizedPointsGeometry.emplace_back(voxCoord);
-            voxelIndex++;
+    uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("PATCH GENERATION", "Voxelization (sort based) from " + std::to_string(inputBitResolution) +
+        " to " + std::to_string(outputBitResolution) + " bits of resolution.\n");
+
+    constexpr size_t chunkSize = 65536;  // Number of points handled in a single task of the thread pool
+    constexpr size_t radixBits = 8;
+    constexpr size_t bucketCount = 1U << radixBits;
+
+    struct KeyedPoint {
+        uint64_t key;
+        size_t pointIndex;
+    };
+
+    const size_t pointCount = inputPointsGeometry.size();
+    const size_t chunkCount = (pointCount + chunkSize - 1) / chunkSize;
+    const size_t shift = inputBitResolution - outputBitResolution;
+    const size_t keyBits = 3 * outputBitResolution;
+    assert(keyBits <= 64);
+    const uvgutils::JobManager& jobManager = currentContext->jobManager;
+
+    const auto voxelCoordinates = [&](const size_t pointIndex) {
+        const uvgutils::VectorN<typeGeometryInput, 3>& inputPoint = inputPointsGeometry[pointIndex];
+        return uvgutils::VectorN<typeGeometryInput, 3>{static_cast<typeGeometryInput>(static_cast<uint32_t>(inputPoint[0]) >> shift),
+                                                       static_cast<typeGeometryInput>(static_cast<uint32_t>(inputPoint[1]) >> shift),
+                                                       static_cast<typeGeometryInput>(static_cast<uint32_t>(inputPoint[2]) >> shift)};
+    };
+
+    std::vector<KeyedPoint> keyedPoints(pointCount);
+    jobManager.parallelFor(pointCount, chunkSize, [&](const size_t begin, const size_t end) {
+        for (size_t pointIndex = begin; pointIndex < end; ++pointIndex) {
+            const uvgutils::VectorN<typeGeometryInput, 3> voxCoord = voxelCoordinates(pointIndex);
+            assert(((voxCoord[0] | voxCoord[1] | voxCoord[2]) >> outputBitResolution) == 0 &&
+                   "Input coordinate out of the inputBitResolution range");
+            keyedPoints[pointIndex] = {location1DFromPoint<uint64_t>(voxCoord, outputBitResolution, 2 * outputBitResolution), pointIndex};
+        }
+    });
+
+    // LSD radix sort. Each chunk counts its digits, then scatters its points in order at its own offsets, which keeps the sort stable.
+    std::vector<KeyedPoint> sortBuffer(pointCount);
+    std::vector<std::array<size_t, bucketCount>> chunkOffsets(chunkCount);
+    for (size_t digitShift = 0; digitShift < keyBits; digitShift += radixBits) {
+        jobManager.parallelFor(pointCount, chunkSize, [&](const size_t begin, const size_t end) {
+            std::array<size_t, bucketCount>& histogram = chunkOffsets[begin / chunkSize];
+            histogram.fill(0);
+            for (size_t i = begin; i < end; ++i) {
+                ++histogram[(keyedPoints[i].key >> digitShift) & (bucketCount - 1)];
+            }
+        });
+
+        size_t offset = 0;
+        bool singleBucket = false;
+        for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+            const size_t bucketStart = offset;
+            for (std::array<size_t, bucketCount>& histogram : chunkOffsets) {
+                const size_t count = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += count;
+            }
+            singleBucket |= offset - bucketStart == pointCount;
+        }
+        if (singleBucket) {
+            continue;  // All keys share this digit. The pass would not change the order.
+        }
+
+        jobManager.parallelFor(pointCount, chunkSize, [&](const size_t begin, const size_t end) {
+            std::array<size_t, bucketCount>& offsets = chunkOffsets[begin / chunkSize];
+            for (size_t i = begin; i < end; ++i) {
+                sortBuffer[offsets[(keyedPoints[i].key >> digitShift) & (bucketCount - 1)]++] = keyedPoints[i];
+            }
+        });
+        keyedPoints.swap(sortBuffer);
+    }
+    std::vector<KeyedPoint>().swap(sortBuffer);  // Release memory
+
+    // Flag the first point of each voxel, that is, the first element of each run of equal keys.
+    std::vector<uint8_t> isFirstPoint(pointCount, 0U);
+    jobManager.parallelFor(pointCount, chunkSize, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (i == 0 || keyedPoints[i].key != keyedPoints[i - 1].key) {
+                isFirstPoint[keyedPoints[i].pointIndex] = 1U;
+            }
         }
-        pointsIdToVoxelId[inputPointIndex] = voxelCoordToVoxelIndex[voxCoord];
+    });
+
+    // Number the first points in the input order (prefix sum over the chunks), which gives the voxel index of each voxel.
+    std::vector<size_t> chunkVoxelStart(chunkCount);
+    jobManager.parallelFor(pointCount, chunkSize, [&](const size_t begin, const size_t end) {
+        chunkVoxelStart[begin / chunkSize] = static_cast<size_t>(std::count(isFirstPoint.begin() + begin, isFirstPoint.begin() + end, 1U));
+    });
+    size_t voxelCount = 0;
+    for (size_t& chunkStart : chunkVoxelStart) {
+        const size_t count = chunkStart;
+        chunkStart = voxelCount;
+        voxelCount += count;
     }
+
+    pointsIdToVoxelId.resize(pointCount);
+    voxelizedPointsGeometry.resize(voxelCount);
+    jobManager.parallelFor(pointCount, chunkSize, [&](const size_t begin, const size_t end) {
+        size_t voxelIndex = chunkVoxelStart[begin / chunkSize];
+        for (size_t pointIndex = begin; pointIndex < end; ++pointIndex) {
+            if (isFirstPoint[pointIndex] != 0U) {
+                pointsIdToVoxelId[pointIndex] = voxelIndex;
+                voxelizedPointsGeometry[voxelIndex] = voxelCoordinates(pointIndex);
+                ++voxelIndex;
+            }
+        }
+    });
+
+    // The other points of a run take the voxel index of the first point of this run. A run can start in a previous chunk.
+    jobManager.parallelFor(pointCount, chunkSize, [&](const size_t begin, const size_t end) {
+        size_t runStart = begin;
+        while (runStart > 0 && keyedPoints[runStart - 1].key == keyedPoints[begin].key) {
+            --runStart;
+        }
+        size_t voxelIndex = pointsIdToVoxelId[keyedPoints[runStart].pointIndex];
+        for (size_t i = begin; i < end; ++i) {
+            const size_t pointIndex = keyedPoints[i].pointIndex;
+            if (isFirstPoint[pointIndex] != 0U) {
+                voxelIndex = pointsIdToVoxelId[pointIndex];
+            } else {
+                pointsIdToVoxelId[pointIndex] = voxelIndex;
+            }
+        }
+    });
 }
@@ -38,14 +38,17 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <iterator>
 #include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <vector>
 
 #include "utils/parameters.hpp"
 #include "utils/constants.hpp"
+#include "utils/occupancyBitmap.hpp"
 #include "uvgutils/utils.hpp"
 #include "uvgutils/log.hpp"
 #include "uvgvpcc/uvgvpcc.hpp"
@@ -54,99 +57,240 @@ using namespace uvgvpcc_enc;
 
 PatchPacking::PatchPacking() = default;
 
-inline bool PatchPacking::checkFitPatch(const size_t& patchPosX, const size_t& patchPosY, const size_t& patchWidth, const size_t& patchHeight,
-                                        const size_t& mapHeight, const std::vector<uint8_t>& frameOccupancyMap) {
-    // TODO(lf): deprecated comments
-
-    // Iterate through the currrent patch occupancy. Weither a block is occupied or not in the patch occupancy map is not considered. The
-    // whole patch bounding box need to fit in the occupancy map. (cf precedence in TMC2)
-
-    // So, we check if a rectangle (the bounding box of the patch) can fit at the current location in the OM (posOMu and posOMv)
-    // To create a space between patches, we increase the size of this rectangle in all directions by a certain amount, depending on
-    // p_->spacePatchPacking. Notice that we don't increase the size of the rectangle in directions for which the patch overlap a border of
-    // the map. Indeed, a space is needed between the patch but not between a patch and the map border.
-
-    // To optimize this checking process, we first check all corners of this rectangle. Then we check the perimeter. Then all remaining OM
-    // block.
-    const size_t spacePatchPacking = p_->spacePatchPacking * p_->occupancyMapDSResolution;
-
-    // Everything in this function is accoridng to the downscaled occupancy map. So the unit is the OM block size. (It means that, for
-    // example, in this function, patchWidth corresponds to patch.widthInOccBlk_ and not patch.widthInPixel_) The bounding box of the patch is
-    // characterized by its size (patchWidth, patchHeight) and its current position (patchPosX,patchPosY). This position will be validated or
-    // not by this function. The rectangle is characterized by its size (areaWidth, areaHeight) and its position (areaPosX,areaPosY) To
-    // iterate through the rectangle, we use areaX and areaY The corresponding coordinate on the occupancy map are mapX and mapY
-
-    // TODO(lf): use accumulate function to compute sum of occupancy map block for big area that are likely to be empty, instead of for loop
-    // with if condition TODO(lf): is there a risk for overflow with spacePatchPacking-1 or any other unsigned typed variable like this ?
-    // spacePatchPacking can be 0
-
-    const size_t mapWidth = p_->mapWidth;
-
-    const size_t areaPosX = patchPosX - std::min(spacePatchPacking, patchPosX);  // Check if near left map border
-    const size_t areaPosY = patchPosY - std::min(spacePatchPacking, patchPosY);  // Check if near top map border
-
-    // Check top left corner of the area
-    if (static_cast<bool>(frameOccupancyMap[areaPosX + areaPosY * mapWidth])) {
-        return false;
+// Free spans of the frame occupancy map, at the occupancy block level. A block is occupied if any of its pixels is occupied. For each block,
+// store the length of the run of free (positive) or occupied (negative) blocks starting at this block on its row. The largest free span of
+// each row is also kept, so that the rows too crowded for a patch can be skipped at once.
+class OccupancyFreeSpans {
+   public:
+    OccupancyFreeSpans(const OccupancyBitmap& occupancyMap, const size_t mapHeight)
+        : blockSize_(p_->occupancyMapDSResolution), widthInBlk_(p_->mapWidth / blockSize_) {
+        assert(p_->mapWidth % blockSize_ == 0);
+        resize(mapHeight);
+        for (size_t blockY = 0; blockY < heightInBlk_; ++blockY) {
+            updateRow(occupancyMap, blockY, 0, widthInBlk_);
+        }
     }
 
-    const size_t areaWidth =
-        patchWidth + std::min(spacePatchPacking, patchPosX) + std::min(spacePatchPacking, mapWidth - (patchPosX + patchWidth));
+    // The new rows are free.
+    void resize(const size_t mapHeight) {
+        assert(mapHeight % blockSize_ == 0);
+        const size_t previousHeightInBlk = heightInBlk_;
+        heightInBlk_ = mapHeight / blockSize_;
+        runs_.resize(heightInBlk_ * widthInBlk_);
+        rowMaxSpans_.resize(heightInBlk_, widthInBlk_);
+        for (size_t blockY = previousHeightInBlk; blockY < heightInBlk_; ++blockY) {
+            for (size_t blockX = 0; blockX < widthInBlk_; ++blockX) {
+                runs_[blockY * widthInBlk_ + blockX] = static_cast<int32_t>(widthInBlk_ - blockX);
+            }
+        }
+    }
 
-    // Check top right corner of the area
-    if (static_cast<bool>(frameOccupancyMap[areaPosX + areaWidth - 1 + areaPosY * mapWidth])) {
-        return false;
+    // Update the runs after that the area (in pixels) has been written in the occupancy map.
+    void update(const OccupancyBitmap& occupancyMap, const size_t posX, const size_t posY, const size_t width, const size_t height) {
+        for (size_t blockY = posY / blockSize_; blockY < (posY + height) / blockSize_; ++blockY) {
+            updateRow(occupancyMap, blockY, posX / blockSize_, (posX + width) / blockSize_);
+        }
     }
 
-    const size_t areaHeight =
-        patchHeight + std::min(spacePatchPacking, patchPosY) + std::min(spacePatchPacking, mapHeight - (patchPosY + patchHeight));
+    // Number of consecutive free blocks starting at this block (0 if the block is occupied).
+    size_t freeSpan(const size_t blockX, const size_t blockY) const {
+        return static_cast<size_t>(std::max(runs_[blockY * widthInBlk_ + blockX], 0));
+    }
 
-    // Check bottom left corner of the area
-    if (static_cast<bool>(frameOccupancyMap[areaPosX + (areaPosY + areaHeight - 1) * mapWidth])) {
-        return false;
+    // First block of the row, from 'blockX', whose free span is at least 'widthInBlk'. Return the row width if there is none.
+    size_t nextFreeSpan(size_t blockX, const size_t blockY, const size_t widthInBlk) const {
+        const int32_t* rowRuns = &runs_[blockY * widthInBlk_];
+        while (blockX < widthInBlk_ && rowRuns[blockX] < static_cast<int32_t>(widthInBlk)) {
+            blockX += static_cast<size_t>(std::abs(rowRuns[blockX]));
+        }
+        return std::min(blockX, widthInBlk_);
     }
-    // Check bottom right corner of the area
-    if (static_cast<bool>(frameOccupancyMap[areaPosX + areaWidth - 1 + (areaPosY + areaHeight - 1) * mapWidth])) {
-        return false;
+
+    // Return false if one of the rows [blockYBegin, blockYEnd) has no free span of 'widthInBlk' blocks.
+    bool rowsMayFit(const size_t blockYBegin, const size_t blockYEnd, const size_t widthInBlk) const {
+        assert(blockYEnd <= heightInBlk_);
+        return std::all_of(rowMaxSpans_.begin() + static_cast<ptrdiff_t>(blockYBegin), rowMaxSpans_.begin() + static_cast<ptrdiff_t>(blockYEnd),
+                           [widthInBlk](const size_t maxSpan) { return maxSpan >= widthInBlk; });
     }
 
-    // Check the top and bottom perimeter section of the area
-    for (size_t mapPos = areaPosX + 1 + areaPosY * mapWidth; mapPos < areaPosX + areaWidth - 1 + areaPosY * mapWidth; ++mapPos) {
-        if (static_cast<bool>(frameOccupancyMap[mapPos])) {
-            return false;
+   private:
+    // Read the occupancy of the blocks [blockXBegin, blockXEnd) of a row, then update the runs of this row on their left.
+    void updateRow(const OccupancyBitmap& occupancyMap, const size_t blockY, const size_t blockXBegin, const size_t blockXEnd) {
+        int32_t* rowRuns = &runs_[blockY * widthInBlk_];
+        int32_t nextRun = blockXEnd < widthInBlk_ ? rowRuns[blockXEnd] : 0;
+        for (size_t blockX = blockXEnd; blockX-- > 0;) {
+            bool occupied = rowRuns[blockX] < 0;
+            if (blockX >= blockXBegin) {
+                for (size_t y = blockY * blockSize_; y < (blockY + 1) * blockSize_ && !occupied; ++y) {
+                    occupied = occupancyMap.anyInRow(blockX * blockSize_, y, blockSize_);
+                }
+            }
+            const int32_t run = occupied ? std::min(nextRun, 0) - 1 : std::max(nextRun, 0) + 1;
+            if (blockX < blockXBegin && run == rowRuns[blockX]) {
+                break;  // This block and the ones on its left are not impacted
+            }
+            rowRuns[blockX] = run;
+            nextRun = run;
         }
-        if (static_cast<bool>(frameOccupancyMap[mapPos + (areaHeight - 1) * mapWidth])) {
-            return false;
+        size_t maxSpan = 0;
+        for (size_t blockX = 0; blockX < widthInBlk_; blockX += static_cast<size_t>(std::abs(rowRuns[blockX]))) {
+            maxSpan = std::max(maxSpan, freeSpan(blockX, blockY));
         }
+        rowMaxSpans_[blockY] = maxSpan;
     }
 
-    // Check the left and right perimeter section of the area
-    for (size_t areaY = 1; areaY < areaHeight - 1; ++areaY) {
-        if (static_cast<bool>(frameOccupancyMap[areaPosX + (areaY + areaPosY) * mapWidth])) {
-            return false;
+    size_t blockSize_;
+    size_t widthInBlk_;
+    size_t heightInBlk_ = 0;
+    std::vector<int32_t> runs_;
+    std::vector<size_t> rowMaxSpans_;
+};
+
+// Skyline of the frame occupancy map, at the occupancy block level, for the bottom-left packing. The skyline is a list of segments covering
+// the map width. Each segment gives the first block row (from the top of the map) from which all the blocks of its columns are free. The
+// holes left above the skyline are not reused. The space between patches is reserved on the right and at the bottom of each patch.
+class OccupancySkyline {
+   public:
+    OccupancySkyline(const OccupancyBitmap& occupancyMap, const size_t mapHeight)
+        : blockSize_(p_->occupancyMapDSResolution), widthInBlk_(p_->mapWidth / blockSize_), space_(p_->spacePatchPacking) {
+        assert(p_->mapWidth % blockSize_ == 0);
+        // The map may already hold some patches (the matched ones in inter patch packing)
+        std::vector<size_t> columnLevels(widthInBlk_, 0);
+        for (size_t blockY = 0; blockY < mapHeight / blockSize_; ++blockY) {
+            for (size_t blockX = 0; blockX < widthInBlk_; ++blockX) {
+                bool occupied = false;
+                for (size_t y = blockY * blockSize_; y < (blockY + 1) * blockSize_ && !occupied; ++y) {
+                    occupied = occupancyMap.anyInRow(blockX * blockSize_, y, blockSize_);
+                }
+                if (occupied) {
+                    columnLevels[blockX] = blockY + 1 + space_;
+                }
+            }
         }
-        if (static_cast<bool>(frameOccupancyMap[areaPosX + areaWidth - 1 + (areaY + areaPosY) * mapWidth])) {
-            return false;
+        // Reserve the space on the right of these patches too
+        for (size_t blockX = widthInBlk_; blockX-- > 0;) {
+            for (size_t leftX = blockX - std::min(space_, blockX); leftX < blockX; ++leftX) {
+                columnLevels[blockX] = std::max(columnLevels[blockX], columnLevels[leftX]);
+            }
+        }
+        for (size_t blockX = 0; blockX < widthInBlk_; ++blockX) {
+            appendSegment(segments_, {blockX, 1, columnLevels[blockX]});
         }
     }
 
-    // Check remaining pixels of the area // TODO(lf): should do mapY+=p_->resolutionDS and idem for mapX and everywhere else in the function
-    // (consider only DS blocks indirectly) (depends on the minimum size of a patch)
-    for (size_t mapY = areaPosY + 1; mapY < areaPosY + areaHeight - 1; ++mapY) {
-        for (size_t mapX = areaPosX + 1; mapX < areaPosX + areaWidth - 1; ++mapX) {
-            const size_t mapPos = mapX + mapY * mapWidth;
-            if (static_cast<bool>(frameOccupancyMap[mapPos])) {
-                return false;
+    // Leftmost location with the lowest level where a patch 'widthInBlk' blocks wide rests on the skyline. Return false if the patch is
+    // wider than the map.
+    bool findLocation(const size_t widthInBlk, size_t& posX, size_t& posY) const {
+        bool found = false;
+        for (size_t segmentIdx = 0; segmentIdx < segments_.size(); ++segmentIdx) {
+            const size_t blockX = segments_[segmentIdx].posX;
+            if (blockX + widthInBlk > widthInBlk_) {
+                break;
+            }
+            const size_t footprintEnd = std::min(blockX + widthInBlk + space_, widthInBlk_);
+            size_t blockY = 0;
+            for (size_t idx = segmentIdx; idx < segments_.size() && segments_[idx].posX < footprintEnd; ++idx) {
+                blockY = std::max(blockY, segments_[idx].level);
+            }
+            if (!found || blockY < posY) {
+                found = true;
+                posX = blockX;
+                posY = blockY;
+            }
+        }
+        return found;
+    }
+
+    // Raise the skyline over the footprint of a patch placed at (posX, posY), all in blocks.
+    void addPatch(const size_t posX, const size_t posY, const size_t widthInBlk, const size_t heightInBlk) {
+        const size_t footprintEnd = std::min(posX + widthInBlk + space_, widthInBlk_);
+        updatedSegments_.clear();
+        bool inserted = false;
+        for (const Segment& segment : segments_) {
+            const size_t segmentEnd = segment.posX + segment.width;
+            if (segment.posX < posX) {
+                appendSegment(updatedSegments_, {segment.posX, std::min(segmentEnd, posX) - segment.posX, segment.level});
+            }
+            if (!inserted && segmentEnd > posX) {
+                appendSegment(updatedSegments_, {posX, footprintEnd - posX, posY + heightInBlk + space_});
+                inserted = true;
+            }
+            if (segmentEnd > footprintEnd) {
+                const size_t begin = std::max(segment.posX, footprintEnd);
+                appendSegment(updatedSegments_, {begin, segmentEnd - begin, segment.level});
             }
         }
+        segments_.swap(updatedSegments_);
+    }
+
+   private:
+    struct Segment {
+        size_t posX;
+        size_t width;
+        size_t level;
+    };
+
+    // Merge the neighbouring segments of same level
+    static void appendSegment(std::vector<Segment>& segments, const Segment& segment) {
+        if (!segments.empty() && segments.back().level == segment.level) {
+            segments.back().width += segment.width;
+        } else {
+            segments.push_back(segment);
+        }
+    }
+
+    size_t blockSize_;
+    size_t widthInBlk_;
+    size_t space_;
+    std::vector<Segment> segments_;
+    std::vector<Segment> updatedSegments_;
+};
+
+inline bool PatchPacking::checkFitPatch(const size_t& patchPosX, const size_t& patchPosY, const size_t& patchWidth, const size_t& patchHeight,
+                                        const size_t& mapHeight, const OccupancyFreeSpans& freeSpans, size_t& minAreaPosX) {
+    // The whole patch bounding box need to fit in the occupancy map. Weither a block is occupied or not in the patch occupancy map is not
+    // considered. (cf precedence in TMC2)
+
+    // So, we check if a rectangle (the bounding box of the patch) can fit at the current location in the OM (patchPosX and patchPosY).
+    // To create a space between patches, we increase the size of this rectangle in all directions by a certain amount, depending on
+    // p_->spacePatchPacking. Notice that we don't increase the size of the rectangle in directions for which the patch overlap a border of
+    // the map. Indeed, a space is needed between the patch but not between a patch and the map border.
+
+    // The location, the size of the patch and the space are multiples of the occupancy block size. The rectangle is then free if, on each of
+    // its block rows, the free span of its first block covers its width.
+    const size_t blockSize = p_->occupancyMapDSResolution;
+    const size_t spacePatchPacking = p_->spacePatchPacking * blockSize;
+    const size_t mapWidth = p_->mapWidth;
+
+    const size_t areaPosX = patchPosX - std::min(spacePatchPacking, patchPosX);  // Check if near left map border
+    if (areaPosX < minAreaPosX) {
+        // An occupied block, on the rows of this rectangle, has already been found after this location
+        return false;
     }
+    const size_t areaPosY = patchPosY - std::min(spacePatchPacking, patchPosY);  // Check if near top map border
+    const size_t areaWidth =
+        patchWidth + std::min(spacePatchPacking, patchPosX) + std::min(spacePatchPacking, mapWidth - (patchPosX + patchWidth));
+    const size_t areaHeight =
+        patchHeight + std::min(spacePatchPacking, patchPosY) + std::min(spacePatchPacking, mapHeight - (patchPosY + patchHeight));
 
+    // If a row of the rectangle is not free, the next locations of this row of locations, with the same patch size, cannot fit before the
+    // next free span of this row as wide as their rectangle. The space on the right of the rectangle may be cut by the map border, so only
+    // the patch and its left space are considered. The furthest such span over the rows of the rectangle is kept.
+    const size_t areaBlockX = areaPosX / blockSize;
+    const size_t areaWidthInBlk = areaWidth / blockSize;
+    const size_t minWidthInBlk = (patchPosX - areaPosX + patchWidth) / blockSize;
+    for (size_t blockY = areaPosY / blockSize; blockY < (areaPosY + areaHeight) / blockSize; ++blockY) {
+        if (freeSpans.freeSpan(areaBlockX, blockY) < areaWidthInBlk) {
+            minAreaPosX = freeSpans.nextFreeSpan(areaBlockX, blockY, minWidthInBlk) * blockSize;
+            return false;
+        }
+    }
     return true;
 }
 
 inline bool PatchPacking::checkLocation(const size_t& mapHeight, const size_t& posOMu, const size_t& posOMv, const size_t& patchWidth,
                                         const size_t& patchHeight, size_t& maxPatchHeight, uvgvpcc_enc::Patch& patch,
-                                        const std::vector<uint8_t>& frameOccupancyMap) {
+                                        const OccupancyFreeSpans& freeSpans, size_t& minAreaPosX) {
     const size_t heightBound = posOMv + patchHeight;
     const size_t widthBound = posOMu + patchWidth;
 
@@ -155,7 +299,7 @@ inline bool PatchPacking::checkLocation(const size_t& mapHeight, const size_t& p
         return false;
     }
 
-    const bool locationFound = checkFitPatch(posOMu, posOMv, patchWidth, patchHeight, mapHeight, frameOccupancyMap);
+    const bool locationFound = checkFitPatch(posOMu, posOMv, patchWidth, patchHeight, mapHeight, freeSpans, minAreaPosX);
     if (locationFound) {
         patch.omDSPosX_ = posOMu / p_->occupancyMapDSResolution;
         patch.omDSPosY_ = posOMv / p_->occupancyMapDSResolution;
@@ -167,23 +311,39 @@ inline bool PatchPacking::checkLocation(const size_t& mapHeight, const size_t& p
 }
 
 bool PatchPacking::findPatchLocation(const size_t& mapHeight, size_t& maxPatchHeight, uvgvpcc_enc::Patch& patch,
-                                     const std::vector<uint8_t>& frameOccupancyMap) {
+                                     const OccupancyFreeSpans& freeSpans) {
     // Iterate over the occupancy map. For each position, check if the patch fit with the default orientation and with its axis swaped.
+    // For each row of positions and each orientation, the positions whose rectangle starts before 'minAreaPosX' are known not to fit. The
+    // positions that do not fit with any orientation are skipped.
     bool locationFound = false;
     const size_t step = (1 + p_->spacePatchPacking) * p_->occupancyMapDSResolution;
+    const size_t spacePatchPacking = p_->spacePatchPacking * p_->occupancyMapDSResolution;
     assert(patch.widthInOccBlk_ * p_->occupancyMapDSResolution == patch.widthInPixel_);
+    const size_t blockSize = p_->occupancyMapDSResolution;
+    const auto orientationMayFit = [&](const size_t posOMv, const size_t patchWidth, const size_t patchHeight) {
+        return posOMv + patchHeight <= mapHeight && freeSpans.rowsMayFit(posOMv / blockSize, (posOMv + patchHeight) / blockSize, patchWidth / blockSize);
+    };
     for (size_t posOMv = 0; posOMv < mapHeight && !locationFound; posOMv += step) {
+        // A row of the patch without a free span as wide as the patch excludes the whole row of locations for this orientation.
+        size_t minAreaPosX = orientationMayFit(posOMv, patch.widthInPixel_, patch.heightInPixel_) ? 0 : p_->mapWidth;
+        size_t minAreaPosXSwap = orientationMayFit(posOMv, patch.heightInPixel_, patch.widthInPixel_) ? 0 : p_->mapWidth;
         for (size_t posOMu = 0; posOMu < p_->mapWidth; posOMu += step) {
-            locationFound =
-                checkLocation(mapHeight, posOMu, posOMv, patch.widthInPixel_, patch.heightInPixel_, maxPatchHeight, patch, frameOccupancyMap);
+            const size_t minAreaPosXAny = std::min(minAreaPosX, minAreaPosXSwap);
+            if (minAreaPosXAny > 0) {
+                // The rectangle of the location posOMu starts at posOMu - spacePatchPacking (posOMu > spacePatchPacking here)
+                posOMu = std::max(posOMu, (minAreaPosXAny + spacePatchPacking + step - 1) / step * step);
+                if (posOMu >= p_->mapWidth) break;
+            }
+            locationFound = checkLocation(mapHeight, posOMu, posOMv, patch.widthInPixel_, patch.heightInPixel_, maxPatchHeight, patch,
+                                          freeSpans, minAreaPosX);
             if (locationFound) {
                 patch.axisSwap_ = false;
                 return true;
             }
 
             // Swap patch width and height
-            locationFound =
-                checkLocation(mapHeight, posOMu, posOMv, patch.heightInPixel_, patch.widthInPixel_, maxPatchHeight, patch, frameOccupancyMap);
+            locationFound = checkLocation(mapHeight, posOMu, posOMv, patch.heightInPixel_, patch.widthInPixel_, maxPatchHeight, patch,
+                                          freeSpans, minAreaPosXSwap);
             if (locationFound) {
                 patch.axisSwap_ = true;
                 return true;
@@ -193,6 +353,34 @@ bool PatchPacking::findPatchLocation(const size_t& mapHeight, size_t& maxPatchHe
     return false;
 }
 
+bool PatchPacking::findPatchLocationSkyline(const size_t& mapHeight, size_t& maxPatchHeight, uvgvpcc_enc::Patch& patch,
+                                            const OccupancySkyline& skyline) {
+    // Find the lowest location on the skyline for both orientations, and keep the one giving the lowest bottom edge (the default one on a
+    // tie).
+    size_t posX = 0;
+    size_t posY = 0;
+    size_t posXSwap = 0;
+    size_t posYSwap = 0;
+    const bool found = skyline.findLocation(patch.widthInOccBlk_, posX, posY);
+    const bool foundSwap = skyline.findLocation(patch.heightInOccBlk_, posXSwap, posYSwap);
+    if (!found && !foundSwap) {
+        return false;
+    }
+    const bool axisSwap = !found || (foundSwap && posYSwap + patch.widthInOccBlk_ < posY + patch.heightInOccBlk_);
+
+    const size_t heightBound = ((axisSwap ? posYSwap : posY) + (axisSwap ? patch.widthInOccBlk_ : patch.heightInOccBlk_)) *
+                               p_->occupancyMapDSResolution;
+    if (heightBound > mapHeight) {
+        return false;
+    }
+
+    patch.omDSPosX_ = axisSwap ? posXSwap : posX;
+    patch.omDSPosY_ = axisSwap ? posYSwap : posY;
+    patch.axisSwap_ = axisSwap;
+    maxPatchHeight = std::max(maxPatchHeight, heightBound);
+    return true;
+}
+
 // TODO(lf): First test swap patch rotation mode if this minimize hypothetic resulting map height
 
 // Patch placement and indirect occupancy map generation //
@@ -205,7 +393,7 @@ void PatchPacking::frameIntraPatchPacking(const std::shared_ptr<uvgvpcc_enc::Fra
     if(!p_->dynamicMapHeight) {
         assert(frame->mapHeight == p_->minimumMapHeight);
     }
-    frame->occupancyMap->resize(p_->mapWidth * frame->mapHeight, 0);
+    frame->occupancyMap->resize(p_->mapWidth, frame->mapHeight);
     
     // If the inter patch packing mode is deactivated, the intra patch packing is done over all frame patches. Thus, the patchListSpan
     // corresponds to the frame patch list. When the inter patch packing is activated, this intra packing function will be called only for the
@@ -214,17 +402,30 @@ void PatchPacking::frameIntraPatchPacking(const std::shared_ptr<uvgvpcc_enc::Fra
     
     size_t mapHeightTemp = frame->mapHeight;
     size_t maxPatchHeight = 0;  // Maximum height occupied by a patch
+    // Only the structure of the selected packing method is built
+    const bool skylinePacking = p_->patchPackingMethod == "skyline";
+    std::optional<OccupancyFreeSpans> freeSpans;
+    std::optional<OccupancySkyline> skyline;
+    if (skylinePacking) {
+        skyline.emplace(*frame->occupancyMap, mapHeightTemp);
+    } else {
+        freeSpans.emplace(*frame->occupancyMap, mapHeightTemp);
+    }
 
     // Iterate over all patches of the frame //
     bool locationFound = false;
     for (auto& patch : patchList) {
         for (;;) {
-            locationFound = findPatchLocation(mapHeightTemp, maxPatchHeight, patch, *frame->occupancyMap);
+            locationFound = skylinePacking ? findPatchLocationSkyline(mapHeightTemp, maxPatchHeight, patch, *skyline)
+                                           : findPatchLocation(mapHeightTemp, maxPatchHeight, patch, *freeSpans);
             if (locationFound || !p_->dynamicMapHeight) {
                 break;
             }
             mapHeightTemp *= 2;
-            frame->occupancyMap->resize(p_->mapWidth * mapHeightTemp);
+            frame->occupancyMap->resize(p_->mapWidth, mapHeightTemp);
+            if (!skylinePacking) {
+                freeSpans->resize(mapHeightTemp);
+            }
         }
         
         if (!locationFound) {
@@ -240,14 +441,9 @@ void PatchPacking::frameIntraPatchPacking(const std::shared_ptr<uvgvpcc_enc::Fra
         if (!patch.axisSwap_) {
             // Line by line, copy the 'patch DS occupancy map' into the 'frame DS occupancy map' at the previously found patch location //
             for (size_t patchY = 0; patchY < patch.heightInPixel_; ++patchY) {
-                const size_t srcOffset = patchY * patch.widthInPixel_;
-                const size_t dstOffset =
-                    (patch.omDSPosY_ * p_->occupancyMapDSResolution + patchY) * p_->mapWidth + patch.omDSPosX_ * p_->occupancyMapDSResolution;
-
-                auto srcIt = patch.patchOccupancyMap_.begin();
-                auto dstIt = frame->occupancyMap->begin();
-                std::copy(srcIt + static_cast<ptrdiff_t>(srcOffset), srcIt + static_cast<ptrdiff_t>(srcOffset + patch.widthInPixel_),
-                          dstIt + static_cast<ptrdiff_t>(dstOffset));
+                frame->occupancyMap->writeRow(patch.omDSPosX_ * p_->occupancyMapDSResolution,
+                                              patch.omDSPosY_ * p_->occupancyMapDSResolution + patchY,
+                                              &patch.patchOccupancyMap_[patchY * patch.widthInPixel_], patch.widthInPixel_);
             }
 
         } else {
@@ -256,12 +452,22 @@ void PatchPacking::frameIntraPatchPacking(const std::shared_ptr<uvgvpcc_enc::Fra
             // The area of the occupancy map is written in an swapped way : colomn by colomn
             for (size_t patchX = 0; patchX < patch.widthInPixel_; ++patchX) {
                 for (size_t patchY = 0; patchY < patch.heightInPixel_; ++patchY) {
-                    (*frame->occupancyMap)[patch.omDSPosX_ * p_->occupancyMapDSResolution + patchY +
-                                        (patchX + patch.omDSPosY_ * p_->occupancyMapDSResolution) * p_->mapWidth] =
-                        patch.patchOccupancyMap_[patchX + patchY * patch.widthInPixel_];
+                    frame->occupancyMap->set(patch.omDSPosX_ * p_->occupancyMapDSResolution + patchY,
+                                             patchX + patch.omDSPosY_ * p_->occupancyMapDSResolution,
+                                             patch.patchOccupancyMap_[patchX + patchY * patch.widthInPixel_] != 0U);
                 }
             }
         }
+
+        const size_t packedWidth = patch.axisSwap_ ? patch.heightInPixel_ : patch.widthInPixel_;
+        const size_t packedHeight = patch.axisSwap_ ? patch.widthInPixel_ : patch.heightInPixel_;
+        if (skylinePacking) {
+            skyline->addPatch(patch.omDSPosX_, patch.omDSPosY_, packedWidth / p_->occupancyMapDSResolution,
+                              packedHeight / p_->occupancyMapDSResolution);
+        } else {
+            freeSpans->update(*frame->occupancyMap, patch.omDSPosX_ * p_->occupancyMapDSResolution,
+                              patch.omDSPosY_ * p_->occupancyMapDSResolution, packedWidth, packedHeight);
+        }
     }
     
     if (p_->dynamicMapHeight) {
@@ -297,11 +503,9 @@ void PatchPacking::frameInterPatchPacking(const std::vector<uvgvpcc_enc::Patch>&
         if (!patch.axisSwap_) {
             // Line by line, copy the patch occupancy into the occupancy map at the previously found location //
             for (size_t patchY = 0; patchY < patch.heightInPixel_; ++patchY) {
-                for (size_t patchX = 0; patchX < patch.widthInPixel_; ++patchX) {
-                    (*frame->occupancyMap)[patch.omDSPosX_ * p_->occupancyMapDSResolution + patchX +
-                                        (patchY + patch.omDSPosY_ * p_->occupancyMapDSResolution) * p_->mapWidth] =
-                        patch.patchOccupancyMap_[patchX + patchY * patch.widthInPixel_];
-                }
+                frame->occupancyMap->writeRow(patch.omDSPosX_ * p_->occupancyMapDSResolution,
+                                              patchY + patch.omDSPosY_ * p_->occupancyMapDSResolution,
+                                              &patch.patchOccupancyMap_[patchY * patch.widthInPixel_], patch.widthInPixel_);
             }
 
         } else {
@@ -310,15 +514,82 @@ void PatchPacking::frameInterPatchPacking(const std::vector<uvgvpcc_enc::Patch>&
             // The area of the occupancy map is written in an swapped way : colomn by colomn
             for (size_t patchX = 0; patchX < patch.widthInPixel_; ++patchX) {
                 for (size_t patchY = 0; patchY < patch.heightInPixel_; ++patchY) {
-                    (*frame->occupancyMap)[patch.omDSPosX_ * p_->occupancyMapDSResolution + patchY +
-                                        (patchX + patch.omDSPosY_ * p_->occupancyMapDSResolution) * p_->mapWidth] =
-                        patch.patchOccupancyMap_[patchX + patchY * patch.widthInPixel_];
+                    frame->occupancyMap->set(patch.omDSPosX_ * p_->occupancyMapDSResolution + patchY,
+                                             patchX + patch.omDSPosY_ * p_->occupancyMapDSResolution,
+                                             patch.patchOccupancyMap_[patchX + patchY * patch.widthInPixel_] != 0U);
                 }
             }
         }
     }
 }
 
+// Uniform grid over the (posU_, posV_) plane of the patches of a frame, one per projection axis (patchPpi_ % 3), so that the patch matching
+// scores only the patches whose bounding boxes may overlap. Each cell lists, in increasing order, the patches it overlaps (CSR layout).
+class PatchGrid {
+   public:
+    explicit PatchGrid(const std::vector<uvgvpcc_enc::Patch>& patches) : visitStamps_(patches.size(), 0) {
+        size_t extent = 1;
+        for (const auto& patch : patches) {
+            extent = std::max({extent, patch.posU_ + patch.widthInPixel_, patch.posV_ + patch.heightInPixel_});
+        }
+        cellSize_ = (extent + gridSize - 1) / gridSize;
+
+        cellOffsets_.assign(3 * gridSize * gridSize + 1, 0);
+        for (const auto& patch : patches) {
+            forEachCell(patch, [this](const size_t cell) { ++cellOffsets_[cell + 1]; });
+        }
+        for (size_t cell = 0; cell + 1 < cellOffsets_.size(); ++cell) {
+            cellOffsets_[cell + 1] += cellOffsets_[cell];
+        }
+        cellPatches_.resize(cellOffsets_.back());
+        std::vector<size_t> cellFill(cellOffsets_.begin(), cellOffsets_.end() - 1);
+        for (size_t patchIdx = 0; patchIdx < patches.size(); ++patchIdx) {
+            forEachCell(patches[patchIdx], [&](const size_t cell) { cellPatches_[cellFill[cell]++] = patchIdx; });
+        }
+    }
+
+    // Call 'func(patchIdx)' once for each patch of the grid with the same projection axis as 'patch' and whose bounding box may overlap it.
+    template <typename Func>
+    void forEachCandidate(const uvgvpcc_enc::Patch& patch, Func&& func) {
+        ++stamp_;
+        forEachCell(patch, [&](const size_t cell) {
+            for (size_t idx = cellOffsets_[cell]; idx < cellOffsets_[cell + 1]; ++idx) {
+                const size_t patchIdx = cellPatches_[idx];
+                if (visitStamps_[patchIdx] != stamp_) {
+                    visitStamps_[patchIdx] = stamp_;
+                    func(patchIdx);
+                }
+            }
+        });
+    }
+
+   private:
+    static constexpr size_t gridSize = 32;  // Number of cells along each side
+
+    template <typename Func>
+    void forEachCell(const uvgvpcc_enc::Patch& patch, Func&& func) const {
+        const size_t cellUBegin = patch.posU_ / cellSize_;
+        const size_t cellVBegin = patch.posV_ / cellSize_;
+        if (cellUBegin >= gridSize || cellVBegin >= gridSize) {
+            return;  // Outside of the grid, no patch to overlap
+        }
+        const size_t cellUEnd = std::min((patch.posU_ + std::max(patch.widthInPixel_, size_t{1}) - 1) / cellSize_ + 1, gridSize);
+        const size_t cellVEnd = std::min((patch.posV_ + std::max(patch.heightInPixel_, size_t{1}) - 1) / cellSize_ + 1, gridSize);
+        const size_t axisOffset = (patch.patchPpi_ % 3) * gridSize * gridSize;
+        for (size_t cellV = cellVBegin; cellV < cellVEnd; ++cellV) {
+            for (size_t cellU = cellUBegin; cellU < cellUEnd; ++cellU) {
+                func(axisOffset + cellV * gridSize + cellU);
+            }
+        }
+    }
+
+    size_t cellSize_;
+    std::vector<size_t> cellOffsets_;
+    std::vector<size_t> cellPatches_;
+    std::vector<uint32_t> visitStamps_;
+    uint32_t stamp_ = 0;
+};
+
 float PatchPacking::computeIoU(const uvgvpcc_enc::Patch& currentPatch, const uvgvpcc_enc::Patch& previousPatch) {
     // Compute the intersection of the space in the 3D world, from the point of view of the projection plan (both patch have the same
     // projection axis).
@@ -359,6 +630,9 @@ void PatchPacking::patchMatchingBetweenTwoFrames(const std::shared_ptr<uvgvpcc_e
                                                  const std::shared_ptr<uvgvpcc_enc::Frame>& previousFrame) {
     int id = 0;
 
+    // Only the current patches with the same projection axis and an overlapping bounding box can have a non-zero IoU
+    PatchGrid currentPatchGrid(*currentFrame->patchList);
+
     // main loop.
     for (auto& patch : *previousFrame->patchList) {
         id++;
@@ -367,20 +641,21 @@ void PatchPacking::patchMatchingBetweenTwoFrames(const std::shared_ptr<uvgvpcc_e
         }
 
         float maxIou = 0.0F;
-        int bestIdx = -1;
-        int cId = 0;
-        for (auto& cpatch : *currentFrame->patchList) {  // my comment : current patch
-            if ((patch.patchPpi_ % 3 == cpatch.patchPpi_ % 3) && cpatch.bestMatchIdx == uvgvpcc_enc::INVALID_PATCH_INDEX) {
-                // TODO(lf)flip normal of a patch to make them point toward the nearest projection plan (amoung the
-                // two that are aligned on the projection axis) during the normal orientation process
-                const float iou = computeIoU(patch, cpatch);
-                if (iou > maxIou) {
-                    maxIou = iou;
-                    bestIdx = cId;
-                }
+        size_t bestIdx = uvgvpcc_enc::INVALID_PATCH_INDEX;
+        currentPatchGrid.forEachCandidate(patch, [&](const size_t cId) {
+            const auto& cpatch = (*currentFrame->patchList)[cId];  // my comment : current patch
+            if (cpatch.bestMatchIdx != uvgvpcc_enc::INVALID_PATCH_INDEX) {
+                return;
             }
-            cId++;
-        }
+            // TODO(lf)flip normal of a patch to make them point toward the nearest projection plan (amoung the
+            // two that are aligned on the projection axis) during the normal orientation process
+            const float iou = computeIoU(patch, cpatch);
+            // The candidates are not visited in the patch list order. On a tie, keep the first patch of the list.
+            if (iou > maxIou || (iou == maxIou && iou > 0.F && cId < bestIdx)) {
+                maxIou = iou;
+                bestIdx = cId;
+            }
+        });
 
         if (maxIou > p_->gpaTresholdIoU) {
             (*currentFrame->patchList)[bestIdx].bestMatchIdx = id - 1;  // best previous frame patch index
@@ -482,7 +757,7 @@ void PatchPacking::gofPatchPacking(const std::shared_ptr<uvgvpcc_enc::GOF>& gof)
     // Reset the occupancy map of the first frame //
     // Not done by default in the function frameIntraPatchPacking(...) as the resize operation do not write the '0' in the non
     // resized portion of the vector.
-    std::fill(firstFrame->occupancyMap->begin(), firstFrame->occupancyMap->end(), 0);
+    firstFrame->occupancyMap->clear();
 
     // Reorder the patches in each frame patch list so that the first ones are the matched ones (and that they respect the order of the union
     // patches). This is needed as this order is also the packing order, which is used by the decoder. TODO(lf) : verify
@@ -548,7 +823,7 @@ void PatchPacking::gofPatchPacking(const std::shared_ptr<uvgvpcc_enc::GOF>& gof)
             assert(frame->mapHeight == p_->minimumMapHeight);
             assert(frame->mapHeightDS == p_->minimumMapHeight / p_->occupancyMapDSResolution);
         }
-        frame->occupancyMap->resize(p_->mapWidth * frame->mapHeight, 0);
+        frame->occupancyMap->resize(p_->mapWidth, frame->mapHeight);
             
         // Separate in two the frame patch list to distinguish the matched and non-matched patches. This symbolic or superficial, no impact on
         // memory.
@@ -60,6 +60,9 @@ const std::vector<int> g_orientationVertical = {
     PATCH_ORIENTATION_SWAP,     // Vertical orientation swap
 };
 
+class OccupancyFreeSpans;
+class OccupancySkyline;
+
 class PatchPacking {
    public:
     PatchPacking();
@@ -72,13 +75,16 @@ class PatchPacking {
    private:
 
     static bool findPatchLocation(const size_t& mapHeight, size_t& maxPatchHeight,
-                                  uvgvpcc_enc::Patch& patch, const std::vector<uint8_t>& frameOccupancyMap);
+                                  uvgvpcc_enc::Patch& patch, const OccupancyFreeSpans& freeSpans);
+    static bool findPatchLocationSkyline(const size_t& mapHeight, size_t& maxPatchHeight,
+                                         uvgvpcc_enc::Patch& patch, const OccupancySkyline& skyline);
     static bool checkLocation(const size_t& mapHeight, const size_t& posOMu, const size_t& posOMv,
                               const size_t& patchWidth, const size_t& patchHeight, size_t& maxPatchHeight,
-                              uvgvpcc_enc::Patch& patch, const std::vector<uint8_t>& frameOccupancyMap);
+                              uvgvpcc_enc::Patch& patch, const OccupancyFreeSpans& freeSpans, size_t& minAreaPosX);
 
     static bool checkFitPatch(const size_t& patchPosX, const size_t& patchPosY, const size_t& patchWidth,
-                              const size_t& patchHeight, const size_t& mapHeight, const std::vector<uint8_t>& frameOccupancyMap);
+                              const size_t& patchHeight, const size_t& mapHeight, const OccupancyFreeSpans& freeSpans,
+                              size_t& minAreaPosX);
 
     static void patchMatchingBetweenTwoFrames(const std::shared_ptr<uvgvpcc_enc::Frame>& currentFrame,
                                               const std::shared_ptr<uvgvpcc_enc::Frame>& previousFrame);
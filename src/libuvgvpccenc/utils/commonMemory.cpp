@@ -37,12 +37,6 @@
 
 namespace uvgvpcc_enc {
 
-// lf: Use leaky singleton to ensure the CommonMemory instance is not destroy before any GOF is used.
-CommonMemory& CommonMemory::get() {
-    static CommonMemory* instance = new CommonMemory();
-    return *instance;
-}
-
 void CommonMemory::clearGofMaps(const size_t& gofId) {
     std::lock_guard<std::mutex> lock(mapMutex);
 
@@ -38,6 +38,7 @@
 #include "../patchGeneration/robin_hood.h"
 #include "uvgvpcc/uvgvpcc.hpp"
 #include "constants.hpp"
+#include "occupancyBitmap.hpp"
 
 namespace uvgvpcc_enc {
 
@@ -46,11 +47,9 @@ struct Patch;
 class CommonMemory {
     
     public:
-    static CommonMemory& get();  // lf: leaky singleton
-    
     robin_hood::unordered_map<size_t,std::unique_ptr<std::array<std::vector<Patch>, MAX_GOF_SIZE>>> mapFramePatches;
     
-    robin_hood::unordered_map<size_t,std::unique_ptr<std::array<std::vector<uint8_t>, MAX_GOF_SIZE>>> mapFrameOccupancyMaps;
+    robin_hood::unordered_map<size_t,std::unique_ptr<std::array<OccupancyBitmap,      MAX_GOF_SIZE>>> mapFrameOccupancyMaps;
     robin_hood::unordered_map<size_t,std::unique_ptr<std::array<std::vector<uint8_t>, MAX_GOF_SIZE>>> mapFrameOccupancyMapsDS;
     robin_hood::unordered_map<size_t,std::unique_ptr<std::array<std::vector<uint8_t>, MAX_GOF_SIZE>>> mapFrameGeometryMapsL1;
     robin_hood::unordered_map<size_t,std::unique_ptr<std::array<std::vector<uint8_t>, MAX_GOF_SIZE>>> mapFrameGeometryMapsL2;
@@ -59,7 +58,7 @@ class CommonMemory {
 
 
     std::array<std::vector<Patch>,    MAX_GOF_SIZE>* getOrCreateFramePatches        (size_t gofId) { return getOrCreate(mapFramePatches,          gofId); }
-    std::array<std::vector<uint8_t>,  MAX_GOF_SIZE>* getOrCreateFrameOccupancyMaps  (size_t gofId) { return getOrCreate(mapFrameOccupancyMaps,     gofId); }
+    std::array<OccupancyBitmap,       MAX_GOF_SIZE>* getOrCreateFrameOccupancyMaps  (size_t gofId) { return getOrCreate(mapFrameOccupancyMaps,     gofId); }
     std::array<std::vector<uint8_t>,  MAX_GOF_SIZE>* getOrCreateFrameOccupancyMapsDS(size_t gofId) { return getOrCreate(mapFrameOccupancyMapsDS,   gofId); }
     std::array<std::vector<uint8_t>,  MAX_GOF_SIZE>* getOrCreateFrameGeometryMapsL1 (size_t gofId) { return getOrCreate(mapFrameGeometryMapsL1,    gofId); }
     std::array<std::vector<uint8_t>,  MAX_GOF_SIZE>* getOrCreateFrameGeometryMapsL2 (size_t gofId) { return getOrCreate(mapFrameGeometryMapsL2,    gofId); }
@@ -46,14 +46,15 @@
 namespace uvgvpcc_enc {
 
 using typeGeometryInput = uint16_t;
+using typePPI = uint8_t;  // Projection plane index of a point or a voxel (0-5), or one of the PPI markers below
 
 const typeGeometryInput g_infiniteDepth = (std::numeric_limits<typeGeometryInput>::max)();  // TODO(lf)be sure it is well sync with type geo
 const size_t g_infinitenumber = (std::numeric_limits<size_t>::max)();
 const size_t g_valueNotSet = (std::numeric_limits<size_t>::max)();
 
 constexpr size_t INVALID_PATCH_INDEX = std::numeric_limits<size_t>::max();
-constexpr size_t PPI_NON_ASSIGNED = std::numeric_limits<size_t>::max();
-constexpr size_t UNDEFINED_PARENT_PPI = std::numeric_limits<size_t>::max() - 1;  // TODO(lf) temp
+constexpr typePPI PPI_NON_ASSIGNED = std::numeric_limits<typePPI>::max();
+constexpr typePPI UNDEFINED_PARENT_PPI = std::numeric_limits<typePPI>::max() - 1;  // TODO(lf) temp
 
 // Projection Plan Index, 0-5 -> one of the six bounding box plan. 6+ -> used for slicing ppi attribution
 enum class PPI : uint8_t { ppi0, ppi1, ppi2, ppi3, ppi4, ppi5, ppiBlank, notAssigned};
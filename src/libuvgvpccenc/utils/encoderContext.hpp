@@ -0,0 +1,106 @@
+/*****************************************************************************
+ * This file is part of uvgVPCCenc V-PCC encoder.
+ *
+ * Copyright (c) 2024, Tampere University, ITU/ISO/IEC, project contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * * Neither the name of the Tampere University or ITU/ISO/IEC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+ ****************************************************************************/
+
+/// \file Per-encoder state. Every uvgvpcc_enc::API::Encoder instance owns one context, allowing several independent encoders to run in the
+/// same process while sharing the library thread pool.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <semaphore>
+#include <string>
+#include <unordered_map>
+
+#include "commonMemory.hpp"
+#include "parameters.hpp"
+#include "statsCollector.hpp"
+#include "uvgutils/jobManagement.hpp"
+#include "uvgvpcc/uvgvpcc.hpp"
+
+class Abstract2DMapEncoder;
+
+namespace uvgvpcc_enc {
+
+struct EncoderContext {
+    Parameters param;
+    // Map storing all parameters intending to change the state of the encoder from outside of the library.
+    std::unordered_map<std::string, std::string> apiInputParameters;
+    bool errorInAPI = false;
+    bool initializationDone = false;
+
+    // Shared with the GOFs of this encoder, as the last reference to a GOF may be released by a worker thread after the encoder is destroyed.
+    std::shared_ptr<CommonMemory> commonMemory;
+    StatsCollector stats;
+
+    std::unique_ptr<Abstract2DMapEncoder> occupancyMapDSEncoder;
+    std::unique_ptr<Abstract2DMapEncoder> geometryMapEncoder;
+    std::unique_ptr<Abstract2DMapEncoder> attributeMapEncoder;
+
+    size_t gofId = 0;
+    std::shared_ptr<GOF> currentGOF;
+    std::shared_ptr<std::counting_semaphore<UINT16_MAX>> conccurentFrameSem;
+    uvgutils::JobManager jobManager;
+    bool threadQueueAcquired = false;  // Hold a reference to the thread pool shared by the encoders (c.f. JobManager::acquireThreadQueue)
+
+    double lastStampJobCreateV3CGOFBitstream = 0.0;
+
+    EncoderContext();
+    ~EncoderContext();
+    EncoderContext(const EncoderContext&) = delete;
+    EncoderContext& operator=(const EncoderContext&) = delete;
+};
+
+// Context of the encoder whose job (or API call) is running on the current thread. 'p_' always points to the parameters of this context.
+extern thread_local constinit EncoderContext* currentContext UVGVPCC_TLS_MODEL;
+
+// Make 'context' the current encoder context of the calling thread for the lifetime of the scope.
+class EncoderContextScope {
+   public:
+    explicit EncoderContextScope(EncoderContext* context) : previousContext_(currentContext), previousParam_(p_) {
+        currentContext = context;
+        p_ = &context->param;
+    }
+    ~EncoderContextScope() {
+        currentContext = previousContext_;
+        p_ = previousParam_;
+    }
+    EncoderContextScope(const EncoderContextScope&) = delete;
+    EncoderContextScope& operator=(const EncoderContextScope&) = delete;
+
+   private:
+    EncoderContext* previousContext_;
+    const Parameters* previousParam_;
+};
+
+}  // namespace uvgvpcc_enc
@@ -331,7 +331,7 @@ void exportPointCloudNormalOrientation(const std::shared_ptr<Frame>& frame,
 
 void exportPointCloudInitialSegmentation(const std::shared_ptr<Frame>& frame,
                                          const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                                         const std::vector<size_t>& pointsPPIs) {
+                                         const std::vector<typePPI>& pointsPPIs) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>(
         "EXPORT FILE", "Export intermediate point cloud after initial segmentation for frame " + std::to_string(frame->frameId) + ".\n");
 
@@ -359,7 +359,7 @@ void exportPointCloudSubslices(const std::shared_ptr<Frame>& frame,
 
 void exportPointCloudPPIAttributionSlicing(const std::shared_ptr<Frame>& frame,
                                            const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                                           const std::vector<size_t>& pointsPPIs) {
+                                           const std::vector<typePPI>& pointsPPIs) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>(
         "EXPORT FILE", "Export intermediate point cloud after refine segmentation for frame " + std::to_string(frame->frameId) + ".\n");
 
@@ -375,7 +375,7 @@ void exportPointCloudPPIAttributionSlicing(const std::shared_ptr<Frame>& frame,
 
 void exportPointCloudRefineSegmentation(const std::shared_ptr<Frame>& frame,
                                         const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                                        const std::vector<size_t>& pointsPPIs) {
+                                        const std::vector<typePPI>& pointsPPIs) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>(
         "EXPORT FILE", "Export intermediate point cloud after refine segmentation for frame " + std::to_string(frame->frameId) + ".\n");
 
@@ -579,22 +579,25 @@ void exportImageOccupancy(const std::shared_ptr<Frame>& frame) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("EXPORT FILE",
                                                      "Export intermediate occupancy map for frame " + std::to_string(frame->frameId) + ".\n");
 
+    std::vector<uint8_t> occupancyMap;
+    frame->occupancyMap->toBytes(occupancyMap);
+
     {
         // Export the pristine occupancy map (YUV400)
         const std::string outputPath = p_->intermediateFilesDir + "/06-occupancy/OCCUPANCY_f" + uvgutils::zeroPad(frame->frameNumber, 3) +
                                        "_YUV400_" + std::to_string(p_->mapWidth) + "x" + std::to_string(frame->mapHeight) + ".yuv";
-        exportImage(outputPath, *frame->occupancyMap);
+        exportImage(outputPath, occupancyMap);
     }
 
     {
         // Export the recolored occupancy map for human viewing (RGB, PNG lossless)
-        const size_t imageSize = frame->occupancyMap->size();
+        const size_t imageSize = occupancyMap.size();
         const std::string outputPath = p_->intermediateFilesDir + "/06-occupancyRecolored/OCCUPANCY-RECOLORED_f" +
                                        uvgutils::zeroPad(frame->frameNumber, 3) + "_RGB444_" + std::to_string(p_->mapWidth) + "x" +
                                        std::to_string(frame->mapHeight) + ".rgb";
         std::vector<uint8_t> occupancyMapRecolored(imageSize * 3);
         for (size_t i = 0; i < imageSize; ++i) {
-            const uint8_t grayValue = 164 * (*frame->occupancyMap)[i];
+            const uint8_t grayValue = 164 * occupancyMap[i];
             occupancyMapRecolored[i * 3] = grayValue;
             occupancyMapRecolored[i * 3 + 1] = grayValue;
             occupancyMapRecolored[i * 3 + 2] = grayValue;
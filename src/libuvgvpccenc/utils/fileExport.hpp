@@ -66,13 +66,13 @@ void exportPointCloudNormalComputation(const std::shared_ptr<Frame>& frame, cons
 void exportPointCloudNormalOrientation(const std::shared_ptr<Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
                                        std::vector<uvgutils::VectorN<double, 3>>& normals);
 void exportPointCloudInitialSegmentation(const std::shared_ptr<Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                                         const std::vector<size_t>& pointsPPIs);
+                                         const std::vector<typePPI>& pointsPPIs);
 void exportPointCloudSubslices(const std::shared_ptr<Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,const std::vector<uvgutils::VectorN<uint8_t, 3>>& attributes,
                                        const std::string& axisStr);
 void exportPointCloudPPIAttributionSlicing(const std::shared_ptr<Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                                        const std::vector<size_t>& pointsPPIs);
+                                        const std::vector<typePPI>& pointsPPIs);
 void exportPointCloudRefineSegmentation(const std::shared_ptr<Frame>& frame, const std::vector<uvgutils::VectorN<typeGeometryInput, 3>>& pointsGeometry,
-                                        const std::vector<size_t>& pointsPPIs);
+                                        const std::vector<typePPI>& pointsPPIs);
 void exportPointCloudPatchSegmentationColor(const std::shared_ptr<Frame>& frame);
 void exportPointCloudPatchSegmentationBorder(const std::shared_ptr<Frame>& frame);
 void exportPointCloudPatchSegmentationBorderBlank(const std::shared_ptr<Frame>& frame);
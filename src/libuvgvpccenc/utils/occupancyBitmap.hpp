@@ -0,0 +1,163 @@
+/*****************************************************************************
+ * This file is part of uvgVPCCenc V-PCC encoder.
+ *
+ * Copyright (c) 2024-present, Tampere University, ITU/ISO/IEC, project contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * * Neither the name of the Tampere University or ITU/ISO/IEC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * INCLUDING NEGLIGENCE OR OTHERWISE ARISING IN ANY WAY OUT OF THE USE OF THIS
+ ****************************************************************************/
+
+
+/// \file Bit-packed binary map, used for the full resolution frame occupancy map.
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace uvgvpcc_enc {
+
+// One bit per pixel. Each row starts on a new 64-bit word, so that the row sections can be tested, counted and cleared a word at a time.
+// The maps used by the 2D encoders and by some background filling methods are still one byte per pixel. Use toBytes() to get them.
+class OccupancyBitmap {
+   public:
+    // The existing rows are kept and the new rows are empty, as long as the width does not change. Otherwise, the bitmap is cleared.
+    void resize(const size_t width, const size_t height) {
+        if (width != width_) {
+            words_.clear();
+            width_ = width;
+            wordsPerRow_ = (width + wordBits - 1) / wordBits;
+        }
+        height_ = height;
+        words_.resize(wordsPerRow_ * height_, 0);
+    }
+
+    void clear() { std::fill(words_.begin(), words_.end(), 0); }
+
+    size_t width() const { return width_; }
+    size_t height() const { return height_; }
+    size_t size() const { return width_ * height_; }  // Number of pixels
+
+    bool test(const size_t posX, const size_t posY) const {
+        assert(posX < width_ && posY < height_);
+        return ((words_[posY * wordsPerRow_ + posX / wordBits] >> (posX % wordBits)) & 1U) != 0U;
+    }
+
+    void set(const size_t posX, const size_t posY, const bool value) {
+        assert(posX < width_ && posY < height_);
+        const uint64_t bit = uint64_t{1} << (posX % wordBits);
+        uint64_t& word = words_[posY * wordsPerRow_ + posX / wordBits];
+        word = value ? (word | bit) : (word & ~bit);
+    }
+
+    // Copy 'count' pixels (non-zero bytes are occupied) to the row section starting at (posX, posY).
+    void writeRow(const size_t posX, const size_t posY, const uint8_t* src, const size_t count) {
+        forEachWord(posX, posY, count, [&src](uint64_t& word, const uint64_t mask, const size_t firstBit, const size_t bitCount) {
+            uint64_t bits = 0;
+            for (size_t i = 0; i < bitCount; ++i) {
+                bits |= static_cast<uint64_t>(src[i] != 0U) << (firstBit + i);
+            }
+            word = (word & ~mask) | bits;
+            src += bitCount;
+        });
+    }
+
+    // True if one of the 'count' pixels of the row section starting at (posX, posY) is occupied.
+    bool anyInRow(const size_t posX, const size_t posY, const size_t count) const {
+        bool any = false;
+        forEachWord(posX, posY, count, [&any](const uint64_t word, const uint64_t mask, size_t /*firstBit*/, size_t /*bitCount*/) {
+            any = any || (word & mask) != 0U;
+        });
+        return any;
+    }
+
+    // Number of occupied pixels in the row section starting at (posX, posY).
+    size_t countInRow(const size_t posX, const size_t posY, const size_t count) const {
+        size_t occupiedCount = 0;
+        forEachWord(posX, posY, count, [&occupiedCount](const uint64_t word, const uint64_t mask, size_t /*firstBit*/, size_t /*bitCount*/) {
+            occupiedCount += static_cast<size_t>(std::popcount(word & mask));
+        });
+        return occupiedCount;
+    }
+
+    void clearRow(const size_t posX, const size_t posY, const size_t count) {
+        forEachWord(posX, posY, count,
+                    [](uint64_t& word, const uint64_t mask, size_t /*firstBit*/, size_t /*bitCount*/) { word &= ~mask; });
+    }
+
+    // One byte per pixel (0 or 1), row after row.
+    void toBytes(std::vector<uint8_t>& bytes) const {
+        bytes.resize(size());
+        for (size_t posY = 0; posY < height_; ++posY) {
+            const uint64_t* row = &words_[posY * wordsPerRow_];
+            uint8_t* dst = &bytes[posY * width_];
+            for (size_t posX = 0; posX < width_; ++posX) {
+                dst[posX] = static_cast<uint8_t>((row[posX / wordBits] >> (posX % wordBits)) & 1U);
+            }
+        }
+    }
+
+   private:
+    static constexpr size_t wordBits = 64;
+
+    // Call 'func(word, mask, firstBit, bitCount)' for each word covered by the row section, 'mask' selecting the bits of the section.
+    template <typename Words, typename Func>
+    static void forEachWordImpl(Words& words, const size_t wordsPerRow, const size_t posX, const size_t posY, size_t count, Func&& func) {
+        size_t wordIdx = posY * wordsPerRow + posX / wordBits;
+        size_t firstBit = posX % wordBits;
+        while (count > 0) {
+            const size_t bitCount = std::min(count, wordBits - firstBit);
+            const uint64_t mask = (bitCount == wordBits ? ~uint64_t{0} : ((uint64_t{1} << bitCount) - 1)) << firstBit;
+            func(words[wordIdx], mask, firstBit, bitCount);
+            count -= bitCount;
+            firstBit = 0;
+            ++wordIdx;
+        }
+    }
+
+    template <typename Func>
+    void forEachWord(const size_t posX, const size_t posY, const size_t count, Func&& func) {
+        assert(posX + count <= width_ && posY < height_);
+        forEachWordImpl(words_, wordsPerRow_, posX, posY, count, func);
+    }
+
+    template <typename Func>
+    void forEachWord(const size_t posX, const size_t posY, const size_t count, Func&& func) const {
+        assert(posX + count <= width_ && posY < height_);
+        forEachWordImpl(words_, wordsPerRow_, posX, posY, count, func);
+    }
+
+    size_t width_ = 0;
+    size_t height_ = 0;
+    size_t wordsPerRow_ = 0;
+    std::vector<uint64_t> words_;
+};
+
+}  // namespace uvgvpcc_enc
@@ -54,7 +54,8 @@ namespace uvgvpcc_enc {
 
 namespace {
 
-std::unordered_map<std::string, ParameterInfo> parameterMap;
+// Rebuilt by initializeParameterMap() for the encoder being initialized on the calling thread.
+thread_local std::unordered_map<std::string, ParameterInfo> parameterMap;
 
 inline int toInt(const std::string& paramValue, const std::string& paramName) {
     try {
@@ -178,9 +179,11 @@ void initializeParameterMap(Parameters& param) {
         // Normal computation //
         {"normalComputationKnnCount", {UINT, "", &param.normalComputationKnnCount}},
         {"normalComputationMaxDiagonalStep", {UINT, "", &param.normalComputationMaxDiagonalStep}},
+        {"normalComputationKernel", {STRING, "auto,scalar,avx2,avx512", &param.normalComputationKernel}},
 
         // Normal orientation //
         {"normalOrientationKnnCount", {UINT, "", &param.normalOrientationKnnCount}},
+        {"normalOrientationBlockSize", {UINT, "", &param.normalOrientationBlockSize}},
 
         // PPI segmentation //
 
@@ -199,6 +202,7 @@ void initializeParameterMap(Parameters& param) {
         {"maxAllowedDist2RawPointsDetection", {UINT, "", &param.maxAllowedDist2RawPointsDetection}},
         {"minPointCountPerCC", {UINT, "", &param.minPointCountPerCC}},
         {"patchSegmentationMaxPropagationDistance", {UINT, "", &param.patchSegmentationMaxPropagationDistance}},
+        {"patchSegmentationRasterLookup", {BOOL, "", &param.patchSegmentationRasterLookup}},
         {"enablePatchSplitting", {BOOL, "", &param.enablePatchSplitting}},
         {"minLevel", {UINT, "", &param.minLevel}},
         {"log2QuantizerSizeX", {UINT, "", &param.log2QuantizerSizeX}},
@@ -212,6 +216,7 @@ void initializeParameterMap(Parameters& param) {
         {"minimumMapHeight", {UINT, "", &param.minimumMapHeight}},
         {"spacePatchPacking", {UINT, "", &param.spacePatchPacking}},
         {"interPatchPacking", {BOOL, "", &param.interPatchPacking}},
+        {"patchPackingMethod", {STRING, "firstFit,skyline", &param.patchPackingMethod}},
         {"gpaTresholdIoU", {FLOAT, "", &param.gpaTresholdIoU}},
 
         // ___ Map generation ___ //
@@ -229,6 +234,8 @@ void initializeParameterMap(Parameters& param) {
         {"sizeGOP2DEncoding", {UINT, "8,16", &param.sizeGOP2DEncoding}},
         {"intraFramePeriod", {UINT, "", &param.intraFramePeriod}},
         {"encoderInfoSEI", {BOOL, "", &param.encoderInfoSEI}},
+        {"persistent2DEncoderSessions", {BOOL, "", &param.persistent2DEncoderSessions}},
+        {"frameLevel2DEncoding", {BOOL, "", &param.frameLevel2DEncoding}},
 
 // Occupancy map
 #if LINK_FFMPEG
@@ -82,9 +82,16 @@ struct Parameters {
     // Normal computation //
     size_t normalComputationKnnCount;
     size_t normalComputationMaxDiagonalStep;
+    std::string normalComputationKernel = "auto";  // 'auto' uses the widest SIMD kernel supported by the CPU. 'scalar', 'avx2' and 'avx512'
+                                                   // force a kernel. All of them give the same normals.
 
     // Normal orientation //
     size_t normalOrientationKnnCount = 4;
+    size_t normalOrientationBlockSize = 0;  // Edge of the spatial blocks oriented in parallel, whose borders are then reconciled. The
+                                            // result differs from the propagation over the whole frame. 0 disables the blocks. No preset
+                                            // enables them. Without blocks, only the connected components of the neighbor graph are oriented
+                                            // in parallel, and a usual frame is mostly a single component, so the orientation itself then
+                                            // stays serial.
 
     // PPI segmentation //
     const std::vector<uvgutils::VectorN<double, 3>> projectionPlaneOrientations = {
@@ -109,6 +116,7 @@ struct Parameters {
     size_t maxAllowedDist2RawPointsDetection = 5;  // TODO(lf): add verification to avoid segfault because index out of bound
     size_t minPointCountPerCC;
     size_t patchSegmentationMaxPropagationDistance = 3;
+    bool patchSegmentationRasterLookup = false;  // Detect the raw points in the depth rasters of the patches instead of a hash set
     // lf : for reworked function only. If the value is 4, the euclidian distance is 16.  // TODO(lf): the default value should be 2 I
     // guess // Nop, it should be 1 // TODO(lf): make sure to use <= instead of < in the for loop so to avoid this confusion.
     bool enablePatchSplitting = true;
@@ -128,6 +136,8 @@ struct Parameters {
     // TODO(lf): lf : As Joose explain to me, in theory, it would be the height which is constant and equals to 64*nbThreads
     size_t spacePatchPacking = 1;
     bool interPatchPacking;
+    std::string patchPackingMethod = "firstFit";  // 'firstFit' scans the whole map for each patch. 'skyline' places each patch at the
+                                                  // lowest location of the map skyline. Faster, but the map holes are not filled.
     float gpaTresholdIoU = 0.3;  // global patch allocation threshold for the intersection over union process
 
     // ___ Map generation ___ //
@@ -141,9 +151,16 @@ struct Parameters {
     
     // ___ 2D encoding parameters ___ //
     size_t sizeGOP2DEncoding;
-    size_t intraFramePeriod = 64;  // TODO(lf): Not useful yet as a new 2D encoder is created for each GOF. (64 is default Kvazaar value. In
-                                   // uvgVPCCenc, the value is indirectly set by 8 or 16, depending on the size of the 2D encoding GOP)
+    size_t intraFramePeriod = 64;  // In RA mode, a new 2D encoder is opened for each GOF, so this period is bounded by the GOF size. (64 is
+                                   // default Kvazaar value. In uvgVPCCenc, the value is indirectly set by 8 or 16, depending on the size of
+                                   // the 2D encoding GOP)
     bool encoderInfoSEI = false;
+    bool persistent2DEncoderSessions = false;  // Keep the 2D encoders open from one GOF to the next when the encoding mode allows it (AI). This
+                                              // changes the AI bitstreams (POC continues across GOFs), and the GOFs of a video are then encoded
+                                              // in order. RA is not supported: in RA, the encoders are still reopened for each GOF, as a GOP
+                                              // can't span two GOFs without breaking the independent decoding of each GOF video sub-bitstream.
+    bool frameLevel2DEncoding = false;  // Send the maps of each frame to the 2D encoders as soon as they are generated, instead of waiting
+                                        // for the whole GOF. Lower the latency, especially in low-delay configurations. (Kvazaar only)
 
     // Occupancy map
     std::string occupancyEncoderName = "Kvazaar";
@@ -151,7 +168,7 @@ struct Parameters {
     std::string occupancyEncodingMode;
     std::string occupancyEncodingFormat = "YUV420";
     size_t occupancyEncodingNbThread =
-        0;  // 0 by default means that this variable will have for value during execution the actual number of detected threads
+        0;  // 0 by default means that this variable will have for value during execution a share of the actual number of detected threads
     size_t occupancyMapDSResolution;  // 'Rate' or 'qp' for the occupancy map
     std::string occupancyEncodingPreset;
     size_t omRefinementTreshold2;
@@ -166,7 +183,7 @@ struct Parameters {
     std::string geometryEncodingMode;
     std::string geometryEncodingFormat = "YUV420";
     size_t geometryEncodingNbThread =
-        0;  // 0 by default means that this variable will have for value during execution the actual number of detected threads
+        0;  // 0 by default means that this variable will have for value during execution a share of the actual number of detected threads
     size_t geometryEncodingQp;
     std::string geometryEncodingPreset;
     std::string geometryFFmpegCodecName;  // Name of the codec as specified in ffmpeg documentation
@@ -179,7 +196,7 @@ struct Parameters {
     std::string attributeEncodingMode;
     std::string attributeEncodingFormat = "YUV420";
     size_t attributeEncodingNbThread =
-        0;  // 0 by default means that this variable will have for value during execution the actual number of detected threads
+        0;  // 0 by default means that this variable will have for value during execution a share of the actual number of detected threads
     size_t attributeEncodingQp;
     std::string attributeEncodingPreset;
     std::string attributeFFmpegCodecName;  // Name of the codec as specified in ffmpeg documentation
@@ -278,7 +295,16 @@ struct ParameterInfo {
     }
 };
 
-extern const Parameters* p_;  // Const pointer to a non-const Parameter struct instance in parameters.cpp
+// 'p_' is read in most hot loops of the library. 'constinit' removes the thread_local initialization guard from every access, and the
+// initial-exec model turns each access into a single thread pointer relative load instead of a call to __tls_get_addr.
+#ifdef __GNUC__
+#define UVGVPCC_TLS_MODEL __attribute__((tls_model("initial-exec")))
+#else
+#define UVGVPCC_TLS_MODEL
+#endif
+
+// Const pointer to the parameters of the encoder running on the current thread (c.f. EncoderContextScope in encoderContext.hpp)
+extern thread_local constinit const Parameters* p_ UVGVPCC_TLS_MODEL;
 
 void initializeParameterMap(Parameters& param);
 void setParameterValue(const std::string& parameterName, const std::string& parameterValue, const bool& fromPreset);
@@ -32,6 +32,10 @@
 
 
 #include "statsCollector.hpp"
+
+#include <utility>
+
+#include "encoderContext.hpp"
 #include "parameters.hpp"
 
 using namespace uvgvpcc_enc;
@@ -84,6 +88,36 @@ void StatsCollector::collectData(size_t frameId, DataId id, size_t data) {
     } 
 }
 
+void LocalStats::merge(const LocalStats& other) {
+    for (size_t iter = 0; iter < other.counters_.size(); ++iter) {
+        for (size_t id = 0; id < dataIdCount; ++id) {
+            counters_[iter][id] += other.counters_[iter][id];
+        }
+    }
+}
+
+void StatsCollector::merge(size_t frameId, const LocalStats& localStats) {
+    auto& s = stats_[frameId];
+    const std::array<std::pair<DataId, std::vector<size_t>*>, 11> iterationCounters = {{
+        {DataId::SkippedVoxels,     &s.skippedVoxels},
+        {DataId::ScoreComputations, &s.scoreComputations},
+        {DataId::NoEdge,            &s.NoEdge},
+        {DataId::IndirectEdge,      &s.IndirectEdge},
+        {DataId::SingleEdge,        &s.SingleEdge},
+        {DataId::MultiEdge,         &s.MultiEdge},
+        {DataId::NoEdge_R,          &s.NoEdge_R},
+        {DataId::IndirectEdge_R,    &s.IndirectEdge_R},
+        {DataId::SingleEdge_R,      &s.SingleEdge_R},
+        {DataId::MultiEdge_R,       &s.MultiEdge_R},
+        {DataId::PpiChange,         &s.ppiChange},
+    }};
+    for (const auto& [id, counters] : iterationCounters) {
+        for (size_t iter = 0; iter < localStats.iterationCount(); ++iter) {
+            (*counters)[iter] += localStats.get(id, iter);
+        }
+    }
+}
+
 static void removeJsonFooter(const std::string& filename) {
     std::ifstream in(filename);
     if (!in.is_open()) return;
@@ -209,4 +243,4 @@ void StatsCollector::writeToFile(const std::string& filename, const size_t gofId
     out.close();
 }
 
-StatsCollector& stats = StatsCollector::instance();
\ No newline at end of file
+StatsCollector& StatsCollector::instance() { return currentContext->stats; }
\ No newline at end of file
@@ -31,6 +31,7 @@
  ****************************************************************************/
 
  #pragma once
+#include <array>
 #include <fstream>
 #include <mutex>
 #include <string>
@@ -56,6 +57,7 @@ enum class DataId {
     NumberOfPatches,
     NumberOfLostPoints
 };
+constexpr size_t dataIdCount = static_cast<size_t>(DataId::NumberOfLostPoints) + 1;
 
 struct uvgVPCCencStats {
         /*--------- General ---------*/
@@ -95,23 +97,34 @@ struct uvgVPCCencStats {
     size_t numberOfLostPoints; // due to oclusion
 };
 
+// Per-iteration counters of one frame, filled by a single job (or by a single chunk of a parallel loop) without any synchronization. They
+// are merged together, then in the StatsCollector once per frame, so that the statistics cost a few additions in the hot loops.
+class LocalStats {
+public:
+    explicit LocalStats(size_t iterationCount = 0) : counters_(iterationCount) {}
+
+    void add(DataId id, size_t iteration, size_t count = 1) { counters_[iteration][static_cast<size_t>(id)] += count; }
+    void merge(const LocalStats& other);
+    size_t get(DataId id, size_t iteration) const { return counters_[iteration][static_cast<size_t>(id)]; }
+    size_t iterationCount() const { return counters_.size(); }
+
+private:
+    std::vector<std::array<size_t, dataIdCount>> counters_;
+};
+
 class StatsCollector {
 public:
     std::vector<uvgVPCCencStats> stats_;
-    static StatsCollector& instance() {
-        static StatsCollector instance;
-        return instance;
-    }
+    // Statistics of the encoder running on the current thread
+    static StatsCollector& instance();
 
     void init(std::size_t nbFrames);
 
     void collectData(size_t frameId, DataId id, size_t data);   
 
+    // Add the per-iteration counters of a frame, accumulated locally by a job
+    void merge(size_t frameId, const LocalStats& localStats);
+
     // Export
     void writeToFile(const std::string& filename, const size_t gofId) const;
-
-private:
-    StatsCollector() = default;
 };
-
-extern StatsCollector& stats;
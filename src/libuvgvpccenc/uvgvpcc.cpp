@@ -35,6 +35,7 @@
 #include "uvgvpcc/uvgvpcc.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <cstdlib>
@@ -51,12 +52,15 @@
 #include <vector>
 
 #include "bitstreamGeneration/bitstreamGeneration.hpp"
+#include "mapEncoding/abstract2DMapEncoder.hpp"
 #include "mapEncoding/mapEncoding.hpp"
 #include "mapGeneration/mapGeneration.hpp"
+#include "patchGeneration/normalComputation.hpp"
 #include "patchGeneration/patchGeneration.hpp"
 #include "patchGeneration/utilsPatchGeneration.hpp"
 #include "patchPacking/patchPacking.hpp"
 #include "utils/constants.hpp"
+#include "utils/encoderContext.hpp"
 #include "utils/fileExport.hpp"
 #include "utils/parameters.hpp"
 #include "utils/preset.hpp"
@@ -68,12 +72,8 @@ namespace uvgvpcc_enc {
 
 namespace {
 
-Parameters param;
-// Map storing all parameters intending to change the state of the encoder from outside of the library.
-CommonMemory commonMemory;
-std::unordered_map<std::string, std::string> apiInputParameters;
-bool errorInAPI = false;
-bool initializationDone = false;
+// Context of the encoder behind the free API functions. It is also the context of any thread not running an encoder job.
+EncoderContext defaultContext;
 
 void createDirectory(const std::string& path) {
     std::filesystem::path dirPath(path);
@@ -88,13 +88,6 @@ void createDirectory(const std::string& path) {
     }
 }
 
-struct ThreadHandler {
-    size_t gofId;
-    std::shared_ptr<GOF> currentGOF;
-};
-
-ThreadHandler g_threadHandler;
-
 void initializeStaticParameters() {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("API", "Initialize static parameters.\n");
     // Job::setExecutionMethod(p_->timerLog);
@@ -132,6 +125,18 @@ void verifyConfig() {
 #endif
     }
 
+    if (p_->frameLevel2DEncoding &&
+        (p_->occupancyEncoderName != "Kvazaar" || p_->geometryEncoderName != "Kvazaar" || p_->attributeEncoderName != "Kvazaar")) {
+        throw std::runtime_error("The parameter 'frameLevel2DEncoding' is only supported by the 2D encoder 'Kvazaar'.");
+    }
+
+    const std::string normalKernel = NormalComputation::resolveKernel(p_->normalComputationKernel);
+    if (normalKernel.empty()) {
+        throw std::runtime_error("The parameter 'normalComputationKernel' has been set to '" + p_->normalComputationKernel +
+                                 "', which is not supported by this CPU or by this build. Use 'auto' to select the kernel automatically.");
+    }
+    uvgutils::Logger::log<uvgutils::LogLevel::DEBUG>("VERIFY CONFIG", "The normal computation uses the '" + normalKernel + "' kernel.\n");
+
     if (p_->sizeGOF > p_->maxConcurrentFrames) {
         throw std::runtime_error("The parameter 'maxConcurrentFrames' (" + std::to_string(p_->maxConcurrentFrames) +
                                  ") is lower than the parameter 'sizeGOF' (" + std::to_string(p_->sizeGOF) +
@@ -223,9 +228,9 @@ void verifyConfig() {
     if (p_->intraFramePeriod != 64) {
         uvgutils::Logger::log<uvgutils::LogLevel::WARNING>(
             "VERIFY CONFIG",
-            "It seems that you are modifying the parameter 'intraFramePeriod'. Currently, one Kvazaar instance is spawn for each uvgVPCCenc "
-            "GOF. Thus, the intraFramePeriod parameter is indirectly constrained and will have no impact if set to a value higher than the "
-            "GOF size.\n");
+            "It seems that you are modifying the parameter 'intraFramePeriod'. In RA mode, a new Kvazaar encoder is opened for each "
+            "uvgVPCCenc GOF so that each GOF can be decoded independently. Thus, the intraFramePeriod parameter is indirectly constrained and "
+            "will have no impact if set to a value higher than the GOF size.\n");
     }
 
     if (p_->intraFramePeriod % p_->sizeGOP2DEncoding != 0) {
@@ -288,7 +293,7 @@ void verifyConfig() {
 
 }
 
-void setInputGeoPrecision() {
+void setInputGeoPrecision(const std::unordered_map<std::string, std::string>& apiInputParameters) {
     auto geoBitDepthInputIt = apiInputParameters.find("geoBitDepthInput");
     if (geoBitDepthInputIt == apiInputParameters.end()) {
         throw std::runtime_error("The parameter 'geoBitDepthInput' has to be defined.");
@@ -300,7 +305,8 @@ void setInputGeoPrecision() {
                                                     "The geoBitDepthInput is set to '" + std::to_string(p_->geoBitDepthInput) + "'.\n");
 }
 
-void setPreset() {
+void setPreset(EncoderContext& context) {
+    const auto& apiInputParameters = context.apiInputParameters;
     auto presetNameIt = apiInputParameters.find("presetName");
     if (presetNameIt != apiInputParameters.end()) {  // presetName has been defined by the application
         setParameterValue("presetName", presetNameIt->second, false);
@@ -309,10 +315,10 @@ void setPreset() {
         setParameterValue("presetName", "fast", false);
         uvgutils::Logger::log<uvgutils::LogLevel::INFO>("API", "The presetName is set by default to '" + p_->presetName + "'.\n");
     }
-    applyPreset(param);
+    applyPreset(context.param);
 }
 
-void setRate() {
+void setRate(const std::unordered_map<std::string, std::string>& apiInputParameters) {
     auto rateIt = apiInputParameters.find("rate");
     if (rateIt != apiInputParameters.end()) {  // rate has been defined by the application
         // Here is the expected format: rate=[geometryQP]-[attributeQP]-[occupancyResolution] c.f. ctc rate config files in TMC2
@@ -350,7 +356,7 @@ void setRate() {
     }
 }
 
-void setLogParameters() {
+void setLogParameters(const std::unordered_map<std::string, std::string>& apiInputParameters) {
     bool defaultErrorsAreFatalValue;
     auto errorsAreFatalIt = apiInputParameters.find("errorsAreFatal");
     if (errorsAreFatalIt != apiInputParameters.end()) {  // errorsAreFatal has been defined by the application
@@ -382,7 +388,7 @@ void setLogParameters() {
     }
 }
 
-void setMode() {
+void setMode(const std::unordered_map<std::string, std::string>& apiInputParameters) {
     std::string modeValue;
     auto modeIt = apiInputParameters.find("mode");
     if (modeIt != apiInputParameters.end()) {  // mode has been defined by the application
@@ -430,16 +436,16 @@ void updateParametersForSlicing(const size_t distLUT, const double lambda, const
 }
 
 // TODO(lf)check in debug mode for example if rate and occupancyMapDSResolution are both in the lib command line TODO(lf)a warning
-void parseUvgvpccParameters() {
+void parseUvgvpccParameters(EncoderContext& context) {
     // Special parameters need to be handle first
-    setLogParameters();
-    setInputGeoPrecision();
-    setPreset();
-    setRate();
-    setMode();
+    setLogParameters(context.apiInputParameters);
+    setInputGeoPrecision(context.apiInputParameters);
+    setPreset(context);
+    setRate(context.apiInputParameters);
+    setMode(context.apiInputParameters);
 
     // Now that the preset is applied, all other parameters set by the application can overwrite the preset values.
-    for (const auto& paramPair : apiInputParameters) {
+    for (const auto& paramPair : context.apiInputParameters) {
         if (paramPair.first == "presetName" || paramPair.first == "geoBitDepthInput" || paramPair.first == "rate" ||
             paramPair.first == "logLevel" || paramPair.first == "errorsAreFatal" || paramPair.first == "mode") {
             // Those parameters have been handled at the top of this function
@@ -453,13 +459,15 @@ void parseUvgvpccParameters() {
                                    p_->slicingRefineSegmentationLambda, p_->slicingRefineSegmentationIterationCount);
     }
 
-    const std::string detectedThreadNumber = std::to_string(std::thread::hardware_concurrency());
+    // The detected number of threads is read once. The default thread counts of the point cloud part and of the three 2D encoders are all
+    // derived from it.
+    const size_t hardwareThreads = std::max(1U, std::thread::hardware_concurrency());
     if (p_->nbThreadPCPart == 0) {
         uvgutils::Logger::log<uvgutils::LogLevel::INFO>("API",
                                                         "'nbThreadPCPart' is set to 0. The number of thread used for the Point Cloud "
                                                         "part of uvgVPCC is then the detected number of threads: " +
-                                                            detectedThreadNumber + "\n");
-        setParameterValue("nbThreadPCPart", detectedThreadNumber, false);
+                                                            std::to_string(hardwareThreads) + "\n");
+        setParameterValue("nbThreadPCPart", std::to_string(hardwareThreads), false);
     }
     if (p_->maxConcurrentFrames == 0) {
         uvgutils::Logger::log<uvgutils::LogLevel::INFO>("API",
@@ -468,26 +476,30 @@ void parseUvgvpccParameters() {
                                                             std::to_string(4 * p_->sizeGOF) + "\n");
         setParameterValue("maxConcurrentFrames", std::to_string(4 * p_->sizeGOF), false);
     }
+    // The three videos are encoded concurrently, so the detected threads are split between the 2D encoders instead of being all given to
+    // each of them. The downscaled occupancy video is much lighter than the two others, hence its smaller share.
+    const size_t occupancyThreadShare = std::max<size_t>(1, hardwareThreads / 8);
+    const size_t videoThreadShare = std::max<size_t>(1, (hardwareThreads - occupancyThreadShare) / 2);
     if (p_->occupancyEncodingNbThread == 0) {
         uvgutils::Logger::log<uvgutils::LogLevel::DEBUG>("API",
                                                          "'occupancyEncodingNbThread' is set to 0. The number of thread used for the "
-                                                         "occcupancy video 2D encoding is then the detected number of threads: " +
-                                                             detectedThreadNumber + "\n");
-        setParameterValue("occupancyEncodingNbThread", detectedThreadNumber, false);
+                                                         "occcupancy video 2D encoding is then its share of the detected threads: " +
+                                                             std::to_string(occupancyThreadShare) + "\n");
+        setParameterValue("occupancyEncodingNbThread", std::to_string(occupancyThreadShare), false);
     }
     if (p_->geometryEncodingNbThread == 0) {
         uvgutils::Logger::log<uvgutils::LogLevel::DEBUG>("API",
                                                          "'geometryEncodingNbThread' is set to 0. The number of thread used for the "
-                                                         "geometry video 2D encoding is then the detected number of threads: " +
-                                                             detectedThreadNumber + "\n");
-        setParameterValue("geometryEncodingNbThread", detectedThreadNumber, false);
+                                                         "geometry video 2D encoding is then its share of the detected threads: " +
+                                                             std::to_string(videoThreadShare) + "\n");
+        setParameterValue("geometryEncodingNbThread", std::to_string(videoThreadShare), false);
     }
     if (p_->attributeEncodingNbThread == 0) {
         uvgutils::Logger::log<uvgutils::LogLevel::DEBUG>("API",
                                                          "'attributeEncodingNbThread' is set to 0. The number of thread used for the "
-                                                         "attribute video 2D encoding is then the detected number of threads: " +
-                                                             detectedThreadNumber + "\n");
-        setParameterValue("attributeEncodingNbThread", detectedThreadNumber, false);
+                                                         "attribute video 2D encoding is then its share of the detected threads: " +
+                                                             std::to_string(videoThreadShare) + "\n");
+        setParameterValue("attributeEncodingNbThread", std::to_string(videoThreadShare), false);
     }
 
     if (p_->exportIntermediateFiles && p_->intermediateFilesDirTimeStamp) {
@@ -511,15 +523,34 @@ void parseUvgvpccParameters() {
     }
 }
 
-static void initializeContext() {
+void initializeContext(EncoderContext& context) {
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("API", "Initialize context.\n");
-    uvgutils::JobManager::initThreadQueue(p_->nbThreadPCPart);
-    g_threadHandler.gofId = 0;
+    const size_t threadCount = uvgutils::JobManager::acquireThreadQueue(p_->nbThreadPCPart);
+    context.threadQueueAcquired = true;
+    if (threadCount != p_->nbThreadPCPart) {
+        uvgutils::Logger::log<uvgutils::LogLevel::WARNING>(
+            "API", "The thread pool shared by the encoder instances has already been spawned by another instance, with " +
+                       std::to_string(threadCount) + " threads. 'nbThreadPCPart' (" + std::to_string(p_->nbThreadPCPart) +
+                       ") is ignored for this instance.\n");
+    }
+    context.gofId = 0;
+    context.conccurentFrameSem =
+        std::make_shared<std::counting_semaphore<UINT16_MAX>>(std::min(p_->maxConcurrentFrames, size_t(UINT16_MAX)));
+
+    // Every job of this encoder runs with the encoder context set on the worker thread.
+    context.jobManager.jobWrapper = [contextPtr = &context](const uvgutils::Job::JobFunction& task) {
+        const EncoderContextScope scope(contextPtr);
+        task();
+    };
 }
 
 }  // anonymous namespace
 
-const Parameters* p_ = &param;
+thread_local constinit EncoderContext* currentContext UVGVPCC_TLS_MODEL = &defaultContext;
+thread_local constinit const Parameters* p_ UVGVPCC_TLS_MODEL = &defaultContext.param;
+
+EncoderContext::EncoderContext() : commonMemory(std::make_shared<CommonMemory>()) {}
+EncoderContext::~EncoderContext() = default;
 
 void Frame::printInfo() const {
     // lf: I removed all information accessed through pointers to avoid issues when the pointers are not initialized.
@@ -530,8 +561,8 @@ void Frame::printInfo() const {
 
 }
 
-GOF::GOF(const size_t& id) : gofId(id) {
-    auto& cm = CommonMemory::get();
+GOF::GOF(const size_t& id) : gofId(id), commonMemory(currentContext->commonMemory) {
+    auto& cm = *commonMemory;
     framePatches         = cm.getOrCreateFramePatches        (gofId);
     frameOccupancyMaps   = cm.getOrCreateFrameOccupancyMaps  (gofId);
     frameOccupancyMapsDS = cm.getOrCreateFrameOccupancyMapsDS(gofId);
@@ -555,33 +586,35 @@ void GOF::setFrameMemoryPtrs(std::shared_ptr<Frame>& frame) {
 }
 
 GOF::~GOF() {
-    CommonMemory::get().clearGofMaps(gofId);
+    commonMemory->clearGofMaps(gofId);
 }
 
 /// @brief Create the context of the uvgVPCCenc encoder. Parse the input parameters and verify if the given configuration is valid. Initialize
 /// static parameters and function pointers.
-void API::initializeEncoder() {
+void API::Encoder::initializeEncoder() {
+    const EncoderContextScope scope(context_);
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("API", "Initialize the encoder.\n");
-    uvgvpcc_enc::initializeParameterMap(param);
-    parseUvgvpccParameters();
-    if (errorInAPI && p_->errorsAreFatal)
+    uvgvpcc_enc::initializeParameterMap(context_->param);
+    parseUvgvpccParameters(*context_);
+    if (context_->errorInAPI && p_->errorsAreFatal)
         throw std::runtime_error(
             "An error occured while handling application input parameters. If you want to not stop the execution of the program when an "
             "error is detected, set the parameter 'errorsAreFatal' to 'False'.");
     verifyConfig();
     initializeStaticParameters();
     initializeStaticFunctionPointers();
-    initializeContext();
+    initializeContext(*context_);
     if (p_->exportIntermediateFiles && !p_->intermediateFilesDirTimeStamp) FileExport::cleanIntermediateFiles();
-    initializationDone = true;
+    context_->initializationDone = true;
 }
 
 /// @brief The only way to modify the exposed uvgVPCCenc parameters is by calling this function.
 /// @param parameterName Name of the parameter. All exposed parameters are listed in the object parameterMap defined in
 /// lib/utils/parameters.cpp
 /// @param parameterValue The value of the parameter written as a string.
-void API::setParameter(const std::string& parameterName, const std::string& parameterValue) {
-    if (initializationDone) {
+void API::Encoder::setParameter(const std::string& parameterName, const std::string& parameterValue) {
+    auto& apiInputParameters = context_->apiInputParameters;
+    if (context_->initializationDone) {
         uvgutils::Logger::log<uvgutils::LogLevel::FATAL>(
             "API", "The API function 'setParameter' can't be called after the API function 'initializeEncoder'.\n");
         throw std::runtime_error("");
@@ -590,7 +623,7 @@ void API::setParameter(const std::string& parameterName, const std::string& para
         uvgutils::Logger::log<uvgutils::LogLevel::ERROR>("API", "The parameter '" + parameterName +
                                                                     "' has already been set. The value used is: '" +
                                                                     apiInputParameters.at(parameterName) + "'.\n");
-        errorInAPI = true;
+        context_->errorInAPI = true;
     }
     apiInputParameters.emplace(parameterName, parameterValue);
 }
@@ -599,90 +632,180 @@ void API::setParameter(const std::string& parameterName, const std::string& para
 /// handles the GOF processing.
 /// @param frame uvgvpcc_enc::Frame
 /// @param output GOF bitstream
-void API::encodeFrame(std::shared_ptr<Frame>& frame, v3c_unit_stream* output) {
-    static std::shared_ptr<std::counting_semaphore<UINT16_MAX>> conccurentFrameSem =
-        std::make_shared<std::counting_semaphore<UINT16_MAX>>(std::min(p_->maxConcurrentFrames, size_t(UINT16_MAX)));
+void API::Encoder::encodeFrame(std::shared_ptr<Frame>& frame, v3c_unit_stream* output) {
+    const EncoderContextScope scope(context_);
+    auto& jobManager = context_->jobManager;
+    std::shared_ptr<GOF>& currentGOF = context_->currentGOF;
 
-    conccurentFrameSem->acquire();
-    frame->conccurentFrameSem = conccurentFrameSem;
+    context_->conccurentFrameSem->acquire();
+    frame->conccurentFrameSem = context_->conccurentFrameSem;
 
     uvgutils::Logger::log<uvgutils::LogLevel::TRACE>("API", "Encoding frame " + std::to_string(frame->frameId) + "\n");
     if (frame == nullptr) {
         uvgutils::Logger::log<uvgutils::LogLevel::ERROR>("API", "The frame is null.\n");
         if (p_->errorsAreFatal) throw std::runtime_error("");
     }
+    frame->mapHeight = p_->minimumMapHeight;
+    frame->mapHeightDS = p_->minimumMapHeight / p_->occupancyMapDSResolution;
     std::shared_ptr<uvgutils::Job> initGOFMG = nullptr;
-    std::shared_ptr<uvgutils::Job> encodeGOF = nullptr;
+    // One job per video (occupancy, geometry, attribute), so that the three 2D encoders run concurrently.
+    std::array<std::shared_ptr<uvgutils::Job>, 3> encodeGOF;
+    const std::array<std::string, 3> encodeGOFNames = {TO_STRING(MapEncoding::encodeGOFOccupancyMaps),
+                                                       TO_STRING(MapEncoding::encodeGOFGeometryMaps),
+                                                       TO_STRING(MapEncoding::encodeGOFAttributeMaps)};
+    const std::array<const Abstract2DMapEncoder*, 3> mapEncoders = {
+        context_->occupancyMapDSEncoder.get(), context_->geometryMapEncoder.get(), context_->attributeMapEncoder.get()};
 
     if (frame->frameId % p_->sizeGOF == 0) {
         // The current frame is the first of its GOF. Create all GOF related jobs.
-        g_threadHandler.currentGOF = std::make_shared<GOF>(g_threadHandler.gofId++);
-        g_threadHandler.currentGOF->nbFrames = 0;
-        g_threadHandler.currentGOF->mapHeightGOF = p_->minimumMapHeight;
-        g_threadHandler.currentGOF->mapHeightDSGOF = p_->minimumMapHeight / p_->occupancyMapDSResolution;
+        currentGOF = std::make_shared<GOF>(context_->gofId++);
+        currentGOF->nbFrames = 0;
+        currentGOF->mapHeightGOF = p_->minimumMapHeight;
+        currentGOF->mapHeightDSGOF = p_->minimumMapHeight / p_->occupancyMapDSResolution;
         std::shared_ptr<uvgutils::Job> ppJob = nullptr;
         if (p_->interPatchPacking) {
-            ppJob = JOBG(g_threadHandler.currentGOF->gofId, 3, PatchPacking::gofPatchPacking, g_threadHandler.currentGOF);
+            ppJob = JOBG(jobManager, currentGOF->gofId, 3, PatchPacking::gofPatchPacking, currentGOF);
             // TODO(lf): add a new priority level ?
         }
-        initGOFMG = JOBG(g_threadHandler.currentGOF->gofId, 3, MapGeneration::initGOFMapGeneration, g_threadHandler.currentGOF);
-        encodeGOF = JOBG(g_threadHandler.currentGOF->gofId, 5, MapEncoding::encodeGOFMaps, g_threadHandler.currentGOF);
+        initGOFMG = JOBG(jobManager, currentGOF->gofId, 3, MapGeneration::initGOFMapGeneration, currentGOF);
+        encodeGOF = {JOBG(jobManager, currentGOF->gofId, 5, MapEncoding::encodeGOFOccupancyMaps, currentGOF),
+                     JOBG(jobManager, currentGOF->gofId, 5, MapEncoding::encodeGOFGeometryMaps, currentGOF),
+                     JOBG(jobManager, currentGOF->gofId, 5, MapEncoding::encodeGOFAttributeMaps, currentGOF)};
         auto bsJob =
-            JOBG(g_threadHandler.currentGOF->gofId, 5, BitstreamGeneration::createV3CGOFBitstream, g_threadHandler.currentGOF, *(p_), output);
+            JOBG(jobManager, currentGOF->gofId, 5, BitstreamGeneration::createV3CGOFBitstream, currentGOF, *(p_), output);
 
         if (p_->interPatchPacking) {
             initGOFMG->addDependency(ppJob);
         }
-        encodeGOF->addDependency(initGOFMG);
-        bsJob->addDependency(encodeGOF);
-        if (g_threadHandler.currentGOF->gofId > 0) {
+        for (const auto& encodeJob : encodeGOF) {
+            encodeJob->addDependency(initGOFMG);
+            bsJob->addDependency(encodeJob);
+        }
+        if (currentGOF->gofId > 0) {
             bsJob->addDependency(
-                uvgutils::JobManager::getJob(g_threadHandler.currentGOF->gofId - 1, TO_STRING(BitstreamGeneration::createV3CGOFBitstream)));
+                jobManager.getJob(currentGOF->gofId - 1, TO_STRING(BitstreamGeneration::createV3CGOFBitstream)));
+            // A 2D encoder keeping its state across GOFs continues the video of the previous GOF, so the GOFs of this video are encoded in
+            // order (c.f. parameter 'persistent2DEncoderSessions').
+            for (size_t video = 0; video < encodeGOF.size(); ++video) {
+                if (mapEncoders[video]->keepsStateAcrossGOFs()) {
+                    encodeGOF[video]->addDependency(jobManager.getJob(currentGOF->gofId - 1, encodeGOFNames[video]));
+                }
+            }
         }
     } else {
-        initGOFMG = uvgutils::JobManager::getJob(g_threadHandler.currentGOF->gofId, TO_STRING(MapGeneration::initGOFMapGeneration));
-        encodeGOF = uvgutils::JobManager::getJob(g_threadHandler.currentGOF->gofId, TO_STRING(MapEncoding::encodeGOFMaps));
+        initGOFMG = jobManager.getJob(currentGOF->gofId, TO_STRING(MapGeneration::initGOFMapGeneration));
+        encodeGOF = {jobManager.getJob(currentGOF->gofId, encodeGOFNames[0]), jobManager.getJob(currentGOF->gofId, encodeGOFNames[1]),
+                     jobManager.getJob(currentGOF->gofId, encodeGOFNames[2])};
     }
 
-    g_threadHandler.currentGOF->frames.push_back(frame);
-    g_threadHandler.currentGOF->nbFrames++;
-    frame->gof = g_threadHandler.currentGOF;
-    frame->gofId = g_threadHandler.currentGOF->gofId;
-    g_threadHandler.currentGOF->setFrameMemoryPtrs(frame);
+    currentGOF->frames.push_back(frame);
+    currentGOF->nbFrames++;
+    frame->gof = currentGOF;
+    frame->gofId = currentGOF->gofId;
+    currentGOF->setFrameMemoryPtrs(frame);
 
-    auto patchGen = JOBF(g_threadHandler.currentGOF->gofId, frame->frameId, 0, PatchGeneration::generateFramePatches, frame);
+    auto patchGen = JOBF(jobManager, currentGOF->gofId, frame->frameId, 0, PatchGeneration::generateFramePatches, frame);
 
     if (p_->interPatchPacking) {
-        uvgutils::JobManager::getJob(g_threadHandler.currentGOF->gofId, TO_STRING(PatchPacking::gofPatchPacking))->addDependency(patchGen);
+        jobManager.getJob(currentGOF->gofId, TO_STRING(PatchPacking::gofPatchPacking))->addDependency(patchGen);
     } else {
-        auto patchPack = JOBF(g_threadHandler.currentGOF->gofId, frame->frameId, 1, PatchPacking::frameIntraPatchPacking, frame, nullptr);
+        auto patchPack = JOBF(jobManager, currentGOF->gofId, frame->frameId, 1, PatchPacking::frameIntraPatchPacking, frame, nullptr);
 
         patchPack->addDependency(patchGen);
         initGOFMG->addDependency(patchPack);
     }
 
-    auto mapGen = JOBF(g_threadHandler.currentGOF->gofId, frame->frameId, 4, MapGeneration::generateFrameMaps, frame);
+    auto mapGen = JOBF(jobManager, currentGOF->gofId, frame->frameId, 4, MapGeneration::generateFrameMaps, frame);
 
     mapGen->addDependency(initGOFMG);
-    encodeGOF->addDependency(mapGen);
+    if (p_->frameLevel2DEncoding) {
+        // The maps of this frame are sent to the 2D encoders as soon as they are generated. Within a GOF, the frames are sent in order, so
+        // each frame encoding job depends on the one of the previous frame. The GOF encoding jobs only complete the videos.
+        const std::array<std::shared_ptr<uvgutils::Job>, 3> encodeFrame = {
+            JOBF(jobManager, currentGOF->gofId, frame->frameId, 5, MapEncoding::encodeFrameOccupancyMaps, frame),
+            JOBF(jobManager, currentGOF->gofId, frame->frameId, 5, MapEncoding::encodeFrameGeometryMaps, frame),
+            JOBF(jobManager, currentGOF->gofId, frame->frameId, 5, MapEncoding::encodeFrameAttributeMaps, frame)};
+        const std::array<std::string, 3> encodeFrameNames = {TO_STRING(MapEncoding::encodeFrameOccupancyMaps),
+                                                             TO_STRING(MapEncoding::encodeFrameGeometryMaps),
+                                                             TO_STRING(MapEncoding::encodeFrameAttributeMaps)};
+        for (size_t video = 0; video < encodeFrame.size(); ++video) {
+            encodeFrame[video]->addDependency(mapGen);
+            if (currentGOF->nbFrames > 1) {
+                encodeFrame[video]->addDependency(jobManager.getJob(currentGOF->gofId, frame->frameId - 1, encodeFrameNames[video]));
+            } else if (currentGOF->gofId > 0 && mapEncoders[video]->keepsStateAcrossGOFs()) {
+                // The first frame takes over the session of the previous GOF once its video is complete.
+                encodeFrame[video]->addDependency(jobManager.getJob(currentGOF->gofId - 1, encodeGOFNames[video]));
+            }
+            encodeGOF[video]->addDependency(encodeFrame[video]);
+        }
+    } else {
+        for (const auto& encodeJob : encodeGOF) {
+            encodeJob->addDependency(mapGen);
+        }
+    }
 
-    uvgutils::JobManager::submitCurrentFrameJobs();
-    if (g_threadHandler.currentGOF->nbFrames == p_->sizeGOF) {
-        uvgutils::JobManager::submitCurrentGOFJobs();
+    jobManager.submitCurrentFrameJobs();
+    if (currentGOF->nbFrames == p_->sizeGOF) {
+        jobManager.submitCurrentGOFJobs();
     }
 }
 
 /// @brief This function is called when all frames to be processed have been sent to the encoder. Wait for all remaining jobs to be executed.
-void API::emptyFrameQueue() {
-    if (g_threadHandler.currentGOF != nullptr) {
-        if (g_threadHandler.currentGOF->nbFrames < p_->sizeGOF) {
-            uvgutils::JobManager::submitCurrentGOFJobs();
+void API::Encoder::emptyFrameQueue() {
+    const EncoderContextScope scope(context_);
+    auto& jobManager = context_->jobManager;
+    const std::shared_ptr<GOF>& currentGOF = context_->currentGOF;
+    if (currentGOF != nullptr) {
+        if (currentGOF->nbFrames < p_->sizeGOF) {
+            jobManager.submitCurrentGOFJobs();
         }
         uvgutils::JobManager::threadQueue->waitForJob(
-            uvgutils::JobManager::getJob(g_threadHandler.currentGOF->gofId, TO_STRING(BitstreamGeneration::createV3CGOFBitstream)));
+            jobManager.getJob(currentGOF->gofId, TO_STRING(BitstreamGeneration::createV3CGOFBitstream)));
+        // All the jobs of this encoder are done. A second call has nothing left to wait for.
+        context_->currentGOF.reset();
     }
 }
 
-/// @brief Insure a proper end of the encoder execution.
-void API::stopEncoder() { uvgutils::JobManager::threadQueue->stop(); }
+/// @brief Insure a proper end of the encoder execution. Wait for the remaining jobs of this encoder, then release the thread pool shared by
+/// all encoder instances. The thread pool is stopped once the last instance has released it. Called by the destructor if needed.
+void API::Encoder::stopEncoder() {
+    if (!context_->threadQueueAcquired) {
+        return;
+    }
+    emptyFrameQueue();
+    context_->threadQueueAcquired = false;
+    uvgutils::JobManager::releaseThreadQueue();
+}
+
+const Parameters& API::Encoder::getParameters() const { return context_->param; }
+
+/// @brief Allocate the statistics containers of this encoder (c.f. parameter 'exportStatistics').
+void API::Encoder::initializeStatistics(size_t nbFrames) {
+    const EncoderContextScope scope(context_);
+    context_->stats.init(nbFrames);
+}
+
+API::Encoder::Encoder() : ownedContext_(std::make_unique<EncoderContext>()), context_(ownedContext_.get()) {}
+
+API::Encoder::Encoder(EncoderContext* context) : context_(context) {}
+
+// The queued jobs of this encoder use its context, so they must be done before the context is released.
+API::Encoder::~Encoder() { stopEncoder(); }
+
+API::Encoder& API::defaultEncoder() {
+    static Encoder encoder(&defaultContext);
+    return encoder;
+}
+
+void API::initializeEncoder() { defaultEncoder().initializeEncoder(); }
+
+void API::setParameter(const std::string& parameterName, const std::string& parameterValue) {
+    defaultEncoder().setParameter(parameterName, parameterValue);
+}
+
+void API::encodeFrame(std::shared_ptr<Frame>& frame, v3c_unit_stream* output) { defaultEncoder().encodeFrame(frame, output); }
+
+void API::emptyFrameQueue() { defaultEncoder().emptyFrameQueue(); }
+
+void API::stopEncoder() { defaultEncoder().stopEncoder(); }
 }  // namespace uvgvpcc_enc
@@ -24,7 +24,7 @@ file(MAKE_DIRECTORY ${TEST_OUTPUT_BITSTREAM_DIR})
 message(STATUS "Defining tests in generate_quick_tests.cmake")
 
 # Test configurations
-set(TEST_CONFIGURATIONS default slicing efficientMapGen)
+set(TEST_CONFIGURATIONS default slicing efficientMapGen frameLevel2D persistentSessions skyline orientationBlocks rasterLookup ${NORMAL_KERNEL_TEST_CONFIGURATIONS})
 
 set(REF_MD5_FILE "${CMAKE_SOURCE_DIR}/tests/quick_tests/ref_md5_quick_tests.csv")
 set(TEST_SEQ_DIR "${CMAKE_SOURCE_DIR}/_sequences/VPCC")